@@ -60,17 +60,17 @@ int main(Platform::Array<Platform::String^>^ args)
 	xal::init(xal::AS_DEFAULT, hwnd, __XAL_THREADED, 0.01f);
 
 	// create a category for fully loaded and decoded sounds
-	xal::mgr->createCategory(CATEGORY_NORMAL, xal::ON_DEMAND, xal::DISK);
+	xal::manager->createCategory(CATEGORY_NORMAL, xal::ON_DEMAND, xal::DISK);
 	// create a category for streamed sounds
-	xal::mgr->createCategory(CATEGORY_STREAMED, xal::STREAMED, xal::DISK);
+	xal::manager->createCategory(CATEGORY_STREAMED, xal::STREAMED, xal::DISK);
 	// create sound using a prefix (forces usage of the ogg files)
-	xal::mgr->createSound(RESOURCE_PATH SOUND_NAME_NORMAL ".ogg", CATEGORY_NORMAL);
+	xal::manager->createSound(RESOURCE_PATH SOUND_NAME_NORMAL ".ogg", CATEGORY_NORMAL);
 	// create streamed sound using no prefix (forces usage of the ogg files)
-	xal::mgr->createSound(RESOURCE_PATH "streamable/" SOUND_NAME_STREAMED ".ogg", CATEGORY_STREAMED, PREFIX);
+	xal::manager->createSound(RESOURCE_PATH "streamable/" SOUND_NAME_STREAMED ".ogg", CATEGORY_STREAMED, PREFIX);
 	xal::Player* p = NULL;
 	
 	// create a sound player for manual control
-	p = xal::mgr->createPlayer(SOUND_NORMAL);
+	p = xal::manager->createPlayer(SOUND_NORMAL);
 	// play the sound
 	hlog::write("", "- starting " SOUND_NORMAL);
 	p->play();
@@ -79,14 +79,14 @@ int main(Platform::Array<Platform::String^>^ args)
 	{
 		hlog::writef("", "    - " SOUND_NORMAL " - samples: %d - time: %f", p->getSamplePosition(), p->getTimePosition());
 		hthread::sleep(100);
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 	}
 	hlog::write("", "- finished " SOUND_NORMAL);
 	// destroy the player
-	xal::mgr->destroyPlayer(p);
+	xal::manager->destroyPlayer(p);
 
 	// create a new sound player
-	p = xal::mgr->createPlayer(SOUND_STREAMED);
+	p = xal::manager->createPlayer(SOUND_STREAMED);
 	// play the sound
 	hlog::write("", "- starting " SOUND_STREAMED);
 	p->play();
@@ -94,25 +94,25 @@ int main(Platform::Array<Platform::String^>^ args)
 	{
 		hlog::writef("", "    - " SOUND_STREAMED " - samples: %d - time: %f", p->getSamplePosition(), p->getTimePosition());
 		hthread::sleep(100);
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 	}
 	hlog::write("", "- finished " SOUND_STREAMED);
 	// destroy the player
-	xal::mgr->destroyPlayer(p);
+	xal::manager->destroyPlayer(p);
 
 	// fire & forget, no control over the sound
-	xal::mgr->play(SOUND_NORMAL);
+	xal::manager->play(SOUND_NORMAL);
 	hlog::write("", "- starting " SOUND_NORMAL);
-	while (xal::mgr->isAnyPlaying(SOUND_NORMAL))
+	while (xal::manager->isAnyPlaying(SOUND_NORMAL))
 	{
 		hthread::sleep(100);
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 	}
 	hlog::write("", "- finished " SOUND_NORMAL);
 
 	// destroying the sounds manually
-	xal::mgr->destroySound(xal::mgr->getSound(SOUND_NORMAL));
-	xal::mgr->destroySound(xal::mgr->getSound(SOUND_STREAMED));
+	xal::manager->destroySound(xal::manager->getSound(SOUND_NORMAL));
+	xal::manager->destroySound(xal::manager->getSound(SOUND_STREAMED));
 	// destroying XAL itself
 	xal::destroy();
 #ifndef _WINRT
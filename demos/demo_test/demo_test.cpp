@@ -19,17 +19,21 @@
 #endif
 
 #include <stdio.h>
+#include <chrono>
 #ifdef _WIN32
 #include <windows.h>
 #endif
 
 #include <hltypes/harray.h>
 #include <hltypes/hlog.h>
+#include <hltypes/hstream.h>
 #include <hltypes/hstring.h>
 #include <hltypes/hthread.h>
 
 #include <xal/AudioManager.h>
+#include <xal/Category.h>
 #include <xal/Player.h>
+#include <xal/Sound.h>
 #include <xal/xal.h>
 #include <xalutil/ParallelSoundManager.h>
 #include <xalutil/Playlist.h>
@@ -54,6 +58,9 @@
 
 //#define _TEST_UTIL_PLAYLIST
 //#define _TEST_UTIL_PARALLEL_SOUNDS
+//#define _TEST_COMPRESSED_MODE // compares CPU and RAM usage of FULL and COMPRESSED
+//#define _TEST_VORBIS_DECODERS // compares decoding speed of libvorbis and Tremor, requires _FORMAT_OGG and _FORMAT_OGG_TREMOR
+//#define _TEST_SPEEX_DECODER // compares decoding speed of Speex and Vorbis for the same speech, requires _FORMAT_SPX
 
 #ifndef _USE_LINKS
 #define S_BARK "bark"
@@ -82,6 +89,10 @@
 #endif
 
 #define OPENAL_MAX_SOURCES 16 // needed when using OpenAL
+#define BENCHMARK_FILE "bark.ogg"
+#define BENCHMARK_VOICES 8
+#define BENCHMARK_TIME 10.0f
+#define BENCHMARK_DECODE_COUNT 20
 
 void _test_basic(xal::Player* player)
 {
@@ -90,7 +101,7 @@ void _test_basic(xal::Player* player)
 	while (player->isPlaying())
 	{
 		hthread::sleep(100);
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 	}
 }
 
@@ -101,66 +112,66 @@ void _test_sound(xal::Player* player)
 	for_iter (i, 0, 20)
 	{
 		hthread::sleep(100);
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 		player->pause();
 
 		hlog::writef("", "  - PAUSE: %02d - %05d %7.3f", i, player->getSamplePosition(), player->getTimePosition());
 
 		hthread::sleep(100);
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 		player->play();
 
 		hlog::writef("", "  - PLAY:  %02d - %05d %7.3f", i, player->getSamplePosition(), player->getTimePosition());
 	}
-	xal::mgr->update(1.0f);
+	xal::manager->update(1.0f);
 }
 
 void _test_multiplay(xal::Player* player)
 {
 	hlog::write("", "  - start test multiple play...");
-	xal::mgr->play(S_BARK);
+	xal::manager->play(S_BARK);
 	hthread::sleep(100);
-	xal::mgr->play(S_BARK);
-	while (xal::mgr->isAnyPlaying(S_BARK))
+	xal::manager->play(S_BARK);
+	while (xal::manager->isAnyPlaying(S_BARK))
 	{
 		hthread::sleep(100);
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 	}
 	hthread::sleep(500);
 	hlog::write("", "starting stop test");
-	xal::mgr->play(S_WIND);
+	xal::manager->play(S_WIND);
 	hthread::sleep(200);
-	xal::mgr->play(S_WIND);
+	xal::manager->play(S_WIND);
 	int count = 0;
-	while (xal::mgr->isAnyPlaying(S_WIND))
+	while (xal::manager->isAnyPlaying(S_WIND))
 	{
 		hlog::writef("", "- wind stop iteration: %d", count);
 		for_iter (i, 0, 5)
 		{
 			hthread::sleep(100);
-			xal::mgr->update(0.1f);
+			xal::manager->update(0.1f);
 		}
-		xal::mgr->stop(S_WIND);
+		xal::manager->stop(S_WIND);
 		count++;
 	}
 	hthread::sleep(500);
 	hlog::write("", "starting stopFirst test");
-	xal::mgr->play(S_WIND);
+	xal::manager->play(S_WIND);
 	hthread::sleep(200);
-	xal::mgr->play(S_WIND);
+	xal::manager->play(S_WIND);
 	count = 0;
-	while (xal::mgr->isAnyPlaying(S_WIND))
+	while (xal::manager->isAnyPlaying(S_WIND))
 	{
 		hlog::writef("", "- wind stopFirst iteration: %d", count);
 		for_iter (i, 0, 5)
 		{
 			hthread::sleep(100);
-			xal::mgr->update(0.1f);
+			xal::manager->update(0.1f);
 		}
-		xal::mgr->stopFirst(S_WIND);
+		xal::manager->stopFirst(S_WIND);
 		count++;
 	}
-	xal::mgr->update(0.1f);
+	xal::manager->update(0.1f);
 }
 
 void _test_handle_stream(xal::Player* player)
@@ -168,13 +179,13 @@ void _test_handle_stream(xal::Player* player)
 	hlog::write("", "  - start test handle stream...");
 	player->play();
 	hthread::sleep(200);
-	xal::mgr->update(0.2f);
+	xal::manager->update(0.2f);
 	for_iter (i, 0, 5)
 	{
 		hlog::writef("", "  - play %d", i);
 		player->play();
 		hthread::sleep(1000);
-		xal::mgr->update(1.0f);
+		xal::manager->update(1.0f);
 		if (i == 1)
 		{
 			hlog::writef("", "  - fade %d", i);
@@ -182,7 +193,7 @@ void _test_handle_stream(xal::Player* player)
 			for_iter (j, 0, 10)
 			{
 				hthread::sleep(100);
-				xal::mgr->update(0.1f);
+				xal::manager->update(0.1f);
 			}
 		}
 		else if (i == 3)
@@ -192,99 +203,99 @@ void _test_handle_stream(xal::Player* player)
 			for_iter (j, 0, 10)
 			{
 				hthread::sleep(100);
-				xal::mgr->update(0.1f);
+				xal::manager->update(0.1f);
 			}
 		}
 	}
 	hlog::write("", "  - stop");
 	player->stop();
-	xal::mgr->update(0.1f);
+	xal::manager->update(0.1f);
 }
 
 void _test_fadein(xal::Player* player)
 {
 	hlog::write("", "  - start test fade in...");
-	xal::Player* p1 = xal::mgr->createPlayer(S_WIND);
+	xal::Player* p1 = xal::manager->createPlayer(S_WIND);
 	p1->play(1.0f);
 	for_iter (i, 0, 20)
 	{
 		hthread::sleep(100);
 		hlog::writef("", "T:%d P:%s FI:%s FO:%s", i, p1->isPlaying() ? "1" : "_", p1->isFadingIn() ? "1" : "_", p1->isFadingOut() ? "1" : "_");
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 	}
 	p1->stop();
-	xal::mgr->update(1.0f);
+	xal::manager->update(1.0f);
 }
 
 void _test_fadeout(xal::Player* player)
 {
 	hlog::write("", "  - start test fade out...");
-	xal::Player* p1 = xal::mgr->createPlayer(S_WIND);
+	xal::Player* p1 = xal::manager->createPlayer(S_WIND);
 	p1->play();
 	p1->stop(1.0f);
 	for_iter (i, 0, 20)
 	{
 		hthread::sleep(100);
 		hlog::writef("", "T:%d P:%s FI:%s FO:%s", i, p1->isPlaying() ? "1" : "_", p1->isFadingIn() ? "1" : "_", p1->isFadingOut() ? "1" : "_");
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 	}
 	p1->stop();
-	xal::mgr->update(0.1f);
+	xal::manager->update(0.1f);
 }
 
 void _test_fadeinout(xal::Player* player)
 {
 	hlog::write("", "  - start test fade in and out...");
-	xal::Player* p1 = xal::mgr->createPlayer(S_WIND);
+	xal::Player* p1 = xal::manager->createPlayer(S_WIND);
 	p1->play(1.0f);
 	for_iter (i, 0, 8)
 	{
 		hthread::sleep(100);
 		hlog::writef("", "T:%d P:%s FI:%s FO:%s", i, p1->isPlaying() ? "1" : "_", p1->isFadingIn() ? "1" : "_", p1->isFadingOut() ? "1" : "_");
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 	}
 	p1->pause(1.0f);
 	for_iter (i, 0, 6)
 	{
 		hthread::sleep(100);
 		hlog::writef("", "T:%d P:%s FI:%s FO:%s", i, p1->isPlaying() ? "1" : "_", p1->isFadingIn() ? "1" : "_", p1->isFadingOut() ? "1" : "_");
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 	}
 	p1->play(1.0f);
 	for_iter (i, 0, 3)
 	{
 		hthread::sleep(100);
 		hlog::writef("", "T:%d P:%s FI:%s FO:%s", i, p1->isPlaying() ? "1" : "_", p1->isFadingIn() ? "1" : "_", p1->isFadingOut() ? "1" : "_");
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 	}
 	hlog::write("", "- 10 more updates");
 	for_iter (i, 0, 10)
 	{
 		hthread::sleep(100);
 		hlog::writef("", "T:%d P:%s FI:%s FO:%s", i, p1->isPlaying() ? "1" : "_", p1->isFadingIn() ? "1" : "_", p1->isFadingOut() ? "1" : "_");
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 	}
 	p1->stop();
-	xal::mgr->update(1.0f);
+	xal::manager->update(1.0f);
 }
 
 void _test_complex_handler(xal::Player* player)
 {
 	hlog::write("", "  - start test complex handler...");
 	xal::Player* temp;
-	xal::Player* p1 = xal::mgr->createPlayer(S_WIND);
-	xal::Player* p2 = xal::mgr->createPlayer(S_WIND_2);
+	xal::Player* p1 = xal::manager->createPlayer(S_WIND);
+	xal::Player* p2 = xal::manager->createPlayer(S_WIND_2);
 	p1->play();
 	p2->play();
 	p2->pause();
 	for_iter (i, 0, 50)
 	{
 		hthread::sleep(100);
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 		p2->play();
 		p1->pause();
 		hthread::sleep(100);
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 		p2->pause();
 		p1->play();
 		if (i % 3 == 0)
@@ -296,45 +307,45 @@ void _test_complex_handler(xal::Player* player)
 	}
 	p1->stop();
 	p2->stop();
-	xal::mgr->destroyPlayer(p1);
-	xal::mgr->destroyPlayer(p2);
-	xal::mgr->update(0.1f);
+	xal::manager->destroyPlayer(p1);
+	xal::manager->destroyPlayer(p2);
+	xal::manager->update(0.1f);
 }
 
 void _test_memory_management(xal::Player* player)
 {
 	hlog::write("", "  - start test memory management...");
-	xal::mgr->setIdlePlayerUnloadTime(0.5f);
+	xal::manager->setIdlePlayerUnloadTime(0.5f);
 	player->play();
 	hthread::sleep(200);
-	xal::mgr->update(0.2f);
+	xal::manager->update(0.2f);
 	player->pause();
 	hthread::sleep(1000);
-	xal::mgr->update(1.0f);
+	xal::manager->update(1.0f);
 	player->stop();
 	player->play();
 	hthread::sleep(200);
-	xal::mgr->update(0.2f);
+	xal::manager->update(0.2f);
 	player->stop();
 	hlog::write("", "expecting automatic memory clearing now...");
 	hthread::sleep(1000);
-	xal::mgr->update(1.0f);
-	xal::Player* p1 = xal::mgr->createPlayer(S_WIND);
+	xal::manager->update(1.0f);
+	xal::Player* p1 = xal::manager->createPlayer(S_WIND);
 	p1->play();
 	player->play();
 	hthread::sleep(200);
-	xal::mgr->update(0.2f);
+	xal::manager->update(0.2f);
 	p1->pause();
 	player->pause();
 	hlog::write("", "trying to clear memory on paused sounds...");
-	xal::mgr->clearMemory();
+	xal::manager->clearMemory();
 	hthread::sleep(1000);
-	xal::mgr->update(0.5f);
+	xal::manager->update(0.5f);
 	p1->stop();
 	player->stop();
 	hlog::write("", "trying to clear memory on stopped sounds...");
-	xal::mgr->clearMemory();
-	xal::mgr->destroyPlayer(p1);
+	xal::manager->clearMemory();
+	xal::manager->destroyPlayer(p1);
 }
 
 void _test_sources(xal::Player* player)
@@ -342,24 +353,24 @@ void _test_sources(xal::Player* player)
 	hlog::write("", "  - start test sources...");
 	for_iter (i, 0, OPENAL_MAX_SOURCES + 1)
 	{
-		xal::mgr->play(S_BARK);
+		xal::manager->play(S_BARK);
 		hthread::sleep(20);
 	}
-	while (xal::mgr->isAnyPlaying(S_BARK))
+	while (xal::manager->isAnyPlaying(S_BARK))
 	{
 		hthread::sleep(100);
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 	}
-	xal::mgr->update(0.01f);
-	xal::Player* p1 = xal::mgr->createPlayer(S_WIND);
+	xal::manager->update(0.01f);
+	xal::Player* p1 = xal::manager->createPlayer(S_WIND);
 	p1->play();
 	for_iter (i, 0, 20)
 	{
 		hthread::sleep(100);
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 	}
 	p1->stop();
-	xal::mgr->update(0.1f);
+	xal::manager->update(0.1f);
 }
 
 void _test_util_playlist(xal::Player* player)
@@ -375,7 +386,7 @@ void _test_util_playlist(xal::Player* player)
 	while (list.isPlaying())
 	{
 		hthread::sleep(100);
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 		list.update();
 	}
 }
@@ -391,17 +402,119 @@ void _test_util_parallel_sounds(xal::Player* player)
 	for_iter (i, 0, 1000)
 	{
 		hthread::sleep(100);
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 	}
 	names.clear();
 	pmgr.updateList(names);
 	for_iter (i, 0, 10)
 	{
 		hthread::sleep(100);
-		xal::mgr->update(0.1f);
+		xal::manager->update(0.1f);
 	}
 }
 
+double _benchmark_time()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double _benchmark_playback(xal::Sound* sound)
+{
+	harray<xal::Player*> players;
+	xal::Player* player = NULL;
+	for_iter (i, 0, BENCHMARK_VOICES)
+	{
+		player = xal::manager->createPlayer(sound->getName());
+		player->play(0.0f, true);
+		players += player;
+	}
+	double updateTime = 0.0;
+	double start = 0.0;
+	for (float time = 0.0f; time < BENCHMARK_TIME; time += 0.01f)
+	{
+		hthread::sleep(10);
+		start = _benchmark_time();
+		xal::manager->update(0.01f);
+		updateTime += _benchmark_time() - start;
+	}
+	foreach (xal::Player*, it, players)
+	{
+		(*it)->stop();
+		xal::manager->destroyPlayer(*it);
+	}
+	return (updateTime / BENCHMARK_TIME);
+}
+
+void _test_compressed_mode(xal::Player* player)
+{
+	hlog::write("", "  - start test compressed mode...");
+	// only meaningful without _USE_THREADING, otherwise decoding doesn't happen in update()
+	float readAheadTime = xal::manager->getStreamReadAheadTime();
+	xal::manager->setStreamReadAheadTime(0.0f); // the read-ahead service would decode on its own thread as well
+	xal::manager->createCategory("benchmark_full", xal::FULL, xal::RAM);
+	xal::manager->createCategory("benchmark_compressed", xal::COMPRESSED, xal::RAM);
+	double start = _benchmark_time();
+	xal::Sound* full = xal::manager->createSound(RESOURCE_PATH BENCHMARK_FILE, "benchmark_full", "full_");
+	double fullLoadTime = _benchmark_time() - start;
+	start = _benchmark_time();
+	xal::Sound* compressed = xal::manager->createSound(RESOURCE_PATH BENCHMARK_FILE, "benchmark_compressed", "compressed_");
+	double compressedLoadTime = _benchmark_time() - start;
+	hlog::writef("", "FULL: %d bytes resident, loaded in %.2f ms", full->getSize(), fullLoadTime);
+	hlog::writef("", "COMPRESSED: %d bytes resident, loaded in %.2f ms", compressed->getSourceSize(), compressedLoadTime);
+	hlog::writef("", "FULL: %.3f ms of update() per second with %d voices", _benchmark_playback(full), BENCHMARK_VOICES);
+	hlog::writef("", "COMPRESSED: %.3f ms of update() per second with %d voices", _benchmark_playback(compressed), BENCHMARK_VOICES);
+	xal::manager->destroySound(full);
+	xal::manager->destroySound(compressed);
+	xal::manager->setStreamReadAheadTime(readAheadTime);
+}
+
+double _benchmark_decoding(chstr categoryName, harray<hstr> filenames)
+{
+	int64_t decodedSize = 0;
+	double decodeTime = 0.0;
+	double start = 0.0;
+	xal::Sound* sound = NULL;
+	foreach (hstr, it, filenames)
+	{
+		sound = xal::manager->createSound(*it, categoryName, categoryName);
+		for_iter (i, 0, BENCHMARK_DECODE_COUNT)
+		{
+			hstream stream;
+			start = _benchmark_time();
+			sound->readPcmData(stream);
+			decodeTime += _benchmark_time() - start;
+			decodedSize += stream.size();
+		}
+		xal::manager->destroySound(sound);
+	}
+	return (decodedSize / 1000.0 / hmax(decodeTime, 0.001)); // MB/s
+}
+
+void _test_vorbis_decoders(xal::Player* player)
+{
+	hlog::write("", "  - start test vorbis decoders...");
+	harray<hstr> filenames;
+	filenames += RESOURCE_PATH "bark.ogg";
+	filenames += RESOURCE_PATH "streamable/wind.ogg";
+	xal::manager->createCategory("vorbis_float", xal::LAZY, xal::RAM)->setVorbisDecoder(xal::VORBIS_FLOAT);
+	xal::manager->createCategory("vorbis_integer", xal::LAZY, xal::RAM)->setVorbisDecoder(xal::VORBIS_INTEGER);
+	hlog::writef("", "libvorbis: %.1f MB/s of PCM data", _benchmark_decoding("vorbis_float", filenames));
+	hlog::writef("", "Tremor: %.1f MB/s of PCM data", _benchmark_decoding("vorbis_integer", filenames));
+}
+
+void _test_speex_decoder(xal::Player* player)
+{
+	hlog::write("", "  - start test speex decoder...");
+	// both files contain the same 16 kHz mono speech at about 29 kbit/s
+	harray<hstr> speexFilenames;
+	speexFilenames += RESOURCE_PATH "wb_male.spx";
+	harray<hstr> vorbisFilenames;
+	vorbisFilenames += RESOURCE_PATH "wb_male_2.ogg";
+	xal::manager->createCategory("speech", xal::LAZY, xal::RAM);
+	hlog::writef("", "Speex: %.1f MB/s of PCM data", _benchmark_decoding("speech", speexFilenames));
+	hlog::writef("", "Vorbis: %.1f MB/s of PCM data", _benchmark_decoding("speech", vorbisFilenames));
+}
+
 #ifndef _WINRT
 int main(int argc, char **argv)
 #else
@@ -419,25 +532,25 @@ int main(Platform::Array<Platform::String^>^ args)
 	xal::init(xal::AS_DEFAULT, hwnd, true, 0.01f);
 #endif
 #ifdef _USE_MEMORY_MANAGEMENT
-	xal::mgr->createCategory("sound", xal::MANAGED, SOURCE_MODE);
+	xal::manager->createCategory("sound", xal::MANAGED, SOURCE_MODE);
 #endif
-	harray<hstr> files = xal::mgr->createSoundsFromPath(RESOURCE_PATH, "sound", "");
+	harray<hstr> files = xal::manager->createSoundsFromPath(RESOURCE_PATH, "sound", "");
 #ifndef _USE_LINKS
 #ifndef _USE_STREAM
-	xal::mgr->createCategory("streamable", xal::MANAGED, SOURCE_MODE);
+	xal::manager->createCategory("streamable", xal::MANAGED, SOURCE_MODE);
 #else
-	xal::mgr->createCategory("streamable", xal::STREAMED, SOURCE_MODE);
+	xal::manager->createCategory("streamable", xal::STREAMED, SOURCE_MODE);
 #endif
-	files += xal::mgr->createSoundsFromPath(RESOURCE_PATH "streamable", "streamable", "");
+	files += xal::manager->createSoundsFromPath(RESOURCE_PATH "streamable", "streamable", "");
 #else
 #ifdef _USE_MEMORY_MANAGEMENT
-	xal::mgr->createCategory("cat", xal::MANAGED, SOURCE_MODE);
+	xal::manager->createCategory("cat", xal::MANAGED, SOURCE_MODE);
 #else
-	xal::mgr->createCategory("cat", xal::FULL, SOURCE_MODE);
+	xal::manager->createCategory("cat", xal::FULL, SOURCE_MODE);
 #endif
-	xal::mgr->createSound(RESOURCE_PATH "linked/linked_sound.xln", "cat");
+	xal::manager->createSound(RESOURCE_PATH "linked/linked_sound.xln", "cat");
 #endif
-	xal::Player* player = xal::mgr->createPlayer(USED_SOUND);
+	xal::Player* player = xal::manager->createPlayer(USED_SOUND);
 
 #ifdef _TEST_BASIC
 	_test_basic(player);
@@ -475,8 +588,17 @@ int main(Platform::Array<Platform::String^>^ args)
 #ifdef _TEST_UTIL_PARALLEL_SOUNDS
 	_test_util_parallel_sounds(player);
 #endif
+#ifdef _TEST_COMPRESSED_MODE
+	_test_compressed_mode(player);
+#endif
+#ifdef _TEST_VORBIS_DECODERS
+	_test_vorbis_decoders(player);
+#endif
+#ifdef _TEST_SPEEX_DECODER
+	_test_speex_decoder(player);
+#endif
 
-	xal::mgr->destroyPlayer(player);
+	xal::manager->destroyPlayer(player);
 	hlog::write("", "  - done");
 	xal::destroy();
 #ifndef _WINRT
@@ -23,9 +23,12 @@
 
 #include "xalExport.h"
 
-#define STREAM_BUFFER_COUNT 8 // greater or equal to 2
-#define STREAM_BUFFER_SIZE 32768 // equal to any power of 2
+#define STREAM_BUFFER_COUNT 8 // greater or equal to 2, default only, see AudioManager::setStreamBufferCount()
+#define STREAM_BUFFER_SIZE 32768 // equal to any power of 2, default only, see AudioManager::setStreamBufferSize()
 #define STREAM_BUFFER (STREAM_BUFFER_COUNT * STREAM_BUFFER_SIZE)
+#define STREAM_BUFFER_MIN_SIZE 1024 // must be a power of 2
+#define STREAM_READ_AHEAD_TIME 0.5f // in seconds, default only, see AudioManager::setStreamReadAheadTime()
+#define PROGRESSIVE_LOAD_LEAD_TIME 0.0f // in seconds, default only, see AudioManager::setProgressiveLoadLeadTime()
 
 namespace xal
 {
@@ -34,7 +37,8 @@ namespace xal
 		FLAC,
 		M4A,
 		OGG,
-		SPX, // not supported yet
+		/// @note Only supported in builds that define _FORMAT_SPX and link libspeex, see lib/readme.txt.
+		SPX,
 		WAV,
 		UNKNOWN
 	};
@@ -52,7 +56,19 @@ namespace xal
 		/// @brief Buffers when first need arises, clears memory after usage.
 		ON_DEMAND = 4,
 		/// @brief Buffers in streamed mode.
-		STREAMED = 5
+		STREAMED = 5,
+		/// @brief Buffers in streamed mode while the encoded file is kept in memory once and shared by all Players.
+		COMPRESSED = 6
+	};
+
+	enum VorbisDecoder
+	{
+		/// @brief Uses the AudioManager's default, only meaningful for Categories.
+		VORBIS_DEFAULT = 0,
+		/// @brief Decodes with libvorbis using floating-point math.
+		VORBIS_FLOAT = 1,
+		/// @brief Decodes with Tremor using fixed-point math, usually faster on CPUs without a fast FPU.
+		VORBIS_INTEGER = 2
 	};
 
 	enum SourceMode
@@ -60,15 +76,72 @@ namespace xal
 		/// @brief Leaves data on permanent storage device.
 		DISK = 0,
 		/// @brief Copies data to RAM buffer and accesses it from there.
-		RAM = 1
+		RAM = 1,
+		/// @brief Memory-maps the file and reads directly from the mapping.
+		/// @note The file is opened directly in the file system, not through hresource. Falls back to RAM if the file cannot be mapped (e.g. when it is packed in an archive or on WinRT) or if it does not match the resource.
+		MMAP = 2
+	};
+
+	enum VoiceStealMode
+	{
+		/// @brief Steals the voice with the lowest current gain.
+		QUIETEST = 0,
+		/// @brief Steals the voice that was started first.
+		OLDEST = 1
+	};
+
+	/// @brief Statistics of the decoded audio data cache.
+	struct xalExport CacheStats
+	{
+		/// @brief Number of times a Buffer's data was still in memory when it was needed.
+		int hits;
+		/// @brief Number of times a Buffer's data had to be decoded.
+		int misses;
+		/// @brief Number of times a Buffer's data was cleared to stay within the cache budget.
+		int evictions;
+		/// @brief Byte-size of decoded audio data currently kept in memory by cached Buffers.
+		/// @note Updated when Buffers are loaded or released and at least once per second.
+		int64_t residentBytes;
+
+		CacheStats() : hits(0), misses(0), evictions(0), residentBytes(0) { }
+	};
+
+	/// @brief Statistics of the streaming service.
+	struct xalExport StreamStats
+	{
+		/// @brief Number of times a streamed Buffer's read-ahead did not have enough decoded data ready.
+		int underruns;
+		/// @brief Byte-size of silence that was inserted because of underruns.
+		int64_t underrunBytes;
+		/// @brief Number of heap allocations made on the streaming path.
+		/// @note Includes chunk memory, read-ahead rings, shared decoders and buffer growth in the Converter and the FLAC decoder.
+		/// @note Allocations inside third-party decoder libraries (e.g. libvorbis) are not counted.
+		/// @note Once streamed sounds are playing, this should not increase anymore.
+		int allocations;
+		/// @brief Number of times a Player fell behind the shared decoder of its Sound and had to decode on its own.
+		int sharedFallbacks;
+
+		StreamStats() : underruns(0), underrunBytes(0), allocations(0), sharedFallbacks(0) { }
 	};
 
 	class Buffer;
 	class Category;
+	class Command;
+	class CommandQueue;
+	class Converter;
 	class Player;
 	class Sound;
 	class Source;
 
+	/// @brief A managed Player with the values that voice management sorts by.
+	/// @note This is for internal usage only.
+	struct VoiceCandidate
+	{
+		Player* player;
+		int priority;
+		double rank;
+	};
+
 	/// @brief Provides generic functionality regarding audio management.
 	class xalExport AudioManager
 	{
@@ -76,6 +149,7 @@ namespace xal
 		friend class Buffer;
 		friend class Category;
 		friend class Player;
+		friend class SharedStream;
 		friend class Sound;
 
 		/// @brief Destructor.
@@ -95,11 +169,76 @@ namespace xal
 		HL_DEFINE_GETSET(float, idlePlayerUnloadTime, IdlePlayerUnloadTime);
 		HL_DEFINE_GET(hstr, deviceName, DeviceName);
 		inline bool isThreaded() { return (this->thread != NULL); }
+		HL_DEFINE_IS(deferredCommands, DeferredCommands);
+		void setDeferredCommands(bool value);
 		HL_DEFINE_GET(float, updateTime, UpdateTime);
 		HL_DEFINE_GET(float, globalGain, GlobalGain);
 		void setGlobalGain(float value);
+		/// @return Number of worker threads used for asynchronous decoding.
+		int getAsyncDecoderCount();
+		/// @brief Sets the number of worker threads used for asynchronous decoding.
+		/// @param[in] value Number of worker threads. A value of 0 uses the number of available CPU cores.
+		void setAsyncDecoderCount(int value);
 		harray<Player*> getPlayers();
 		hmap<hstr, Sound*> getSounds();
+		HL_DEFINE_GET(int, maxVoices, MaxVoices);
+		/// @brief Sets the size of the voice pool.
+		/// @param[in] value Maximum number of Players that can play in the audio-system at the same time. A value of 0 means no limit.
+		/// @note Managed Players that don't get a voice become virtual and keep advancing their play position until a voice becomes available.
+		/// @note Manually created Players are never virtualized or stolen from, because their owner controls them. They still use voices and count towards the limit.
+		void setMaxVoices(int value);
+		HL_DEFINE_GETSET(VoiceStealMode, voiceStealMode, VoiceStealMode);
+		/// @return Number of Players that currently use a voice in the audio-system.
+		/// @note Manually created Players that started or stopped since the last update are counted after the next update.
+		int getActiveVoiceCount();
+		/// @return Number of managed Players that are currently virtual.
+		int getVirtualVoiceCount();
+		HL_DEFINE_GET(int, streamBufferCount, StreamBufferCount);
+		/// @brief Sets the default number of stream-buffers for Categories that don't define their own.
+		/// @param[in] value Number of stream-buffers, at least 2.
+		/// @note Only Players created afterwards are affected.
+		void setStreamBufferCount(int value);
+		HL_DEFINE_GET(int, streamBufferSize, StreamBufferSize);
+		/// @brief Sets the default byte-size of a single stream-buffer for Categories that don't define their own.
+		/// @param[in] value Byte-size of a stream-buffer.
+		/// @note The value is rounded up to a power of 2 of at least STREAM_BUFFER_MIN_SIZE so a stream-buffer always holds whole sample frames.
+		/// @note Only Players created afterwards are affected.
+		void setStreamBufferSize(int value);
+		HL_DEFINE_GET(float, streamReadAheadTime, StreamReadAheadTime);
+		/// @brief Sets how much audio data of streamed sounds is decoded ahead by the streaming service thread.
+		/// @param[in] value Read-ahead time in seconds. A value of 0 disables the streaming service and streamed sounds are decoded on the update thread.
+		/// @note Only streamed sounds that start playing afterwards are affected.
+		void setStreamReadAheadTime(float value);
+		/// @return Statistics of the streaming service.
+		StreamStats getStreamStats();
+		/// @brief Resets the counters of the streaming service statistics.
+		void resetStreamStats();
+		HL_DEFINE_GET(float, progressiveLoadLeadTime, ProgressiveLoadLeadTime);
+		/// @brief Sets how much audio data of a non-streamed sound has to be decoded before it can start playing while the rest is still being decoded.
+		/// @param[in] value Lead time in seconds. A value of 0 disables progressive loading and sounds are only played once they are decoded completely.
+		/// @note Progressive loading is only used if the audio system supports it.
+		/// @note With progressive loading, data of non-streamed sounds is always decoded by the async decoder workers, when it is played, even if it is not loaded asynchronously. Buffer::prepare() still waits until the data is loaded completely.
+		void setProgressiveLoadLeadTime(float value);
+		HL_DEFINE_GET(VorbisDecoder, vorbisDecoder, VorbisDecoder);
+		/// @brief Sets the default decoder for Ogg Vorbis files for Categories that don't define their own.
+		/// @param[in] value The decoder. VORBIS_DEFAULT selects the decoder that is preferred by the build.
+		/// @note Falls back to the other decoder if the requested one is not available in this build. Only Sounds and Players created afterwards are affected.
+		void setVorbisDecoder(VorbisDecoder value);
+		HL_DEFINE_GET(int64_t, cacheBudget, CacheBudget);
+		/// @brief Sets the memory budget for decoded audio data of LAZY, MANAGED and ON_DEMAND Buffers.
+		/// @param[in] value Maximum byte-size of decoded audio data kept in memory. A value of 0 means no limit.
+		/// @note When the budget is exceeded, the data of the least recently used Buffers without bound Players is cleared.
+		/// @note With a budget set, ON_DEMAND Buffers keep their data after usage until it is evicted.
+		void setCacheBudget(int64_t value);
+		/// @return Statistics of the decoded audio data cache.
+		CacheStats getCacheStats();
+		/// @brief Resets the hit, miss and eviction counters of the cache statistics.
+		void resetCacheStats();
+		HL_DEFINE_GET(hstr, diskCachePath, DiskCachePath);
+		/// @brief Sets the directory where decoded audio data of compressed files is stored persistently.
+		/// @param[in] value Path of the directory. An empty string disables the disk cache.
+		/// @note Later loads of the same file memory-map the cached data instead of decoding the file again.
+		void setDiskCachePath(chstr value);
 
 		/// @brief Updates all audio processing.
 		/// @param[in] timeDelta Time since the call of this method in seconds.
@@ -276,6 +415,15 @@ namespace xal
 		/// @brief List of Player instances that are managed solely by the audio system.
 		/// @note Managed players are usually created when a Sound is played through a call to the AudioManager instance and destroyed when they aren't needed anymore (using a fire-and-forget mechanism).
 		harray<Player*> managedPlayers;
+		/// @brief Stopped managed Player instances per Sound that are recycled instead of creating new ones.
+		hmap<Sound*, harray<Player*> > playerPool;
+		/// @brief Managed Player instances per Sound.
+		/// @note Used to enforce instance limits without going through all managed Players.
+		hmap<Sound*, harray<Player*> > soundPlayers;
+		/// @brief Reused by _updateVirtualVoices() so it doesn't allocate every update.
+		harray<VoiceCandidate> virtualVoiceCandidates;
+		/// @brief Reused by _updateVirtualVoices() so it doesn't allocate every update.
+		harray<VoiceCandidate> voiceVictims;
 		/// @brief List of Player instances that need to resume once the audio system exits suspension.
 		harray<Player*> suspendedPlayers;
 		/// @brief List of loaded Sounds.
@@ -290,6 +438,51 @@ namespace xal
 		bool threadRunning;
 		/// @brief Mutex for data access when threaded updating is used.
 		hmutex mutex; // a mute ex would be nice
+		/// @brief Whether public calls are queued as Commands for the update thread instead of locking the mutex.
+		/// @note Only has an effect when threaded updating is used.
+		bool deferredCommands;
+		/// @brief Queue of Commands waiting to be executed on the update thread.
+		CommandQueue* commandQueue;
+		/// @brief Maximum number of Players that can play in the audio-system at the same time.
+		/// @note A value of 0 means no limit.
+		int maxVoices;
+		/// @brief Which voice is stolen among managed Players with the same priority.
+		VoiceStealMode voiceStealMode;
+		/// @brief Number of Players that currently use a voice in the audio-system.
+		/// @note Counted on every update and adjusted in between whenever managed Players get or lose a voice.
+		int activeVoices;
+		/// @brief Counter for the start order of managed Players.
+		unsigned int playCounter;
+		/// @brief Default number of stream-buffers.
+		int streamBufferCount;
+		/// @brief Default byte-size of a single stream-buffer.
+		int streamBufferSize;
+		/// @brief How much audio data of streamed sounds is decoded ahead in seconds.
+		/// @note A value of 0 means that the streaming service is disabled.
+		float streamReadAheadTime;
+		/// @brief Statistics of the streaming service.
+		StreamStats streamStats;
+		/// @brief Mutex for access of streamStats.
+		/// @note The statistics are updated from the streaming service thread and audio-system threads that don't hold the main mutex.
+		hmutex streamStatsMutex;
+		/// @brief How much audio data of a non-streamed sound has to be decoded before it can start playing in seconds.
+		/// @note A value of 0 means that progressive loading is disabled.
+		float progressiveLoadLeadTime;
+		/// @brief Default decoder for Ogg Vorbis files.
+		VorbisDecoder vorbisDecoder;
+		/// @brief Maximum byte-size of decoded audio data kept in memory by LAZY, MANAGED and ON_DEMAND Buffers.
+		/// @note A value of 0 means no limit.
+		int64_t cacheBudget;
+		/// @brief Statistics of the decoded audio data cache.
+		CacheStats cacheStats;
+		/// @brief Whether a Buffer was loaded or released since the last cache update.
+		bool cacheUpdateRequired;
+		/// @brief Time since the last cache update.
+		/// @note Asynchronous loads finish in other threads and are only noticed by the periodic cache update.
+		float cacheUpdateTime;
+		/// @brief Directory where decoded audio data of compressed files is stored persistently.
+		/// @note An empty string means that the disk cache is disabled.
+		hstr diskCachePath;
 
 		/// @note This method is not thread-safe and is for internal usage only.
 		void _setGlobalGain(float value);
@@ -300,6 +493,22 @@ namespace xal
 
 		/// @note Starts the thread for threaded update.
 		void _startThreading();
+
+		/// @return True if public calls should be queued as Commands instead of locking the mutex.
+		bool _isCommandQueueActive();
+		/// @brief Starts or stops queueing Commands depending on whether they are deferred and the update thread is running.
+		void _updateCommandQueueActive();
+		/// @brief Queues a Command for execution on the update thread.
+		/// @param[in] command The Command.
+		/// @return False if Commands are not queued or the queue is full. The call has to be executed directly in that case.
+		bool _queueCommand(const Command& command);
+		/// @brief Executes all queued Commands.
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _processCommands();
+		/// @brief Executes a single Command.
+		/// @param[in] command The Command.
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _executeCommand(const Command& command);
 		
 		/// @note This method is not thread-safe and is for internal usage only.
 		virtual void _update(float timeDelta);
@@ -327,13 +536,75 @@ namespace xal
 		/// @note This method is not thread-safe and is for internal usage only.
 		void _destroyPlayer(Player* player);
 
-		/// @brief Creates an internally managed Player.
+		/// @brief Creates an internally managed Player or recycles one from the pool.
 		/// @param[in] soundName Name of the Sound.
 		/// @return The newly created Player.
 		Player* _createManagedPlayer(chstr name);
 		/// @brief Destroys an internally managed Player.
 		/// @param[in] player The Player to destroy.
+		/// @note The Player is returned to the pool unless the pool for its Sound is full.
 		void _destroyManagedPlayer(Player* player);
+		/// @brief Destroys all internally managed Players of a Sound.
+		/// @param[in] sound The Sound.
+		void _destroyManagedPlayers(Sound* sound);
+		/// @brief Removes a Player from players and managedPlayers in constant time.
+		/// @param[in] player The Player to remove.
+		/// @note This changes the order of the Players.
+		void _removePlayer(Player* player);
+		/// @brief Deletes all pooled Players of a Sound.
+		/// @param[in] sound The Sound.
+		void _clearPlayerPool(Sound* sound);
+		/// @brief Deletes all pooled Players.
+		void _clearPlayerPools();
+
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _setMaxVoices(int value);
+		/// @note This method is not thread-safe and is for internal usage only.
+		int _getActiveVoiceCount();
+		/// @return Number of Players that currently use a voice in the audio-system, counted one by one.
+		/// @note This method is not thread-safe and is for internal usage only.
+		int _countActiveVoices();
+		/// @note This method is not thread-safe and is for internal usage only.
+		int _getVirtualVoiceCount();
+		/// @brief Gives a Player that starts playing the next start order.
+		/// @param[in] player The Player.
+		/// @note Resuming a paused Player or playing one that is already playing keeps its start order.
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _assignPlayOrder(Player* player);
+		/// @brief Makes sure a new managed Player can get a voice by enforcing instance limits and stealing voices if necessary.
+		/// @param[in] player The new managed Player.
+		/// @return False if the Player has to start as a virtual voice.
+		/// @note This method is not thread-safe and is for internal usage only.
+		bool _acquireVoice(Player* player);
+		/// @brief Finds a managed Player whose voice can be stolen.
+		/// @param[in] priority Priority of the Player that needs a voice.
+		/// @param[in] gain Current gain of the Player that needs a voice.
+		/// @param[in] exclude Player that cannot be stolen from.
+		/// @param[in] lowerOnly Whether only Players with a lower priority can be stolen from.
+		/// @return The Player whose voice can be stolen or NULL if there is none.
+		/// @note This method is not thread-safe and is for internal usage only.
+		Player* _findVoiceToSteal(int priority, float gain, Player* exclude, bool lowerOnly);
+		/// @brief Gives voices back to virtual Players when voices are available or held by Players with a lower priority.
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _updateVirtualVoices();
+
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _setCacheBudget(int64_t value);
+		/// @brief Clears the data of the least recently used unbound Buffers until the cache budget is met.
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _updateCache();
+		/// @brief Makes the next update check the cache budget.
+		/// @note This method is not thread-safe and is for internal usage only.
+		inline void _requestCacheUpdate() { this->cacheUpdateRequired = true; }
+
+		/// @brief Counts an underrun of the streaming service.
+		/// @param[in] bytes Byte-size of silence that was inserted.
+		void _countStreamUnderrun(int bytes);
+		/// @brief Counts heap allocations made on the streaming path.
+		/// @param[in] count Number of allocations.
+		void _countStreamAllocations(int count);
+		/// @brief Counts a Player that fell behind the shared decoder of its Sound.
+		void _countStreamSharedFallback();
 
 		/// @note This method is not thread-safe and is for internal usage only.
 		Buffer* _createBuffer(Sound* sound);
@@ -343,7 +614,7 @@ namespace xal
 		/// @note This method is not thread-safe and is for internal usage only.
 		virtual Player* _createSystemPlayer(Sound* sound) = 0;
 		/// @note This method is not thread-safe and is for internal usage only.
-		virtual Source* _createSource(chstr filename, SourceMode sourceMode, BufferMode bufferMode, Format format);
+		virtual Source* _createSource(chstr filename, SourceMode sourceMode, BufferMode bufferMode, Format format, VorbisDecoder vorbisDecoder);
 
 		/// @note This method is not thread-safe and is for internal usage only.
 		void _play(chstr soundName, float fadeTime, bool looping, float gain);
@@ -374,10 +645,38 @@ namespace xal
 		/// @note This method is not thread-safe and is for internal usage only.
 		virtual void _resumeAudio();
 
-		/// @brief Depending on the audio manager implementation, this method may convert audio data to the appropriate format (bit rate, channel number, sampling rate).
+		/// @brief Converts audio data to the audio system's format (bit rate, channel number, sampling rate) if the audio system requires it.
 		/// @param[in] source Source object that holds the data.
 		/// @param[in,out] stream The data stream buffer.
-		virtual void _convertStream(Source* source, hstream& stream) { }
+		/// @note The data is expected to be complete, streamed data is converted by the Buffer's own Converter instead.
+		virtual void _convertStream(Source* source, hstream& stream);
+		/// @brief Checks whether the audio data of a Source has to be converted.
+		/// @param[in] source Source object that holds the data.
+		/// @return True if the data has to be converted before it can be used by the audio system.
+		/// @note Audio systems that cannot handle all formats natively override this to enable the conversion.
+		/// @note When no conversion is required, a Buffer can use the Source's data directly without copying it.
+		virtual bool _isConversionRequired(Source* source) { return false; }
+		/// @brief Creates a Converter from a Source's format to the audio system's format.
+		/// @param[in] source Source object that holds the data.
+		/// @return The Converter or NULL if no conversion is required.
+		Converter* _createConverter(Source* source);
+		/// @brief Checks whether the audio system can play data of non-streamed sounds while it is still being decoded.
+		/// @return True if the audio system only accesses the data up to Buffer::getDataSize() at any time.
+		/// @note Audio systems that copy all data at once when a sound starts playing cannot support this.
+		virtual bool _isProgressiveLoadSupported() { return false; }
+		/// @brief Checks whether the audio system mixes in float and can use float samples from Sources directly.
+		/// @return True if Buffers should request 32 bit float samples from Sources that support them.
+		/// @note Such an audio system has to accept 32 bit data in _isConversionRequired() and check Buffer::isFloat() when mixing.
+		virtual bool _isFloatMixSupported() { return false; }
+		/// @brief Special additional processing when a Buffer's data is cleared, required for some implementations.
+		/// @param[in] buffer The Buffer.
+		/// @note This method is not thread-safe and is for internal usage only.
+		inline virtual void _onBufferCleared(Buffer* buffer) { }
+		/// @brief Special additional processing when a Buffer is destroyed, required for some implementations.
+		/// @param[in] buffer The Buffer.
+		/// @note Nothing may refer to the Buffer afterwards. The default only clears the data.
+		/// @note This method is not thread-safe and is for internal usage only.
+		inline virtual void _onBufferDestroyed(Buffer* buffer) { this->_onBufferCleared(buffer); }
 
 		/// @brief Special additional processing for suspension, required for some implementations.
 		/// @note This method is not thread-safe and is for internal usage only.
@@ -389,6 +688,11 @@ namespace xal
 		/// @brief Threaded update call.
 		/// @param[in] thread The Thread instance calling.
 		static void _update(hthread* thread);
+		/// @brief Rounds a stream-buffer byte-size up to the next power of 2 of at least STREAM_BUFFER_MIN_SIZE.
+		/// @param[in] value Byte-size of a stream-buffer.
+		/// @return The rounded byte-size.
+		/// @note A power of 2 is a multiple of the frame size of all mono and stereo data with 8, 16 or 32 bits per sample.
+		static int _roundStreamBufferSize(int value);
 
 	};
 	
@@ -22,8 +22,14 @@
 
 namespace xal
 {
+	struct AsyncLoadState;
 	class BufferAsync;
+	class BufferStream;
+	class Converter;
+	class MappedFile;
 	class Player;
+	struct ReadAhead;
+	class SharedStream;
 	class Sound;
 	class Source;
 
@@ -33,6 +39,7 @@ namespace xal
 	public:
 		friend class AudioManager;
 		friend class BufferAsync;
+		friend class BufferStream;
 
 		/// @brief Constructor.
 		/// @param[in] sound Sound object for which to create the buffer.
@@ -43,6 +50,12 @@ namespace xal
 		HL_DEFINE_GET(hstr, filename, Filename);
 		HL_DEFINE_GET(int, fileSize, FileSize);
 		inline hstream& getStream() { return this->stream; }
+		/// @return Pointer to the Buffer's current audio data.
+		/// @note This is either the stream's data or a view directly into the Source's storage, so it must not be modified.
+		inline const unsigned char* getData() { return (this->viewData != NULL ? this->viewData : (unsigned char*)this->stream); }
+		/// @return Byte-size of the Buffer's current audio data.
+		/// @note While the data is loaded progressively, this is the byte-size of the data that has been decoded so far.
+		int getDataSize();
 		HL_DEFINE_GET(Source*, source, Source);
 		HL_DEFINE_GET(float, idleTime, IdleTime);
 
@@ -52,8 +65,15 @@ namespace xal
 		int getBitsPerSample();
 		float getDuration();
 		Format getFormat();
+		/// @return True if the Buffer's data consists of 32 bit float samples from -1 to 1 that the audio system mixes directly.
+		bool isFloat();
 		/// @return True if the Buffer's data is loaded.
 		bool isLoaded();
+		/// @return True if the Buffer's data is loaded.
+		/// @note Unlike isLoaded(), this doesn't lock so it can be used from an audio-system's mixer callback. This method is for internal usage only.
+		bool _isLoaded();
+		/// @return True if the Buffer's data is loaded or enough of it is loaded progressively to start playing.
+		bool isPlayable();
 		/// @return True if the Buffer's data is queued for asynchronous loading.
 		bool isAsyncLoadQueued();
 		/// @return True if the Buffer accesses streamed data.
@@ -64,7 +84,12 @@ namespace xal
 		//bool setOffset(int value);
 
 		/// @brief Prepares the Buffer by pre-loaded meta-data and getting Sources ready to provide audio data.
+		/// @note This blocks until the Buffer's data is fully loaded.
 		void prepare();
+		/// @brief Prepares the Buffer by pre-loaded meta-data and getting Sources ready to provide audio data.
+		/// @param[in] playable Whether it's enough that progressively loaded data can start playing rather than being fully loaded.
+		/// @note This method is for internal usage only.
+		void _prepare(bool playable);
 		/// @brief Prepares the Buffer by pre-loaded meta-data and getting Sources ready to provide audio data asynchronously.
 		/// @return True if the Buffer was queued successfully.
 		bool prepareAsync();
@@ -84,6 +109,16 @@ namespace xal
 		void unbind(Player* player, bool playerPaused);
 		/// @brief Notifies the Buffer that it's being used.
 		void keepLoaded();
+		/// @brief Blocks until the Buffer's asynchronously queued data is loaded.
+		/// @param[in] timeout Maximum time to wait in seconds. A value of 0 waits indefinitely.
+		/// @return True if the data is loaded. False if the timeout expired or nothing was loaded.
+		/// @note The load is moved to the front of the async decoder queue.
+		bool waitForAsyncLoad(float timeout = 0.0f);
+		/// @brief Sets a function that is called whenever an asynchronous load of the Buffer's data finishes.
+		/// @param[in] callback The function. It gets the Buffer, whether the data was loaded or the load was canceled and userData. NULL removes it.
+		/// @param[in] userData Any data that the function needs, e.g. the object that requested the load.
+		/// @note The function is called from an async decoder worker thread.
+		void setAsyncLoadCallback(void (*callback)(Buffer*, bool, void*), void* userData = NULL);
 		/// @brief Rewinds the Source to the beginning.
 		/// @note This affects the underlying audio data, not the data provided by the Buffer.
 		void rewind();
@@ -103,6 +138,11 @@ namespace xal
 		/// @note If the Source does not provide data as PCM, it will always be converted to PCM.
 		void readPcmData(hstream& output);
 
+		/// @brief Makes the streamed Buffer read from a decoder that is shared with other Buffers of the same Sound.
+		/// @param[in] sharedStream The shared decoder.
+		/// @note This method is for internal usage only.
+		void _setSharedStream(SharedStream* sharedStream);
+
 	protected:
 		/// @brief Filename of the source.
 		hstr filename;
@@ -110,16 +150,35 @@ namespace xal
 		int fileSize;
 		/// @brief Buffer Mode to use.
 		BufferMode mode;
-		/// @brief Whether the underlying source was loaded.
-		bool loaded;
+		/// @brief Decoder for Ogg Vorbis files as defined by the Category.
+		/// @note The AudioManager's default is resolved on creation so it always names the decoder that the Source uses.
+		VorbisDecoder vorbisDecoder;
 		/// @brief Current data provided by the buffer.
 		hstream stream;
+		/// @brief Audio data owned by the Source that is used instead of the stream when no copy is needed.
+		/// @note It is shared by all bound Players and only dropped once no Players are bound anymore.
+		const unsigned char* viewData;
+		/// @brief Byte-size of viewData.
+		int viewSize;
+		/// @brief Memory-mapped file from the disk cache that viewData points into.
+		MappedFile* diskCacheFile;
 		/// @brief Flag for whether an asynchronous load was queued.
 		bool asyncLoadQueued;
 		/// @brief Flag for whether asynchronously loaded data should be discarded.
 		bool asyncLoadDiscarded;
+		/// @brief Flag for whether an async decoder worker is currently loading the data.
+		/// @note Prevents the same Buffer from being loaded twice when it's queued again while it's still being loaded.
+		bool asyncLoadRunning;
 		/// @brief Mutex for access of asynchronously loaded data.
 		hmutex asyncLoadMutex;
+		/// @brief Load state that is shared with waiting threads and the audio-system.
+		AsyncLoadState* asyncLoad;
+		/// @brief Called whenever an asynchronous load finishes.
+		void (*asyncLoadCallback)(Buffer*, bool, void*);
+		/// @brief User data passed to asyncLoadCallback.
+		void* asyncLoadCallbackData;
+		/// @brief Byte-size of the progressively loaded data that is required before playback can start.
+		int progressiveLeadSize;
 		/// @brief Connected Source from which data is read.
 		Source* source;
 		/// @brief Whether meta-data has been loaded.
@@ -134,11 +193,36 @@ namespace xal
 		int bitsPerSample;
 		/// @brief Duration of the audio data in seconds.
 		float duration;
+		/// @brief Whether the Source's float samples are used without conversion.
+		bool floatData;
 		/// @brief List of bound Player instances.
 		/// @note This is mainly needed for discarding unused Buffers/Sources.
 		harray<Player*> boundPlayers;
 		/// @brief How much time has passed since the last access of this buffer (in seconds).
 		float idleTime;
+		/// @brief Persistent memory into which a streamed Buffer's chunks are loaded and converted.
+		/// @note It is only reallocated if a larger chunk is requested so steady-state streaming doesn't allocate.
+		unsigned char* chunkData;
+		/// @brief Byte-size of chunkData.
+		int chunkCapacity;
+		/// @brief Converter of a streamed Buffer that keeps its state from one chunk to the next.
+		/// @note NULL if the audio-system doesn't require a conversion.
+		Converter* converter;
+		/// @brief Persistent memory into which a streamed Buffer's chunks are converted.
+		unsigned char* convertedData;
+		/// @brief Byte-size of convertedData.
+		int convertedCapacity;
+		/// @brief State of the streaming service for this Buffer.
+		ReadAhead* readAhead;
+		/// @brief Decoder shared with other Buffers of the same Sound.
+		/// @note NULL if the streamed Buffer always decodes on its own.
+		SharedStream* sharedStream;
+		/// @brief Absolute byte-position of this Buffer within the shared decoder's data.
+		int64_t sharedPosition;
+		/// @brief Absolute byte-position where this Buffer's pass through the shared decoder's data started.
+		int64_t sharedLoopStart;
+		/// @brief Whether the data currently comes from the shared decoder instead of the Buffer's own Source.
+		bool sharedAttached;
 		
 		/// @brief Updates the Buffer.
 		/// @param[in] timeDelta Time passed since the last update.
@@ -148,6 +232,82 @@ namespace xal
 		/// @brief Tries to free up memory.
 		/// @return True if any memory was freed.
 		bool _tryClearMemory();
+		/// @return True if the Buffer's data is managed by the decoded audio data cache.
+		/// @note This is the case for LAZY, MANAGED and ON_DEMAND Buffers.
+		bool _isCached();
+		/// @return The byte-size of decoded audio data that the Buffer keeps in memory.
+		int _getResidentSize();
+		/// @return True if the Buffer's data can be cleared by the cache.
+		/// @note Buffers with bound Players are pinned and never evicted.
+		bool _isEvictable();
+		/// @brief Tries to clear the Buffer's data to make room in the cache.
+		/// @return True if any memory was freed.
+		bool _tryEvict();
+		/// @brief Loads all audio data from the opened Source and closes it afterwards.
+		/// @note If the Source's data can be used as it is, it is not copied into the stream.
+		void _loadFromSource();
+		/// @return True if the Buffer's data should be decoded progressively.
+		bool _isProgressiveLoadEnabled();
+		/// @brief Decodes all audio data from the opened Source in chunks and publishes each chunk right away.
+		/// @param[in] lock The lock on asyncLoadMutex. It is released while decoding and acquired again afterwards.
+		/// @return False if the data can be loaded right away and progressive loading isn't needed.
+		/// @note This is called from an async decoder worker. The Source is closed afterwards.
+		bool _loadProgressively(hmutex::ScopeLock& lock);
+		/// @brief Drops the view of audio data that is not owned by the stream.
+		void _releaseView();
+		/// @brief Creates the filename and the key of the Buffer's entry in the disk cache.
+		/// @param[out] key Key that identifies the source file and the output format.
+		/// @return The filename of the entry or an empty string if the disk cache is not used for this Buffer.
+		hstr _makeDiskCacheFilename(hstr& key);
+		/// @brief Tries to use already decoded audio data from the disk cache.
+		/// @return True if the data was found in the disk cache.
+		/// @note The entry also holds the meta data so the Source doesn't have to be opened at all.
+		bool _loadFromDiskCache();
+		/// @brief Stores the decoded audio data in the disk cache.
+		void _saveToDiskCache();
+
+		/// @return True if a streamed Buffer can provide data, either from its own Source or from the shared decoder.
+		bool _isStreamOpen();
+		/// @brief Moves the Source or the position within the shared decoder back to the beginning of the audio data.
+		/// @note While the streaming service is used, only the thread that decodes may call this.
+		void _rewindSource();
+		/// @brief Tries to read from the shared decoder starting at the beginning of the audio data.
+		/// @return True if the shared decoder is used.
+		bool _attachShared();
+		/// @brief Stops reading from the shared decoder.
+		void _detachShared();
+		/// @brief Switches from the shared decoder to the Buffer's own Source at the same position.
+		/// @note This is used when the Buffer fell behind the shared decoder's window. If the Source cannot seek, it decodes up to the position again and output is used as scratch space.
+		void _fallBackFromShared(unsigned char* output, int size);
+		/// @brief Makes sure that chunkData and convertedData can hold a chunk of the given size.
+		/// @param[in] size The byte-size of the loaded chunk.
+		/// @param[in] convertedSize The byte-size of the converted chunk.
+		void _reserveChunk(int size, int convertedSize);
+		/// @brief Frees chunkData and convertedData.
+		void _releaseChunk();
+		/// @brief Reads a chunk of audio data from the Source directly into memory.
+		/// @param[out] output Memory where the data will be stored.
+		/// @param[in] size The maximum number of bytes to read.
+		/// @param[in] looping Whether the Source is rewound when its end is reached.
+		/// @param[out] ended Whether the end of the Source was reached.
+		/// @return The number of bytes read.
+		int _readChunk(unsigned char* output, int size, bool looping, bool* ended);
+		/// @brief Registers the streamed Buffer with the streaming service.
+		/// @param[in] size The byte-size that the ring has to be able to hold at least.
+		/// @return True if the streaming service is used for this Buffer.
+		bool _startReadAhead(int size);
+		/// @brief Unregisters the streamed Buffer from the streaming service and discards data that was decoded ahead.
+		void _stopReadAhead();
+		/// @brief Decodes data from the Source into the ring.
+		/// @param[in] size The maximum number of bytes to decode. A value of 0 fills the ring.
+		/// @return The number of bytes decoded.
+		/// @note This is called from the streaming service thread. The ring is only locked while data is published.
+		int _decodeAhead(int size = 0);
+		/// @brief Moves data that was decoded ahead into chunkData.
+		/// @param[in] size The number of bytes to load.
+		/// @return The number of bytes loaded.
+		/// @note Missing data is counted as an underrun and replaced with silence so playback doesn't stop.
+		int _loadFromReadAhead(int size);
 
 		/// @brief Loads the async data from the disk into a stream.
 		/// @return True if there is a stream ready. False if loading was canceled in the meantime.
@@ -156,9 +316,23 @@ namespace xal
 		/// @param[in] stream The stream from which to decode the data.
 		void _decodeFromAsyncStream();
 		/// @brief Waits for the Buffer to load asynchronously.
-		/// @param[in] timeout Max time to wait.
-		/// @note A timeout value of 0.0 means indefinitely.
-		void _waitForAsyncLoad(float timeout = 0.0f);
+		/// @param[in] timeout Maximum time to wait in seconds. A value of 0 waits indefinitely.
+		/// @param[in] playable Whether progressively loaded data only has to be playable instead of complete.
+		/// @return True if the data is loaded or playable.
+		bool _waitForAsyncLoad(float timeout, bool playable);
+		/// @brief Wakes up all threads that wait for the asynchronous load.
+		/// @note asyncLoadMutex must not be locked by the calling thread.
+		void _signalAsyncLoad();
+		/// @brief Clears asyncLoadRunning and wakes up the destructor if it's waiting for that.
+		/// @note asyncLoadMutex must not be locked by the calling thread. The Buffer may already be destroyed when this returns.
+		void _endAsyncLoadRun();
+		/// @brief Signals the end of an asynchronous load and calls the callback.
+		/// @param[in] loaded Whether the data was loaded.
+		/// @note asyncLoadMutex must not be locked by the calling thread.
+		void _finishAsyncLoad(bool loaded);
+		/// @brief Cancels a queued asynchronous load that will never be processed.
+		/// @note This is called when the async decoder pool is destroyed.
+		void _cancelAsyncLoad();
 
 	};
 
@@ -38,6 +38,30 @@ namespace xal
 		void setGain(float value);
 		HL_DEFINE_GET(BufferMode, bufferMode, BufferMode);
 		HL_DEFINE_GET(SourceMode, sourceMode, SourceMode);
+		/// @brief Priority of managed Players in this Category when the AudioManager runs out of voices.
+		/// @note Players with a higher priority steal voices from Players with a lower priority.
+		HL_DEFINE_GETSET(int, priority, Priority);
+		HL_DEFINE_GET(int, streamBufferCount, StreamBufferCount);
+		/// @brief Sets the number of stream-buffers used by streamed Sounds in this Category.
+		/// @param[in] value Number of stream-buffers. A value of 0 uses the AudioManager's default.
+		/// @note Only Players created afterwards are affected.
+		void setStreamBufferCount(int value);
+		HL_DEFINE_GET(int, streamBufferSize, StreamBufferSize);
+		/// @brief Sets the byte-size of a single stream-buffer used by streamed Sounds in this Category.
+		/// @param[in] value Byte-size of a stream-buffer. A value of 0 uses the AudioManager's default.
+		/// @note The value is rounded the same way as in AudioManager::setStreamBufferSize().
+		/// @note Only Players created afterwards are affected.
+		void setStreamBufferSize(int value);
+		HL_DEFINE_IS(streamShared, StreamShared);
+		/// @brief Sets whether Players of the same streamed Sound in this Category share a single decoder.
+		/// @param[in] value Whether the decoder is shared.
+		/// @note Players that are too far apart from the others still decode on their own. Only Players created afterwards are affected.
+		void setStreamShared(bool value);
+		HL_DEFINE_GET(VorbisDecoder, vorbisDecoder, VorbisDecoder);
+		/// @brief Sets the decoder for Ogg Vorbis files in this Category.
+		/// @param[in] value The decoder. VORBIS_DEFAULT uses the AudioManager's default.
+		/// @note Only Sounds and Players created afterwards are affected.
+		void setVorbisDecoder(VorbisDecoder value);
 		/// @return True if Sounds in this Category are streamed.
 		bool isStreamed();
 		/// @return True if Sounds in this Category have their data managed by the system.
@@ -52,6 +76,19 @@ namespace xal
 		BufferMode bufferMode;
 		/// @brief sourceMode How to handle the Source of the Sound.
 		SourceMode sourceMode;
+		/// @brief Voice priority of managed Players.
+		int priority;
+		/// @brief Number of stream-buffers for streamed Sounds.
+		/// @note A value of 0 means that the AudioManager's default is used.
+		int streamBufferCount;
+		/// @brief Byte-size of a single stream-buffer for streamed Sounds.
+		/// @note A value of 0 means that the AudioManager's default is used.
+		int streamBufferSize;
+		/// @brief Whether Players of the same streamed Sound share a single decoder.
+		bool streamShared;
+		/// @brief Decoder for Ogg Vorbis files.
+		/// @note VORBIS_DEFAULT means that the AudioManager's default is used.
+		VorbisDecoder vorbisDecoder;
 		
 	};
 
@@ -0,0 +1,84 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Provides a float mixing bus for software mixing.
+
+#ifndef XAL_MIX_BUS_H
+#define XAL_MIX_BUS_H
+
+#include <hltypes/hltypesUtil.h>
+
+#include "xalExport.h"
+
+namespace xal
+{
+	/// @brief Accumulates any number of voices in float and converts them to the output format in a single pass.
+	/// @note This class has no dependency on any audio system so it can be driven manually for offline rendering and benchmarking.
+	class xalExport MixBus
+	{
+	public:
+		/// @brief Constructor.
+		MixBus();
+		/// @brief Destructor.
+		~MixBus();
+
+		/// @brief Gets the number of samples in the current block.
+		HL_DEFINE_GET(int, size, Size);
+		/// @brief Gets the number of interleaved channels in the current block.
+		HL_DEFINE_GET(int, channels, Channels);
+		/// @brief Whether triangular dither is applied in the final conversion.
+		HL_DEFINE_ISSET(dither, Dither);
+		/// @brief Gets the float accumulator of the current block.
+		inline const float* getBuffer() const { return this->buffer; }
+
+		/// @brief Starts a new block with silence.
+		/// @param[in] count Number of samples in the block.
+		/// @param[in] channels Number of interleaved channels in the block.
+		void begin(int count, int channels);
+		/// @brief Adds 16 bit samples to the current block.
+		/// @param[in] offset Sample offset in the block.
+		/// @param[in] data The 16 bit samples.
+		/// @param[in] count Number of samples.
+		/// @param[in] gain Gain applied to the first frame.
+		/// @param[in] gainStep Gain change from one frame to the next.
+		/// @note The offset has to be at a frame boundary.
+		void add(int offset, const short* data, int count, float gain, float gainStep = 0.0f);
+		/// @brief Adds float samples to the current block.
+		/// @param[in] offset Sample offset in the block.
+		/// @param[in] data The float samples that range from -1 to 1.
+		/// @param[in] count Number of samples.
+		/// @param[in] gain Gain applied to the first frame.
+		/// @param[in] gainStep Gain change from one frame to the next.
+		/// @note The offset has to be at a frame boundary.
+		/// @note Samples outside of the range are not clipped until the block is converted.
+		void add(int offset, const float* data, int count, float gain, float gainStep = 0.0f);
+		/// @brief Converts the current block to 16 bit samples.
+		/// @param[out] output The 16 bit output samples. Has to have space for at least getSize() samples.
+		void finish(short* output);
+
+	protected:
+		/// @brief The float accumulator.
+		float* buffer;
+		/// @brief Capacity of the accumulator in samples.
+		int capacity;
+		/// @brief Number of samples in the current block.
+		int size;
+		/// @brief Number of interleaved channels in the current block.
+		int channels;
+		/// @brief Whether triangular dither is applied in the final conversion.
+		bool dither;
+		/// @brief Current position in the dither noise table.
+		int ditherOffset;
+
+	};
+
+}
+
+#endif
@@ -24,7 +24,9 @@ namespace xal
 {
 	class AudioManager;
 	class Buffer;
+	class Command;
 	class Category;
+	class PlayerState;
 	class Sound;
 
 	/// @brief Provides audio playback functionality.
@@ -58,6 +60,11 @@ namespace xal
 		bool isFadingIn();
 		bool isFadingOut();
 		HL_DEFINE_IS(looping, Looping);
+		/// @return True if the Player is a virtual voice that currently has no voice in the audio-system.
+		/// @note Only managed Players become virtual when the AudioManager runs out of voices.
+		HL_DEFINE_IS(virtualized, Virtual);
+		HL_DEFINE_GET(int, streamBufferCount, StreamBufferCount);
+		HL_DEFINE_GET(int, streamBufferSize, StreamBufferSize);
 
 		/// @brief Starts playing the Sound.
 		/// @param[in] fadetime How long to fade-in the Sound.
@@ -103,6 +110,12 @@ namespace xal
 		/// @brief The index of the current stream-buffer.
 		/// @note Used usually only with streamed Sounds.
 		int bufferIndex;
+		/// @brief Number of stream-buffers.
+		/// @note Taken from the Category when the Player is created.
+		int streamBufferCount;
+		/// @brief Byte-size of a single stream-buffer.
+		/// @note Taken from the Category when the Player is created.
+		int streamBufferSize;
 		/// @brief How many bytes have been processed during the last update.
 		int processedByteCount;
 		/// @brief How long this Player has been idle.
@@ -112,6 +125,21 @@ namespace xal
 		bool asyncPlayQueued;
 		/// @brief Mutex for access of async playing flag.
 		hmutex asyncPlayMutex;
+		/// @brief Whether the Player is a virtual voice without a voice in the audio-system.
+		bool virtualized;
+		/// @brief Time position of a virtual voice that keeps advancing while it is virtual.
+		float virtualTime;
+		/// @brief Order in which Players were started.
+		/// @note Used for stealing the oldest voice and for finding the oldest instance of a Sound.
+		unsigned int playOrder;
+		/// @brief Index in the AudioManager's list of Players for constant time removal.
+		int playerIndex;
+		/// @brief Index in the AudioManager's list of managed Players for constant time removal.
+		/// @note This is -1 if the Player isn't managed.
+		int managedIndex;
+		/// @brief State as last seen by the update thread.
+		/// @note Used for lock-free reading when the AudioManager defers Commands.
+		PlayerState* publishedState;
 
 		/// @brief Constructor.
 		/// @param[in] sound The Sound to play.
@@ -127,6 +155,8 @@ namespace xal
 		float _getPitch();
 		/// @note This method is not thread-safe and is for internal usage only.
 		void _setPitch(float value);
+		/// @note This method is not thread-safe and is for internal usage only.
+		unsigned int _getSamplePosition();
 		/// @brief Returns whether the Sound is playing or is asynchronously queued for playing.
 		/// @retunr True if the Sound is playing or is asynchronously queued for playing.
 		/// @note This method is not thread-safe and is for internal usage only.
@@ -150,8 +180,30 @@ namespace xal
 		/// @note This method is not thread-safe and is for internal usage only.
 		void _pause(float fadeTime = 0.0f);
 
+		/// @brief Resets the Player to the state of a newly created one so it can be recycled.
+		/// @note The Player has to be stopped already.
+		/// @note The Player gets a new start order when it's played again.
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _reset();
+		/// @brief Releases the voice in the audio-system while the play position keeps advancing.
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _virtualize();
+		/// @brief Gets a voice in the audio-system again and continues playing at the advanced position.
+		/// @return False if the audio-system could not provide a voice and the Player remains virtual.
+		/// @note Streamed Sounds cannot seek so they continue where they were virtualized.
+		/// @note This method is not thread-safe and is for internal usage only.
+		bool _realize();
+		/// @return True if a non-looping virtual voice would have finished playing by now.
+		/// @note This method is not thread-safe and is for internal usage only.
+		bool _isVirtualFinished();
+
 		/// @return The current gain for the Sound depending on global gain, category gain and Player gain.
 		float _calcGain();
+		/// @return The byte-size of all stream-buffers together.
+		inline int _getStreamBufferBytes() { return (this->streamBufferCount * this->streamBufferSize); }
+		/// @brief Publishes the frequently read state for lock-free access from other threads.
+		/// @note This method is not thread-safe and is for internal usage only.
+		void _publishState();
 
 		/// @brief Whether the Sound is actually playing.
 		/// @note This is implemented by the audio-system.
@@ -168,6 +220,11 @@ namespace xal
 		/// @brief Sets offset within the buffer.
 		/// @note This is implemented by the audio-system.
 		inline virtual void _systemSetOffset(float value) { }
+		/// @brief Converts a time position to the offset unit used by _systemGetOffset() and _systemSetOffset().
+		/// @param[in] time Time position in seconds.
+		/// @return The offset.
+		/// @note This is implemented by the audio-system. The default uses sample frames.
+		virtual float _systemTimeToOffset(float time);
 		/// @brief Prepares the Player for playback.
 		/// @return True if successful.
 		/// @note This is implemented by the audio-system.
@@ -195,6 +252,9 @@ namespace xal
 		/// @return How many bytes have been played since the last update.
 		/// @note This is implemented by the audio-system.
 		inline virtual int _systemUpdateStream() { return 0; }
+		/// @brief Resets the audio-system state to the one of a newly created Player when the Player is recycled.
+		/// @note This is implemented by the audio-system.
+		inline virtual void _systemReset() { }
 
 	private:
 		/// @brief Internal implementation for actually stopping the playback.
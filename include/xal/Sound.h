@@ -23,6 +23,8 @@ namespace xal
 {
 	class Buffer;
 	class Category;
+	class MappedFile;
+	class SharedStream;
 
 	/// @brief Provides audio data definition.
 	class xalExport Sound
@@ -40,6 +42,9 @@ namespace xal
 		HL_DEFINE_GET(hstr, filename, Filename);
 		HL_DEFINE_GET(Category*, category, Category);
 		HL_DEFINE_GET(Buffer*, buffer, Buffer);
+		/// @brief Maximum number of managed Players of this Sound at the same time, including virtual ones.
+		/// @note When exceeded, the oldest instance is stopped. A value of 0 means no limit.
+		HL_DEFINE_GETSET(int, maxInstances, MaxInstances);
 
 		/// @return Byte-size of the audio data.
 		int getSize();
@@ -65,6 +70,15 @@ namespace xal
 		/// @note If the underlying Source does not provide data as PCM, it will always be converted to PCM.
 		void readPcmData(hstream& output);
 
+		/// @brief Gets the decoder that is shared by the Players of this Sound and creates it if needed.
+		/// @return The shared decoder.
+		/// @note This method is for internal usage only.
+		SharedStream* _getSharedStream();
+		/// @brief Gets the encoded file that is kept in memory for the Players of this Sound and reads it if needed.
+		/// @return The file in memory.
+		/// @note This method is for internal usage only.
+		MappedFile* _getResidentFile();
+
 	protected:
 		/// @brief Name of the Sound.
 		hstr name;
@@ -74,6 +88,14 @@ namespace xal
 		Category* category;
 		/// @brief Buffer instance that handles decoded data.
 		Buffer* buffer;
+		/// @brief Maximum number of managed Players at the same time.
+		int maxInstances;
+		/// @brief Decoder shared by the Players of a streamed Sound.
+		/// @note NULL until it is needed the first time.
+		SharedStream* sharedStream;
+		/// @brief Encoded file kept in memory for a Sound in COMPRESSED mode.
+		/// @note NULL until it is needed the first time.
+		MappedFile* residentFile;
 
 	};
 
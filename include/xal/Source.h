@@ -23,6 +23,7 @@
 namespace xal
 {
 	class Category;
+	class MappedFile;
 
 	/// @brief Represents an audio data source.
 	class xalExport Source
@@ -45,6 +46,7 @@ namespace xal
 		HL_DEFINE_GET(int, samplingRate, SamplingRate);
 		HL_DEFINE_GET(int, bitsPerSample, BitsPerSample);
 		HL_DEFINE_GET(float, duration, Duration);
+		HL_DEFINE_IS(floatOutput, FloatOutput);
 		int getRamSize();
 
 		/// @brief Opens the Source for reading.
@@ -54,6 +56,11 @@ namespace xal
 		virtual void close();
 		/// @brief Rewinds the Source's audio data to the beginning.
 		virtual void rewind();
+		/// @brief Moves the read position of the Source's audio data to a sample frame.
+		/// @param[in] sample Index of the sample frame.
+		/// @return True if successful. False if the Source cannot seek or the position is invalid.
+		/// @note The default implementation cannot seek.
+		virtual bool seek(int64_t sample);
 		/// @brief Loads all audio data.
 		/// @param[out] output Data stream where all data will be stored.
 		/// @return True if data was successfully read.
@@ -63,7 +70,69 @@ namespace xal
 		/// @param[out] size Maximum byte-size of data to read.
 		/// @return Number of bytes read.
 		virtual int loadChunk(hstream& output, int size = STREAM_BUFFER_SIZE);
-		
+		/// @brief Loads a chunk of audio data directly into memory owned by the caller.
+		/// @param[out] output Memory where the data will be stored. Has to be large enough for size bytes.
+		/// @param[in] size Maximum byte-size of data to read.
+		/// @return Number of bytes read.
+		/// @note Unlike loadChunk(), this never allocates memory so it can be used on the streaming path.
+		/// @note The default implementation reads nothing, Sources that can be streamed have to override it.
+		virtual int loadChunkRaw(unsigned char* output, int size);
+		/// @brief Loads a chunk of audio data as float samples with a separate plane for each channel.
+		/// @param[out] output One pointer per channel to memory where the channel's samples will be stored. Each has to be large enough for frames samples.
+		/// @param[in] frames Maximum number of sample frames to read.
+		/// @return Number of sample frames read.
+		/// @note This works regardless of the float output setting, but only if _isFloatOutputSupported() returns true.
+		virtual int loadChunkPlanar(float** output, int frames);
+
+		/// @brief Reads raw data from the underlying file.
+		/// @param[out] data Destination buffer.
+		/// @param[in] size Number of bytes to read.
+		/// @return Number of bytes read.
+		/// @note This method is for internal usage only.
+		int _readRaw(void* data, int size);
+		/// @brief Gets direct access to the underlying file's data without copying it.
+		/// @param[in] size Maximum number of bytes to access.
+		/// @param[out] available Number of bytes that can be accessed.
+		/// @return Pointer to the data or NULL if the file is not memory-mapped.
+		/// @note Advances the read position by the number of available bytes. This method is for internal usage only.
+		const unsigned char* _readView(int size, int* available);
+		/// @brief Seeks within the underlying file.
+		/// @param[in] offset Seek offset.
+		/// @param[in] seekMode Where to seek from.
+		/// @note This method is for internal usage only.
+		void _seek(int64_t offset, hsbase::SeekMode seekMode = hsbase::CURRENT);
+		/// @brief Gets the current read position within the underlying file.
+		/// @return The current read position.
+		/// @note This method is for internal usage only.
+		int64_t _position();
+		/// @brief Checks whether the Source was opened for reading audio data.
+		/// @return True if the Source is open.
+		/// @note Logs an error if it's not. This method is for internal usage only.
+		bool _checkStreamOpen();
+		/// @brief Checks whether the end of the underlying file has been reached.
+		/// @return True if the end of the underlying file has been reached.
+		/// @note This method is for internal usage only.
+		bool _eof();
+		/// @brief Gets direct access to the complete decoded audio data if the Source keeps it in memory in a ready-to-use form.
+		/// @param[out] size Byte-size of the audio data.
+		/// @return Pointer to the audio data or NULL if the data has to be loaded.
+		/// @note The data stays valid after the Source is closed, until it is destroyed. This method is for internal usage only.
+		virtual const unsigned char* _getDataView(int* size);
+		/// @return True if the Source can provide 32 bit float samples directly from its decoder.
+		/// @note This method is for internal usage only.
+		virtual bool _isFloatOutputSupported();
+		/// @brief Sets whether the Source provides interleaved 32 bit float samples ranging from -1 to 1 instead of integer samples.
+		/// @param[in] value Whether the float samples are provided.
+		/// @note This has to be set before open() and is ignored if _isFloatOutputSupported() returns false. This method is for internal usage only.
+		void _setFloatOutput(bool value);
+		/// @return Number of heap allocations made by the decoder since the last call and resets the count.
+		/// @note This method is for internal usage only.
+		int _takeAllocations();
+		/// @brief Sets a file in memory that is read instead of opening the file on every open().
+		/// @param[in] residentFile The file in memory. It is not owned by the Source.
+		/// @note This method is for internal usage only.
+		void _setResidentFile(MappedFile* residentFile);
+
 	protected:
 		/// @brief Filename of the Source.
 		hstr filename;
@@ -83,8 +152,19 @@ namespace xal
 		int bitsPerSample;
 		/// @brief Length of the audio data in seconds.
 		float duration;
+		/// @brief Whether the audio data consists of 32 bit float samples.
+		bool floatOutput;
 		/// @brief The underlying audio data.
 		hsbase* stream;
+		/// @brief The memory-mapped file when using MMAP.
+		MappedFile* mappedFile;
+		/// @brief The current read position within mappedFile.
+		int mappedPosition;
+		/// @brief File in memory shared with other Sources that is used as mappedFile.
+		MappedFile* residentFile;
+		/// @brief Number of heap allocations made by the decoder since the last call of _takeAllocations().
+		/// @note Allocations inside third-party decoder libraries are not counted.
+		int allocations;
 
 	};
 
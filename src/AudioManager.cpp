@@ -5,8 +5,11 @@
 /// 
 /// This program is free software; you can redistribute it and/or modify it under
 /// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+#include <algorithm>
+
 #include <hltypes/harray.h>
 #include <hltypes/hexception.h>
+#include <hltypes/hdir.h>
 #include <hltypes/hfile.h>
 #include <hltypes/hlog.h>
 #include <hltypes/hltypesUtil.h>
@@ -20,7 +23,11 @@
 #include "AudioManager.h"
 #include "Buffer.h"
 #include "BufferAsync.h"
+#include "BufferStream.h"
 #include "Category.h"
+#include "CommandQueue.h"
+#include "Converter.h"
+#include "Mixer.h"
 #include "NoAudio_AudioManager.h"
 #include "Player.h"
 #include "Sound.h"
@@ -33,6 +40,9 @@
 #ifdef _FORMAT_OGG
 #include "OGG_Source.h"
 #endif
+#ifdef _FORMAT_OGG_TREMOR
+#include "OGG_Tremor_Source.h"
+#endif
 #ifdef _FORMAT_SPX
 #include "SPX_Source.h"
 #endif
@@ -40,25 +50,50 @@
 #include "WAV_Source.h"
 #endif
 
+#define COMMAND_QUEUE_SIZE 1024
+#define PLAYER_POOL_SIZE 16 // per Sound
+#define MAX_INSTANCES_FADE_TIME 0.05f // in seconds, avoids clicks when an instance over the limit is stopped
+#define CACHE_UPDATE_INTERVAL 1.0f // in seconds, catches loads that finished in other threads
+
 namespace xal
 {
 	extern void (*gLogFunction)(chstr);
 	
 	AudioManager* manager = NULL;
 
-	AudioManager::AudioManager(void* backendId, bool threaded, float updateTime, chstr deviceName) :
-		enabled(false), suspended(false), idlePlayerUnloadTime(60.0f), globalGain(1.0f), thread(NULL), threadRunning(false)
+	static bool _compareVirtualVoices(const VoiceCandidate& a, const VoiceCandidate& b)
+	{
+		return (a.priority > b.priority || (a.priority == b.priority && a.rank > b.rank));
+	}
+
+	static bool _compareVoiceVictims(const VoiceCandidate& a, const VoiceCandidate& b)
 	{
+		return (a.priority < b.priority || (a.priority == b.priority && a.rank < b.rank));
+	}
+
+	AudioManager::AudioManager(void* backendId, bool threaded, float updateTime, chstr deviceName) :
+		enabled(false), suspended(false), idlePlayerUnloadTime(60.0f), globalGain(1.0f), thread(NULL), threadRunning(false),
+		deferredCommands(false), maxVoices(0), voiceStealMode(QUIETEST), activeVoices(0), playCounter(0),
+		streamBufferCount(STREAM_BUFFER_COUNT), streamBufferSize(STREAM_BUFFER_SIZE),
+		streamReadAheadTime(STREAM_READ_AHEAD_TIME),
+		progressiveLoadLeadTime(PROGRESSIVE_LOAD_LEAD_TIME), vorbisDecoder(VORBIS_DEFAULT), cacheBudget(0),
+		cacheUpdateRequired(false), cacheUpdateTime(0.0f)
+	{
+		this->commandQueue = new CommandQueue(COMMAND_QUEUE_SIZE);
+		BufferAsync::initialize();
+		// selected once up front, before any worker thread creates a Converter
+		Mixer::initialize();
 		this->samplingRate = 44100;
 		this->channels = 2;
 		this->bitsPerSample = 16;
 		this->backendId = backendId;
 		this->deviceName = deviceName;
 		this->updateTime = updateTime;
+		this->setVorbisDecoder(VORBIS_DEFAULT);
 #ifdef _FORMAT_FLAC
 		this->extensions += ".flac";
 #endif
-#ifdef _FORMAT_OGG
+#if defined(_FORMAT_OGG) || defined(_FORMAT_OGG_TREMOR)
 		this->extensions += ".ogg";
 #endif
 #ifdef _FORMAT_SPX
@@ -79,6 +114,7 @@ namespace xal
 		{
 			delete this->thread;
 		}
+		delete this->commandQueue;
 	}
 
 	void AudioManager::init()
@@ -94,9 +130,140 @@ namespace xal
 	{
 		hlog::write(logTag, "Starting audio update thread.");
 		this->threadRunning = true;
+		this->_updateCommandQueueActive();
 		this->thread->start();
 	}
 
+	void AudioManager::setDeferredCommands(bool value)
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		this->deferredCommands = value;
+		this->_updateCommandQueueActive();
+	}
+
+	void AudioManager::_updateCommandQueueActive()
+	{
+		bool active = (this->deferredCommands && this->threadRunning);
+		if (active == this->commandQueue->isActive())
+		{
+			return;
+		}
+		this->commandQueue->setActive(active);
+		if (active)
+		{
+			// Players only publish what can have changed since the last time, so everything is published once up front
+			foreach (Player*, it, this->players)
+			{
+				(*it)->publishedState->samplePosition = (*it)->_getSamplePosition();
+				(*it)->_publishState();
+			}
+		}
+	}
+
+	bool AudioManager::_isCommandQueueActive()
+	{
+		return this->commandQueue->isActive();
+	}
+
+	bool AudioManager::_queueCommand(const Command& command)
+	{
+		if (!command.isValid() || !this->commandQueue->isActive())
+		{
+			return false;
+		}
+		if (command.player != NULL)
+		{
+			// counted before pushing, because the update thread could execute the Command right away
+			++command.player->publishedState->pendingCommands;
+		}
+		if (!this->commandQueue->push(command))
+		{
+			if (command.player != NULL)
+			{
+				--command.player->publishedState->pendingCommands;
+			}
+			return false;
+		}
+		return true;
+	}
+
+	void AudioManager::_processCommands()
+	{
+		Command command;
+		while (this->commandQueue->pop(command))
+		{
+			this->_executeCommand(command);
+		}
+	}
+
+	void AudioManager::_executeCommand(const Command& command)
+	{
+		switch (command.type)
+		{
+		case Command::PLAY:
+		case Command::PLAY_ASYNC:
+			// a deferred call cannot throw back to the caller so it is validated here
+			if (!this->sounds.hasKey(command.name))
+			{
+				hlog::error(logTag, "Cannot play, Sound '" + hstr(command.name) + "' does not exist!");
+				break;
+			}
+			if (command.type == Command::PLAY)
+			{
+				this->_play(command.name, command.fadeTime, command.looping, command.value);
+			}
+			else
+			{
+				this->_playAsync(command.name, command.fadeTime, command.looping, command.value);
+			}
+			break;
+		case Command::STOP:
+			this->_stop(command.name, command.fadeTime);
+			break;
+		case Command::STOP_FIRST:
+			this->_stopFirst(command.name, command.fadeTime);
+			break;
+		case Command::STOP_ALL:
+			this->_stopAll(command.fadeTime);
+			break;
+		case Command::STOP_CATEGORY:
+			if (!this->categories.hasKey(command.name))
+			{
+				hlog::error(logTag, "Cannot stop, Category '" + hstr(command.name) + "' does not exist!");
+				break;
+			}
+			this->_stopCategory(command.name, command.fadeTime);
+			break;
+		case Command::PLAYER_PLAY:
+			this->_assignPlayOrder(command.player);
+			command.player->_play(command.fadeTime, command.looping);
+			break;
+		case Command::PLAYER_PLAY_ASYNC:
+			this->_assignPlayOrder(command.player);
+			command.player->_playAsync(command.fadeTime, command.looping);
+			break;
+		case Command::PLAYER_STOP:
+			command.player->_stop(command.fadeTime);
+			break;
+		case Command::PLAYER_PAUSE:
+			command.player->_pause(command.fadeTime);
+			break;
+		case Command::PLAYER_SET_GAIN:
+			command.player->_setGain(command.value);
+			break;
+		case Command::PLAYER_SET_PITCH:
+			command.player->_setPitch(command.value);
+			break;
+		default:
+			break;
+		}
+		if (command.player != NULL)
+		{
+			--command.player->publishedState->pendingCommands;
+			command.player->_publishState();
+		}
+	}
+
 	void AudioManager::clear()
 	{
 		hmutex::ScopeLock lock(&this->mutex);
@@ -104,6 +271,7 @@ namespace xal
 		{
 			hlog::write(logTag, "Stopping audio update thread.");
 			this->threadRunning = false;
+			this->_updateCommandQueueActive();
 			lock.release();
 			this->thread->join();
 			lock.acquire(&this->mutex);
@@ -113,7 +281,10 @@ namespace xal
 			delete this->thread;
 			this->thread = NULL;
 		}
+		this->_processCommands();
 		this->_update(0.0f);
+		BufferAsync::destroy();
+		BufferStream::destroy();
 		foreach (Player*, it, this->players)
 		{
 			(*it)->_stop();
@@ -121,6 +292,8 @@ namespace xal
 		}
 		this->players.clear();
 		this->managedPlayers.clear();
+		this->soundPlayers.clear();
+		this->_clearPlayerPools();
 		foreach_m (Sound*, it, this->sounds)
 		{
 			delete it->second;
@@ -148,6 +321,252 @@ namespace xal
 		}
 	}
 
+	int AudioManager::getAsyncDecoderCount()
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		return BufferAsync::getWorkerCount();
+	}
+
+	void AudioManager::setAsyncDecoderCount(int value)
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		BufferAsync::setWorkerCount(value);
+	}
+
+	void AudioManager::setMaxVoices(int value)
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		this->_setMaxVoices(value);
+	}
+
+	void AudioManager::_setMaxVoices(int value)
+	{
+		this->maxVoices = hmax(value, 0);
+		this->activeVoices = this->_countActiveVoices();
+		if (this->maxVoices > 0)
+		{
+			Player* player = NULL;
+			while (this->activeVoices > this->maxVoices)
+			{
+				player = this->_findVoiceToSteal(0x7FFFFFFF, 1.0f, NULL, false);
+				if (player == NULL) // only manually created Players are left
+				{
+					break;
+				}
+				player->_virtualize();
+				--this->activeVoices;
+			}
+		}
+	}
+
+	int AudioManager::getActiveVoiceCount()
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		return this->_getActiveVoiceCount();
+	}
+
+	int AudioManager::_getActiveVoiceCount()
+	{
+		return this->activeVoices;
+	}
+
+	int AudioManager::_countActiveVoices()
+	{
+		int result = 0;
+		foreach (Player*, it, this->players)
+		{
+			if (!(*it)->virtualized && (*it)->_isPlaying())
+			{
+				++result;
+			}
+		}
+		return result;
+	}
+
+	int AudioManager::getVirtualVoiceCount()
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		return this->_getVirtualVoiceCount();
+	}
+
+	int AudioManager::_getVirtualVoiceCount()
+	{
+		int result = 0;
+		foreach (Player*, it, this->managedPlayers)
+		{
+			if ((*it)->virtualized)
+			{
+				++result;
+			}
+		}
+		return result;
+	}
+
+	void AudioManager::_assignPlayOrder(Player* player)
+	{
+		if (!player->paused && !player->_isPlaying())
+		{
+			player->playOrder = this->playCounter;
+			++this->playCounter;
+		}
+	}
+
+	bool AudioManager::_acquireVoice(Player* player)
+	{
+		this->_assignPlayOrder(player);
+		Sound* sound = player->getSound();
+		int maxInstances = sound->getMaxInstances();
+		if (maxInstances > 0)
+		{
+			// finished Players and those that are already fading out don't count as instances anymore
+			harray<Player*>& players = this->soundPlayers[sound];
+			int count = 0;
+			foreach (Player*, it, players)
+			{
+				if ((*it) != player && !(*it)->isFadingOut() && ((*it)->virtualized || (*it)->paused || (*it)->_isPlaying()))
+				{
+					++count;
+				}
+			}
+			// instances are stopped from the oldest on so each one is found after the one that was stopped last
+			Player* stopped = NULL;
+			Player* oldest = NULL;
+			for (; count >= maxInstances; --count)
+			{
+				oldest = NULL;
+				foreach (Player*, it, players)
+				{
+					if ((*it) != player && !(*it)->isFadingOut() && ((*it)->virtualized || (*it)->paused || (*it)->_isPlaying()) &&
+						(stopped == NULL || (*it)->playOrder > stopped->playOrder) && (oldest == NULL || (*it)->playOrder < oldest->playOrder))
+					{
+						oldest = (*it);
+					}
+				}
+				if (oldest == NULL)
+				{
+					break;
+				}
+				stopped = oldest;
+				// the Player is reclaimed by the pool once it has stopped, a virtual one has nothing to fade
+				if (!oldest->virtualized && oldest->_isPlaying())
+				{
+					oldest->_stop(MAX_INSTANCES_FADE_TIME);
+				}
+				else
+				{
+					oldest->_stop();
+				}
+			}
+		}
+		if (this->maxVoices <= 0 || this->activeVoices < this->maxVoices)
+		{
+			return true;
+		}
+		Player* victim = this->_findVoiceToSteal(sound->getCategory()->getPriority(), player->_calcGain(), player, false);
+		if (victim == NULL)
+		{
+			return false;
+		}
+		victim->_virtualize();
+		--this->activeVoices;
+		return true;
+	}
+
+	Player* AudioManager::_findVoiceToSteal(int priority, float gain, Player* exclude, bool lowerOnly)
+	{
+		Player* result = NULL;
+		int resultPriority = 0;
+		int currentPriority = 0;
+		// manually created Players are owned by the user and are never stolen from
+		foreach (Player*, it, this->managedPlayers)
+		{
+			if ((*it) == exclude || (*it)->virtualized || !(*it)->_isPlaying())
+			{
+				continue;
+			}
+			currentPriority = (*it)->sound->getCategory()->getPriority();
+			if (currentPriority > priority || (lowerOnly && currentPriority == priority))
+			{
+				continue;
+			}
+			if (result == NULL || currentPriority < resultPriority || (currentPriority == resultPriority &&
+				(this->voiceStealMode == QUIETEST ? (*it)->_calcGain() < result->_calcGain() : (*it)->playOrder < result->playOrder)))
+			{
+				result = (*it);
+				resultPriority = currentPriority;
+			}
+		}
+		// with the same priority a quieter Player doesn't get to interrupt a louder one
+		if (result != NULL && resultPriority == priority && this->voiceStealMode == QUIETEST && result->_calcGain() > gain)
+		{
+			return NULL;
+		}
+		return result;
+	}
+
+	void AudioManager::_updateVirtualVoices()
+	{
+		harray<VoiceCandidate>& candidates = this->virtualVoiceCandidates;
+		candidates.clear(); // clearing keeps the capacity
+		VoiceCandidate candidate;
+		foreach (Player*, it, this->managedPlayers)
+		{
+			if ((*it)->virtualized)
+			{
+				candidate.player = (*it);
+				candidate.priority = (*it)->sound->getCategory()->getPriority();
+				candidate.rank = (*it)->_calcGain();
+				candidates += candidate;
+			}
+		}
+		if (candidates.size() == 0)
+		{
+			return;
+		}
+		// highest priority and loudest first
+		std::sort(candidates.begin(), candidates.end(), &_compareVirtualVoices);
+		harray<VoiceCandidate>& victims = this->voiceVictims;
+		victims.clear();
+		bool victimsCollected = false;
+		int victimIndex = 0;
+		foreach (VoiceCandidate, it, candidates)
+		{
+			if (this->maxVoices > 0 && this->activeVoices >= this->maxVoices)
+			{
+				// collected only once it's needed, usually voices are available
+				if (!victimsCollected)
+				{
+					foreach (Player*, it2, this->managedPlayers)
+					{
+						if (!(*it2)->virtualized && (*it2)->_isPlaying())
+						{
+							candidate.player = (*it2);
+							candidate.priority = (*it2)->sound->getCategory()->getPriority();
+							candidate.rank = (this->voiceStealMode == QUIETEST ? (double)(*it2)->_calcGain() : (double)(*it2)->playOrder);
+							victims += candidate;
+						}
+					}
+					// lowest priority first, then quietest or oldest
+					std::sort(victims.begin(), victims.end(), &_compareVoiceVictims);
+					victimsCollected = true;
+				}
+				// voices are only stolen from lower priorities so this can't cycle
+				if (victimIndex >= victims.size() || victims[victimIndex].priority >= (*it).priority)
+				{
+					break;
+				}
+				victims[victimIndex].player->_virtualize();
+				++victimIndex;
+				--this->activeVoices;
+			}
+			if (!(*it).player->_realize()) // the audio-system ran out of voices
+			{
+				break;
+			}
+			++this->activeVoices;
+		}
+	}
+
 	harray<Player*> AudioManager::getPlayers()
 	{
 		hmutex::ScopeLock lock(&this->mutex);
@@ -156,7 +575,15 @@ namespace xal
 
 	harray<Player*> AudioManager::_getPlayers()
 	{
-		return (this->players - this->managedPlayers);
+		harray<Player*> result;
+		foreach (Player*, it, this->players)
+		{
+			if ((*it)->managedIndex < 0)
+			{
+				result += (*it);
+			}
+		}
+		return result;
 	}
 
 	hmap<hstr, Sound*> AudioManager::getSounds()
@@ -194,6 +621,7 @@ namespace xal
 
 	void AudioManager::_update(float timeDelta)
 	{
+		this->_processCommands();
 		if (this->enabled && !this->suspended)
 		{
 			BufferAsync::update();
@@ -205,19 +633,30 @@ namespace xal
 					(*it)->_play((*it)->fadeTime, (*it)->looping);
 				}
 			}
-			// creating a copy, because _destroyManagedPlayer alters managedPlayers
-			harray<Player*> players = this->managedPlayers;
-			foreach (Player*, it, players)
+			Player* player = NULL;
+			// iterating backwards, because _destroyManagedPlayer moves the last Player into the freed slot
+			for (int i = this->managedPlayers.size() - 1; i >= 0; --i)
 			{
-				if (!(*it)->_isPlaying() && !(*it)->isFadingOut())
+				player = this->managedPlayers[i];
+				// virtual voices are kept until they would have finished playing
+				if (player->virtualized ? player->_isVirtualFinished() : (!player->_isPlaying() && !player->isFadingOut()))
 				{
-					this->_destroyManagedPlayer(*it);
+					this->_destroyManagedPlayer(player);
 				}
 			}
+			// voices that were given up by the audio-system itself are only noticed here
+			this->activeVoices = this->_countActiveVoices();
+			this->_updateVirtualVoices();
 			foreach (Buffer*, it, this->buffers)
 			{
 				(*it)->_update(timeDelta);
 			}
+			// the resident data only changes when Buffers are loaded or released
+			this->cacheUpdateTime += timeDelta;
+			if (this->cacheUpdateRequired || this->cacheUpdateTime >= CACHE_UPDATE_INTERVAL)
+			{
+				this->_updateCache();
+			}
 		}
 	}
 
@@ -293,6 +732,7 @@ namespace xal
 	void AudioManager::destroySound(Sound* sound)
 	{
 		hmutex::ScopeLock lock(&this->mutex);
+		this->_processCommands(); // queued Commands may still reference what is being destroyed
 		this->_destroySound(sound);
 	}
 	
@@ -303,6 +743,8 @@ namespace xal
 			if (it->second == sound)
 			{
 				hlog::write(logTag, "Destroying sound: " + it->first);
+				this->_destroyManagedPlayers(sound);
+				this->_clearPlayerPool(sound);
 				delete it->second;
 				this->sounds.erase(it);
 				break;
@@ -313,6 +755,7 @@ namespace xal
 	void AudioManager::destroySoundsWithPrefix(chstr prefix)
 	{
 		hmutex::ScopeLock lock(&this->mutex);
+		this->_processCommands(); // queued Commands may still reference what is being destroyed
 		this->_destroySoundsWithPrefix(prefix);
 	}
 
@@ -330,18 +773,10 @@ namespace xal
 			}
 		}
 		harray<hstr> manualSoundNames;
-		harray<Player*> managedPlayers;
 		bool manual;
 		foreach (Sound*, it, destroySounds)
 		{
-			managedPlayers = this->managedPlayers;
-			foreach (Player*, it2, managedPlayers)
-			{
-				if ((*it2)->getSound() == (*it))
-				{
-					this->_destroyManagedPlayer(*it2);
-				}
-			}
+			this->_destroyManagedPlayers(*it);
 			manual = false;
 			foreach (Player*, it2, this->players)
 			{
@@ -355,6 +790,7 @@ namespace xal
 			if (!manual)
 			{
 				this->sounds.removeValue(*it);
+				this->_clearPlayerPool(*it);
 				delete (*it);
 			}
 		}
@@ -423,6 +859,7 @@ namespace xal
 		}
 		Sound* sound = this->sounds[soundName];
 		Player* player = this->_createSystemPlayer(sound);
+		player->playerIndex = this->players.size();
 		this->players += player;
 		return player;
 	}
@@ -430,27 +867,301 @@ namespace xal
 	void AudioManager::destroyPlayer(Player* player)
 	{
 		hmutex::ScopeLock lock(&this->mutex);
+		this->_processCommands(); // queued Commands may still reference what is being destroyed
 		this->_destroyPlayer(player);
 	}
 
 	void AudioManager::_destroyPlayer(Player* player)
 	{
 		player->_stop(); // removes players from suspendedPlayers as well
-		this->players -= player;
+		this->_removePlayer(player);
 		delete player;
 	}
 
 	Player* AudioManager::_createManagedPlayer(chstr name)
 	{
-		Player* player = this->_createPlayer(name);
+		if (!this->sounds.hasKey(name))
+		{
+			throw Exception("Audio Manager: Sound '" + name + "' does not exist!");
+		}
+		Sound* sound = this->sounds[name];
+		Player* player = NULL;
+		if (this->playerPool.hasKey(sound) && this->playerPool[sound].size() > 0)
+		{
+			player = this->playerPool[sound].removeLast();
+			player->_reset();
+		}
+		else
+		{
+			player = this->_createSystemPlayer(sound);
+		}
+		player->playerIndex = this->players.size();
+		this->players += player;
+		player->managedIndex = this->managedPlayers.size();
 		this->managedPlayers += player;
+		this->soundPlayers[sound] += player;
 		return player;
 	}
 
 	void AudioManager::_destroyManagedPlayer(Player* player)
 	{
-		this->managedPlayers -= player;
-		this->_destroyPlayer(player);
+		if (!player->virtualized && player->_isPlaying())
+		{
+			--this->activeVoices;
+		}
+		player->_stop(); // removes players from suspendedPlayers as well
+		this->_removePlayer(player);
+		harray<Player*>& pool = this->playerPool[player->sound];
+		if (pool.size() < PLAYER_POOL_SIZE)
+		{
+			pool += player;
+		}
+		else
+		{
+			delete player;
+		}
+	}
+
+	void AudioManager::_destroyManagedPlayers(Sound* sound)
+	{
+		Player* player = NULL;
+		// iterating backwards, because _destroyManagedPlayer moves the last Player into the freed slot
+		for (int i = this->managedPlayers.size() - 1; i >= 0; --i)
+		{
+			player = this->managedPlayers[i];
+			if (player->sound == sound)
+			{
+				this->_destroyManagedPlayer(player);
+			}
+		}
+		this->soundPlayers.erase(sound);
+	}
+
+	void AudioManager::_removePlayer(Player* player)
+	{
+		// swapping with the last element makes removal O(1)
+		Player* last = NULL;
+		if (player->managedIndex >= 0)
+		{
+			last = this->managedPlayers.removeLast();
+			if (last != player)
+			{
+				this->managedPlayers[player->managedIndex] = last;
+				last->managedIndex = player->managedIndex;
+			}
+			player->managedIndex = -1;
+			this->soundPlayers[player->sound] -= player;
+		}
+		if (player->playerIndex >= 0)
+		{
+			last = this->players.removeLast();
+			if (last != player)
+			{
+				this->players[player->playerIndex] = last;
+				last->playerIndex = player->playerIndex;
+			}
+			player->playerIndex = -1;
+		}
+	}
+
+	void AudioManager::_clearPlayerPool(Sound* sound)
+	{
+		if (this->playerPool.hasKey(sound))
+		{
+			foreach (Player*, it, this->playerPool[sound])
+			{
+				delete (*it);
+			}
+			this->playerPool.erase(sound);
+		}
+	}
+
+	void AudioManager::_clearPlayerPools()
+	{
+		foreach_m (harray<Player*>, it, this->playerPool)
+		{
+			foreach (Player*, it2, it->second)
+			{
+				delete (*it2);
+			}
+		}
+		this->playerPool.clear();
+	}
+
+	void AudioManager::setStreamBufferCount(int value)
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		this->streamBufferCount = hmax(value, 2);
+	}
+
+	void AudioManager::setStreamBufferSize(int value)
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		this->streamBufferSize = AudioManager::_roundStreamBufferSize(value);
+	}
+
+	int AudioManager::_roundStreamBufferSize(int value)
+	{
+		int result = STREAM_BUFFER_MIN_SIZE;
+		while (result < value && result < 0x40000000)
+		{
+			result <<= 1;
+		}
+		return result;
+	}
+
+	void AudioManager::setStreamReadAheadTime(float value)
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		this->streamReadAheadTime = hmax(value, 0.0f);
+	}
+
+	StreamStats AudioManager::getStreamStats()
+	{
+		hmutex::ScopeLock lock(&this->streamStatsMutex);
+		return this->streamStats;
+	}
+
+	void AudioManager::resetStreamStats()
+	{
+		hmutex::ScopeLock lock(&this->streamStatsMutex);
+		this->streamStats = StreamStats();
+	}
+
+	void AudioManager::_countStreamUnderrun(int bytes)
+	{
+		hmutex::ScopeLock lock(&this->streamStatsMutex);
+		++this->streamStats.underruns;
+		this->streamStats.underrunBytes += bytes;
+	}
+
+	void AudioManager::_countStreamAllocations(int count)
+	{
+		if (count <= 0) // avoids locking on every chunk
+		{
+			return;
+		}
+		hmutex::ScopeLock lock(&this->streamStatsMutex);
+		this->streamStats.allocations += count;
+	}
+
+	void AudioManager::_countStreamSharedFallback()
+	{
+		hmutex::ScopeLock lock(&this->streamStatsMutex);
+		++this->streamStats.sharedFallbacks;
+	}
+
+	void AudioManager::setProgressiveLoadLeadTime(float value)
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		this->progressiveLoadLeadTime = hmax(value, 0.0f);
+	}
+
+	void AudioManager::setVorbisDecoder(VorbisDecoder value)
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		if (value == VORBIS_DEFAULT)
+		{
+#ifdef _FORMAT_OGG
+			value = VORBIS_FLOAT;
+#else
+			value = VORBIS_INTEGER;
+#endif
+		}
+		this->vorbisDecoder = value;
+	}
+
+	void AudioManager::setCacheBudget(int64_t value)
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		this->_setCacheBudget(value);
+	}
+
+	void AudioManager::_setCacheBudget(int64_t value)
+	{
+		this->cacheBudget = hmax(value, (int64_t)0);
+		if (this->cacheBudget == 0) // without a budget, ON_DEMAND Buffers don't keep their data after usage anymore
+		{
+			foreach (Buffer*, it, this->buffers)
+			{
+				if ((*it)->mode == ON_DEMAND)
+				{
+					(*it)->_tryEvict();
+				}
+			}
+		}
+		this->_updateCache();
+	}
+
+	void AudioManager::setDiskCachePath(chstr value)
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		this->diskCachePath = value;
+		if (this->diskCachePath != "" && !hdir::exists(this->diskCachePath))
+		{
+			hdir::create(this->diskCachePath);
+		}
+	}
+
+	CacheStats AudioManager::getCacheStats()
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		return this->cacheStats;
+	}
+
+	void AudioManager::resetCacheStats()
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		this->cacheStats.hits = 0;
+		this->cacheStats.misses = 0;
+		this->cacheStats.evictions = 0;
+	}
+
+	void AudioManager::_updateCache()
+	{
+		this->cacheUpdateRequired = false;
+		this->cacheUpdateTime = 0.0f;
+		int64_t resident = 0;
+		int size = 0;
+		harray<Buffer*> candidates;
+		foreach (Buffer*, it, this->buffers)
+		{
+			if ((*it)->_isCached())
+			{
+				size = (*it)->_getResidentSize();
+				resident += size;
+				if (this->cacheBudget > 0 && size > 0 && (*it)->_isEvictable())
+				{
+					candidates += (*it);
+				}
+			}
+		}
+		if (this->cacheBudget > 0)
+		{
+			// evictions are rare so a linear search for the least recently used Buffer is good enough
+			Buffer* buffer = NULL;
+			int index = 0;
+			while (resident > this->cacheBudget && candidates.size() > 0)
+			{
+				index = 0;
+				for_iter (i, 1, candidates.size())
+				{
+					if (candidates[i]->idleTime > candidates[index]->idleTime)
+					{
+						index = i;
+					}
+				}
+				buffer = candidates.removeAt(index);
+				size = buffer->_getResidentSize();
+				if (buffer->_tryEvict())
+				{
+					hlog::debug(logTag, "Evicting from cache: " + buffer->getFilename());
+					resident -= size;
+					++this->cacheStats.evictions;
+				}
+			}
+		}
+		this->cacheStats.residentBytes = resident;
 	}
 
 	Buffer* AudioManager::_createBuffer(Sound* sound)
@@ -462,13 +1173,18 @@ namespace xal
 
 	void AudioManager::_destroyBuffer(Buffer* buffer)
 	{
+		this->_onBufferDestroyed(buffer);
 		this->buffers -= buffer;
 		delete buffer;
 	}
 
-	Source* AudioManager::_createSource(chstr filename, SourceMode sourceMode, BufferMode bufferMode, Format format)
+	Source* AudioManager::_createSource(chstr filename, SourceMode sourceMode, BufferMode bufferMode, Format format, VorbisDecoder vorbisDecoder)
 	{
 		Source* source;
+		if (vorbisDecoder == VORBIS_DEFAULT)
+		{
+			vorbisDecoder = this->vorbisDecoder;
+		}
 		switch (format)
 		{
 #ifdef _FORMAT_FLAC
@@ -476,9 +1192,20 @@ namespace xal
 			source = new FLAC_Source(filename, sourceMode, bufferMode);
 			break;
 #endif
-#ifdef _FORMAT_OGG
+#if defined(_FORMAT_OGG) || defined(_FORMAT_OGG_TREMOR)
 		case OGG:
+#ifdef _FORMAT_OGG_TREMOR
+			if (vorbisDecoder == VORBIS_INTEGER)
+			{
+				source = new OGG_Tremor_Source(filename, sourceMode, bufferMode);
+				break;
+			}
+#endif
+#ifdef _FORMAT_OGG
 			source = new OGG_Source(filename, sourceMode, bufferMode);
+#else
+			source = new OGG_Tremor_Source(filename, sourceMode, bufferMode);
+#endif
 			break;
 #endif
 #ifdef _FORMAT_SPX
@@ -498,9 +1225,47 @@ namespace xal
 		return source;
 	}
 
+	Converter* AudioManager::_createConverter(Source* source)
+	{
+		if (!this->_isConversionRequired(source))
+		{
+			return NULL;
+		}
+		return new Converter(source->getChannels(), source->getSamplingRate(), source->getBitsPerSample(),
+			this->channels, this->samplingRate, this->bitsPerSample);
+	}
+
+	void AudioManager::_convertStream(Source* source, hstream& stream)
+	{
+		if (stream.size() == 0)
+		{
+			return;
+		}
+		Converter* converter = this->_createConverter(source);
+		if (converter == NULL)
+		{
+			return;
+		}
+		int size = (int)stream.size();
+		unsigned char* data = new unsigned char[converter->calcOutputSize(size)];
+		int written = converter->convert((unsigned char*)stream, size, data);
+		// the data is complete so whatever the resampler still holds belongs to the end of it
+		written += converter->flush(&data[written]);
+		delete converter;
+		stream.clear(hmax(written, 1));
+		stream.writeRaw(data, written);
+		stream.rewind();
+		delete[] data;
+	}
+
 	void AudioManager::play(chstr soundName, float fadeTime, bool looping, float gain)
 	{
+		if (this->_queueCommand(Command(Command::PLAY, NULL, soundName, fadeTime, looping, gain)))
+		{
+			return;
+		}
 		hmutex::ScopeLock lock(&this->mutex);
+		this->_processCommands();
 		this->_play(soundName, fadeTime, looping, gain);
 	}
 
@@ -512,12 +1277,29 @@ namespace xal
 		}
 		Player* player = this->_createManagedPlayer(soundName);
 		player->_setGain(gain);
-		player->_play(fadeTime, looping);
+		if (this->_acquireVoice(player))
+		{
+			player->_play(fadeTime, looping);
+		}
+		if (!player->_isPlaying()) // no voice in the pool or in the audio-system
+		{
+			player->looping = looping;
+			player->_virtualize();
+		}
+		else
+		{
+			++this->activeVoices;
+		}
 	}
 
 	void AudioManager::playAsync(chstr soundName, float fadeTime, bool looping, float gain)
 	{
+		if (this->_queueCommand(Command(Command::PLAY_ASYNC, NULL, soundName, fadeTime, looping, gain)))
+		{
+			return;
+		}
 		hmutex::ScopeLock lock(&this->mutex);
+		this->_processCommands();
 		this->_playAsync(soundName, fadeTime, looping, gain);
 	}
 
@@ -529,12 +1311,26 @@ namespace xal
 		}
 		Player* player = this->_createManagedPlayer(soundName);
 		player->_setGain(gain);
-		player->_playAsync(fadeTime, looping);
+		if (this->_acquireVoice(player))
+		{
+			player->_playAsync(fadeTime, looping);
+			++this->activeVoices;
+		}
+		else
+		{
+			player->looping = looping;
+			player->_virtualize();
+		}
 	}
 
 	void AudioManager::stop(chstr soundName, float fadeTime)
 	{
+		if (this->_queueCommand(Command(Command::STOP, NULL, soundName, fadeTime)))
+		{
+			return;
+		}
 		hmutex::ScopeLock lock(&this->mutex);
+		this->_processCommands();
 		this->_stop(soundName, fadeTime);
 	}
 
@@ -542,13 +1338,14 @@ namespace xal
 	{
 		if (fadeTime == 0.0f)
 		{
-			// creating a copy, because _destroyManagedPlayer alters managedPlayers
-			harray<Player*> players = this->managedPlayers;
-			foreach (Player*, it, players)
+			Player* player = NULL;
+			// iterating backwards, because _destroyManagedPlayer moves the last Player into the freed slot
+			for (int i = this->managedPlayers.size() - 1; i >= 0; --i)
 			{
-				if ((*it)->getSound()->getName() == soundName)
+				player = this->managedPlayers[i];
+				if (player->getSound()->getName() == soundName)
 				{
-					this->_destroyManagedPlayer(*it);
+					this->_destroyManagedPlayer(player);
 				}
 			}
 		}
@@ -566,32 +1363,47 @@ namespace xal
 
 	void AudioManager::stopFirst(chstr name, float fadeTime)
 	{
+		if (this->_queueCommand(Command(Command::STOP_FIRST, NULL, name, fadeTime)))
+		{
+			return;
+		}
 		hmutex::ScopeLock lock(&this->mutex);
+		this->_processCommands();
 		this->_stopFirst(name, fadeTime);
 	}
 
 	void AudioManager::_stopFirst(chstr soundName, float fadeTime)
 	{
+		// managedPlayers isn't ordered since removal is done by swapping so the start order is used
+		Player* player = NULL;
 		foreach (Player*, it, this->managedPlayers)
 		{
-			if ((*it)->getSound()->getName() == soundName)
+			if ((*it)->getSound()->getName() == soundName && (player == NULL || (*it)->playOrder < player->playOrder))
 			{
-				if (fadeTime <= 0.0f)
-				{
-					this->_destroyManagedPlayer(*it);
-				}
-				else
-				{
-					(*it)->_stop(fadeTime);
-				}
-				break;
+				player = (*it);
+			}
+		}
+		if (player != NULL)
+		{
+			if (fadeTime <= 0.0f)
+			{
+				this->_destroyManagedPlayer(player);
+			}
+			else
+			{
+				player->_stop(fadeTime);
 			}
 		}
 	}
 
 	void AudioManager::stopAll(float fadeTime)
 	{
+		if (this->_queueCommand(Command(Command::STOP_ALL, NULL, "", fadeTime)))
+		{
+			return;
+		}
 		hmutex::ScopeLock lock(&this->mutex);
+		this->_processCommands();
 		this->_stopAll(fadeTime);
 	}
 	
@@ -600,11 +1412,9 @@ namespace xal
 		// managed players can all be destroyed immediately if there is no fade time
 		if (fadeTime <= 0.0f)
 		{
-			// creating a copy, because _destroyManagedPlayer alters managedPlayers
-			harray<Player*> players = this->managedPlayers;
-			foreach (Player*, it, players)
+			while (this->managedPlayers.size() > 0)
 			{
-				this->_destroyManagedPlayer(*it);
+				this->_destroyManagedPlayer(this->managedPlayers.last());
 			}
 		}
 		// includes managed players!
@@ -665,7 +1475,12 @@ namespace xal
 	
 	void AudioManager::stopCategory(chstr categoryName, float fadeTime)
 	{
+		if (this->_queueCommand(Command(Command::STOP_CATEGORY, NULL, categoryName, fadeTime)))
+		{
+			return;
+		}
 		hmutex::ScopeLock lock(&this->mutex);
+		this->_processCommands();
 		this->_stopCategory(categoryName, fadeTime);
 	}
 	
@@ -675,13 +1490,14 @@ namespace xal
 		Category* category = this->_getCategory(categoryName);
 		if (fadeTime == 0.0f)
 		{
-			// creating a copy, because _destroyManagedPlayer alters managedPlayers
-			harray<Player*> players = this->managedPlayers;
-			foreach (Player*, it, players)
+			Player* player = NULL;
+			// iterating backwards, because _destroyManagedPlayer moves the last Player into the freed slot
+			for (int i = this->managedPlayers.size() - 1; i >= 0; --i)
 			{
-				if ((*it)->getCategory() == category)
+				player = this->managedPlayers[i];
+				if (player->getCategory() == category)
 				{
-					this->_destroyManagedPlayer(*it);
+					this->_destroyManagedPlayer(player);
 				}
 			}
 		}
@@ -783,6 +1599,7 @@ namespace xal
 			}
 		}
 		hlog::debugf(logTag, "Found %d buffers for memory clearing.", count);
+		this->_clearPlayerPools();
 	}
 
 	void AudioManager::addAudioExtension(chstr extension)
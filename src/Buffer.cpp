@@ -9,18 +9,30 @@
 #include <string.h> // required on Unix because of memset usage
 
 #include <hltypes/harray.h>
+#include <hltypes/hfile.h>
 #include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
 #include <hltypes/hresource.h>
 #include <hltypes/hstring.h>
 
 #include "AudioManager.h"
 #include "Buffer.h"
 #include "BufferAsync.h"
+#include "BufferStream.h"
 #include "Category.h"
+#include "Condition.h"
+#include "Converter.h"
+#include "MappedFile.h"
+#include "SharedStream.h"
 #include "Sound.h"
 #include "Source.h"
 #include "xal.h"
 
+#define DISK_CACHE_MAGIC "XALPCM02"
+#define DISK_CACHE_MAGIC_SIZE 8
+#define DISK_CACHE_META_DATA_SIZE 24 // size, channels, sampling rate, bits per sample, float flag, duration
+#define PROGRESSIVE_LOAD_CHUNK_SIZE 65536
+
 namespace xal
 {
 	Buffer::Buffer(Sound* sound)
@@ -29,17 +41,46 @@ namespace xal
 		this->fileSize = (int)hresource::hinfo(this->filename).size;
 		Category* category = sound->getCategory();
 		this->mode = category->getBufferMode();
-		this->loaded = false;
+		this->asyncLoad = new AsyncLoadState();
+		this->viewData = NULL;
+		this->viewSize = 0;
+		this->diskCacheFile = NULL;
 		this->asyncLoadQueued = false;
 		this->asyncLoadDiscarded = false;
-		this->source = xal::manager->_createSource(this->filename, category->getSourceMode(), this->mode, this->getFormat());
+		this->asyncLoadRunning = false;
+		this->asyncLoadCallback = NULL;
+		this->asyncLoadCallbackData = NULL;
+		this->progressiveLeadSize = 0;
+		this->vorbisDecoder = category->getVorbisDecoder();
+		if (this->vorbisDecoder == VORBIS_DEFAULT)
+		{
+			this->vorbisDecoder = xal::manager->getVorbisDecoder();
+		}
+		this->source = xal::manager->_createSource(this->filename, category->getSourceMode(), this->mode, this->getFormat(), this->vorbisDecoder);
+		if (this->mode == COMPRESSED)
+		{
+			this->source->_setResidentFile(sound->_getResidentFile());
+		}
+		// avoids quantizing decoded data to 16 bit only for the mixer to convert it back to float
+		this->source->_setFloatOutput(xal::manager->_isFloatMixSupported());
 		this->loadedMetaData = false;
 		this->size = 0;
 		this->channels = 2;
 		this->samplingRate = 44100;
 		this->bitsPerSample = 16;
 		this->duration = 0.0f;
+		this->floatData = false;
 		this->idleTime = 0.0f;
+		this->chunkData = NULL;
+		this->chunkCapacity = 0;
+		this->converter = NULL;
+		this->convertedData = NULL;
+		this->convertedCapacity = 0;
+		this->readAhead = new ReadAhead();
+		this->sharedStream = NULL;
+		this->sharedPosition = 0;
+		this->sharedLoopStart = 0;
+		this->sharedAttached = false;
 		if (xal::manager->isEnabled() && this->getFormat() != UNKNOWN)
 		{
 			switch (this->mode)
@@ -58,6 +99,8 @@ namespace xal
 				break;
 			case STREAMED:
 				break;
+			case COMPRESSED:
+				break;
 			default:
 				break;
 			}
@@ -66,13 +109,44 @@ namespace xal
 
 	Buffer::~Buffer()
 	{
+		this->_stopReadAhead();
+		this->_detachShared();
+		Condition::ScopeLock signalLock(&this->asyncLoad->condition);
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		// a worker would otherwise take the queued entry after the Buffer is gone
+		BufferAsync::cancelLoad(this);
+		// a progressive load doesn't hold the mutex while decoding so it has to be canceled and waited for, same as a worker that took the entry already
+		this->asyncLoadDiscarded = true;
+		while (this->asyncLoadRunning || this->asyncLoad->lane == TAKEN_LANE)
+		{
+			lock.release();
+			// the worker signals only while holding the condition's lock, so the wake-up can't be missed
+			this->asyncLoad->condition.wait();
+			lock.acquire(&this->asyncLoadMutex);
+		}
+		signalLock.release();
+		this->_releaseView();
+		this->_releaseChunk();
+		if (this->converter != NULL)
+		{
+			delete this->converter;
+		}
 		this->asyncLoadQueued = false;
 		this->asyncLoadDiscarded = false;
-		this->loaded = false;
+		delete this->asyncLoad;
+		delete this->readAhead;
 		delete this->source;
 	}
 	
+	int Buffer::getDataSize()
+	{
+		if (this->viewData != NULL)
+		{
+			return this->viewSize;
+		}
+		return (this->asyncLoad->progressiveLoad ? (int)this->asyncLoad->loadedSize : (int)this->stream.size());
+	}
+
 	int Buffer::getSize()
 	{
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
@@ -101,6 +175,13 @@ namespace xal
 		return this->bitsPerSample;
 	}
 
+	bool Buffer::isFloat()
+	{
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		this->_tryLoadMetaData();
+		return this->floatData;
+	}
+
 	float Buffer::getDuration()
 	{
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
@@ -122,7 +203,7 @@ namespace xal
 			return M4A;
 		}
 #endif
-#ifdef _FORMAT_OGG
+#if defined(_FORMAT_OGG) || defined(_FORMAT_OGG_TREMOR)
 		if (this->filename.endsWith(".ogg"))
 		{
 			return OGG;
@@ -146,7 +227,18 @@ namespace xal
 	bool Buffer::isLoaded()
 	{
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
-		return this->loaded;
+		return this->asyncLoad->loaded;
+	}
+
+	bool Buffer::_isLoaded()
+	{
+		return this->asyncLoad->loaded;
+	}
+
+	bool Buffer::isPlayable()
+	{
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		return (this->asyncLoad->loaded || (this->asyncLoad->progressiveLoad && this->asyncLoad->loadedSize >= this->progressiveLeadSize));
 	}
 
 	bool Buffer::isAsyncLoadQueued()
@@ -157,7 +249,7 @@ namespace xal
 
 	bool Buffer::isStreamed()
 	{
-		return (this->mode == STREAMED);
+		return (this->mode == STREAMED || this->mode == COMPRESSED);
 	}
 
 	bool Buffer::isMemoryManaged()
@@ -166,49 +258,89 @@ namespace xal
 	}
 
 	void Buffer::prepare()
+	{
+		this->_prepare(false);
+	}
+
+	void Buffer::_prepare(bool playable)
 	{
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
 		this->asyncLoadDiscarded = false; // a possible previous unload call must be canceled
-		if (!xal::manager->isEnabled() || this->loaded)
+		if (!xal::manager->isEnabled() || this->asyncLoad->loaded)
 		{
+			if (this->asyncLoad->loaded && this->_isCached())
+			{
+				++xal::manager->cacheStats.hits;
+			}
 			this->asyncLoadQueued = false;
-			this->loaded = true;
+			this->asyncLoad->loaded = true;
 			return;
 		}
 		if (this->asyncLoadQueued)
 		{
-			if (!this->loaded)
+			if (!this->asyncLoad->loaded)
 			{
 				lock.release();
-				this->_waitForAsyncLoad();
+				this->_waitForAsyncLoad(0.0f, playable);
 			}
 			return;
 		}
 		if (!this->isStreamed())
 		{
-			this->loaded = true;
+			if (this->_isCached())
+			{
+				++xal::manager->cacheStats.misses;
+			}
+			// checked before the Source is opened, because opening alone can already read the whole file
+			if (this->_loadFromDiskCache())
+			{
+				this->asyncLoad->loaded = true;
+				xal::manager->_requestCacheUpdate();
+				return;
+			}
+			if (playable && this->_isProgressiveLoadEnabled())
+			{
+				// a worker decodes the data so playing only has to wait until enough of it is available
+				this->asyncLoadQueued = BufferAsync::queueLoad(this);
+				if (this->asyncLoadQueued)
+				{
+					lock.release();
+					this->_waitForAsyncLoad(0.0f, true);
+					return;
+				}
+			}
+			this->asyncLoad->loaded = true;
 			this->source->open();
-			this->stream.clear(this->source->getSize());
-			this->source->load(this->stream);
-			this->source->close();
-			xal::manager->_convertStream(this->source, this->stream);
+			this->_loadFromSource();
+			xal::manager->_requestCacheUpdate();
 			return;
 		}
 		lock.release();
 		// streamed sounds cannot be loaded asynchronously and hence require no mutex locking
-		if (!this->source->isOpen())
+		if (!this->_isStreamOpen())
 		{
-			this->source->open();
+			if (!this->_attachShared())
+			{
+				this->source->open();
+			}
 			this->_tryLoadMetaData();
+			if (this->converter == NULL)
+			{
+				this->converter = xal::manager->_createConverter(this->source);
+			}
+			else // the Source starts from the beginning again
+			{
+				this->converter->reset();
+			}
 		}
 	}
 
 	bool Buffer::prepareAsync()
 	{
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
-		if (!xal::manager->isEnabled() || this->loaded)
+		if (!xal::manager->isEnabled() || this->asyncLoad->loaded)
 		{
-			this->loaded = true;
+			this->asyncLoad->loaded = true;
 			return false;
 		}
 		if (this->isStreamed())
@@ -232,42 +364,35 @@ namespace xal
 			return 0;
 		}
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
-		if (this->isStreamed() && this->source->isOpen())
+		// while the streaming service is used, only its thread may access the Source
+		if (this->isStreamed() && (this->readAhead->ring != NULL || this->_isStreamOpen()))
 		{
-			this->stream.clear(STREAM_BUFFER);
-			int read = this->source->loadChunk(this->stream, size);
-			size -= read;
-			if (size > 0)
+			// chunks are loaded and converted in persistent memory, the data is then provided as a view
+			this->_reserveChunk(size, (this->converter != NULL ? this->converter->calcOutputSize(size) : 0));
+			int read = 0;
+			if (this->_startReadAhead(size))
 			{
-				this->stream.seek(read);
-				if (!looping)
-				{
-					// if stream isn't empty, fill the rest with silence so systems that depend on same-sized chunks don't get messed up
-					if (this->stream.size() > 0)
-					{
-						this->stream.fill(0, size);
-						this->stream.truncate(read);
-					}
-				}
-				else
-				{
-					while (size > 0)
-					{
-						this->source->rewind();
-						read = this->source->loadChunk(this->stream, size);
-						if (read == 0) // to prevent an infinite loop
-						{
-							break;
-						}
-						size -= read;
-						this->stream.seek(read);
-					}
-				}
-				this->stream.rewind();
+				this->readAhead->looping = looping;
+				read = this->_loadFromReadAhead(size);
+			}
+			else
+			{
+				bool ended = false;
+				read = this->_readChunk(this->chunkData, size, looping, &ended);
+			}
+			if (this->converter != NULL)
+			{
+				this->viewData = this->convertedData;
+				this->viewSize = this->converter->convert(this->chunkData, read, this->convertedData);
+				xal::manager->_countStreamAllocations(this->converter->takeAllocations());
+			}
+			else
+			{
+				this->viewData = this->chunkData;
+				this->viewSize = read;
 			}
-			xal::manager->_convertStream(this->source, this->stream);
 		}
-		return (int)this->stream.size();
+		return this->getDataSize();
 	}
 
 	void Buffer::bind(Player* player, bool playerPaused)
@@ -281,21 +406,36 @@ namespace xal
 		{
 			this->boundPlayers /= player;
 		}
+		if (this->boundPlayers.size() == 0 && this->_isCached()) // the data can be evicted now
+		{
+			xal::manager->_requestCacheUpdate();
+		}
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
-		if (this->boundPlayers.size() == 0 && this->mode == xal::ON_DEMAND || this->mode == xal::STREAMED)
+		// with a cache budget, ON_DEMAND data stays in memory until the cache evicts it
+		if ((this->boundPlayers.size() == 0 && this->mode == xal::ON_DEMAND && xal::manager->cacheBudget == 0) || this->isStreamed())
 		{
-			this->stream.clear(1);
+			if (!this->asyncLoadRunning || this->asyncLoad->loaded) // a progressive load is still writing into the stream, it cleans up by itself when discarded
+			{
+				this->stream.clear(1);
+				this->_releaseView();
+				xal::manager->_onBufferCleared(this);
+			}
 			this->asyncLoadQueued = false;
 			this->asyncLoadDiscarded = true;
-			this->loaded = false;
+			this->asyncLoad->loaded = false;
 		}
-		if (this->boundPlayers.size() == 0 && this->mode == xal::STREAMED)
+		if (this->boundPlayers.size() == 0 && this->isStreamed())
 		{
+			this->_stopReadAhead();
+			this->_detachShared();
+			this->_releaseChunk();
 			this->source->close();
 			this->asyncLoadQueued = false;
 			this->asyncLoadDiscarded = true;
-			this->loaded = false;
+			this->asyncLoad->loaded = false;
 		}
+		lock.release();
+		this->_signalAsyncLoad();
 	}
 
 	void Buffer::keepLoaded()
@@ -305,17 +445,308 @@ namespace xal
 
 	void Buffer::rewind()
 	{
-		this->source->rewind();
+		if (this->converter != NULL)
+		{
+			this->converter->reset();
+		}
+		hmutex::ScopeLock lock(&this->readAhead->mutex);
+		if (this->readAhead->ring != NULL)
+		{
+			// the Source is rewound by the next decode so this doesn't have to wait for a running decode to finish
+			++this->readAhead->generation;
+			this->readAhead->rewindRequested = true;
+			// data that was decoded ahead belongs to the old position
+			this->readAhead->ring->reset();
+			this->readAhead->ended = false;
+			this->readAhead->primed = false;
+			return;
+		}
+		lock.release();
+		this->_rewindSource();
+	}
+
+	bool Buffer::_isStreamOpen()
+	{
+		return (this->sharedAttached || this->source->isOpen());
+	}
+
+	void Buffer::_rewindSource()
+	{
+		if (this->sharedAttached)
+		{
+			this->sharedAttached = this->sharedStream->rewind(&this->sharedPosition, &this->sharedLoopStart);
+			if (!this->sharedAttached) // the others are too far ahead to start over
+			{
+				this->source->open();
+			}
+		}
+		else if (this->_attachShared()) // the shared decoder may be usable again
+		{
+			this->source->close();
+		}
+		else
+		{
+			this->source->rewind();
+		}
+	}
+
+	bool Buffer::_attachShared()
+	{
+		if (this->sharedStream != NULL && !this->sharedAttached)
+		{
+			this->sharedAttached = this->sharedStream->attach(&this->sharedPosition, &this->sharedLoopStart);
+		}
+		return this->sharedAttached;
+	}
+
+	void Buffer::_detachShared()
+	{
+		if (this->sharedAttached)
+		{
+			this->sharedStream->detach();
+			this->sharedAttached = false;
+		}
+	}
+
+	void Buffer::_fallBackFromShared(unsigned char* output, int size)
+	{
+		int64_t offset = this->sharedPosition - this->sharedLoopStart;
+		this->_detachShared();
+		xal::manager->_countStreamSharedFallback();
+		hlog::debug(logTag, "Streamed sound fell behind its shared decoder, decoding on its own: " + this->filename);
+		this->source->open();
+		int frameSize = hmax(this->channels * this->bitsPerSample / 8, 1);
+		if (offset <= 0 || this->source->seek(offset / frameSize))
+		{
+			return;
+		}
+		// the Source cannot seek so everything up to the position is decoded again, output is only used as scratch space here
+		int read = 0;
+		while (offset > 0)
+		{
+			read = this->source->loadChunkRaw(output, (int)hmin(offset, (int64_t)size));
+			if (read <= 0)
+			{
+				break;
+			}
+			offset -= read;
+		}
+	}
+
+	void Buffer::_reserveChunk(int size, int convertedSize)
+	{
+		if (this->chunkCapacity < size)
+		{
+			delete[] this->chunkData;
+			this->chunkData = new unsigned char[size];
+			this->chunkCapacity = size;
+			xal::manager->_countStreamAllocations(1);
+		}
+		if (this->convertedCapacity < convertedSize)
+		{
+			delete[] this->convertedData;
+			this->convertedData = new unsigned char[convertedSize];
+			this->convertedCapacity = convertedSize;
+			xal::manager->_countStreamAllocations(1);
+		}
+	}
+
+	void Buffer::_releaseChunk()
+	{
+		if (this->chunkData != NULL)
+		{
+			delete[] this->chunkData;
+			this->chunkData = NULL;
+			this->chunkCapacity = 0;
+		}
+		if (this->convertedData != NULL)
+		{
+			delete[] this->convertedData;
+			this->convertedData = NULL;
+			this->convertedCapacity = 0;
+		}
+	}
+
+	int Buffer::_readChunk(unsigned char* output, int size, bool looping, bool* ended)
+	{
+		if (this->sharedAttached)
+		{
+			int result = this->sharedStream->read(&this->sharedPosition, &this->sharedLoopStart, output, size, looping, ended);
+			if (result >= 0)
+			{
+				return result;
+			}
+			this->_fallBackFromShared(output, size);
+		}
+		int result = 0;
+		int read = 0;
+		bool rewound = false;
+		*ended = false;
+		while (result < size)
+		{
+			read = this->source->loadChunkRaw(&output[result], size - result);
+			if (read > 0)
+			{
+				result += read;
+				rewound = false;
+			}
+			else if (looping && !rewound) // a Source that is empty right after a rewind would cause an infinite loop
+			{
+				this->source->rewind();
+				rewound = true;
+			}
+			else
+			{
+				*ended = true;
+				break;
+			}
+		}
+		xal::manager->_countStreamAllocations(this->source->_takeAllocations());
+		return result;
+	}
+
+	bool Buffer::_startReadAhead(int size)
+	{
+		if (this->readAhead->ring != NULL)
+		{
+			return true;
+		}
+		if (xal::manager->streamReadAheadTime <= 0.0f)
+		{
+			return false;
+		}
+		int bytes = hround(xal::manager->streamReadAheadTime * this->samplingRate * this->channels * this->bitsPerSample * 0.125f);
+		int frameSize = hmax(this->channels * this->bitsPerSample / 8, 1);
+		hmutex::ScopeLock decodeLock(&this->readAhead->decodeMutex);
+		hmutex::ScopeLock lock(&this->readAhead->mutex);
+		this->readAhead->ring = new StreamRing(hmax(bytes, size));
+		// the streaming service decodes in chunks of the same size that the audio-system requests
+		this->readAhead->capacity = hmax(hmin(size, this->readAhead->ring->getCapacity()) / frameSize, 1) * frameSize;
+		this->readAhead->data = new unsigned char[this->readAhead->capacity];
+		xal::manager->_countStreamAllocations(2);
+		this->readAhead->ended = false;
+		this->readAhead->primed = false;
+		this->readAhead->rewindRequested = false;
+		lock.release();
+		decodeLock.release();
+		BufferStream::add(this);
+		return true;
+	}
+
+	void Buffer::_stopReadAhead()
+	{
+		if (this->readAhead->ring == NULL)
+		{
+			return;
+		}
+		BufferStream::remove(this);
+		hmutex::ScopeLock decodeLock(&this->readAhead->decodeMutex);
+		hmutex::ScopeLock lock(&this->readAhead->mutex);
+		delete this->readAhead->ring;
+		this->readAhead->ring = NULL;
+		delete[] this->readAhead->data;
+		this->readAhead->data = NULL;
+		this->readAhead->capacity = 0;
+		bool rewinding = this->readAhead->rewindRequested;
+		this->readAhead->rewindRequested = false;
+		lock.release();
+		if (rewinding) // the Source is used directly from now on
+		{
+			this->_rewindSource();
+		}
+	}
+
+	int Buffer::_decodeAhead(int size)
+	{
+		hmutex::ScopeLock decodeLock(&this->readAhead->decodeMutex);
+		hmutex::ScopeLock lock(&this->readAhead->mutex);
+		if (this->readAhead->ring == NULL || this->readAhead->ended)
+		{
+			return 0;
+		}
+		unsigned int generation = this->readAhead->generation;
+		bool rewinding = this->readAhead->rewindRequested;
+		this->readAhead->rewindRequested = false;
+		// only this thread writes into the ring so the free space can only grow in the meantime
+		int remaining = this->readAhead->ring->getFree();
+		if (size > 0)
+		{
+			remaining = hmin(remaining, size);
+		}
+		// only whole sample frames are decoded
+		int frameSize = hmax(this->channels * this->bitsPerSample / 8, 1);
+		remaining -= remaining % frameSize;
+		lock.release();
+		// the Source is decoded without holding the lock so a rewind or the audio-system never has to wait for it
+		if (rewinding)
+		{
+			this->_rewindSource();
+		}
+		if (!this->_isStreamOpen())
+		{
+			return 0;
+		}
+		int result = 0;
+		int read = 0;
+		bool ended = false;
+		while (remaining > 0 && !ended)
+		{
+			read = this->_readChunk(this->readAhead->data, hmin(remaining, this->readAhead->capacity), this->readAhead->looping, &ended);
+			lock.acquire(&this->readAhead->mutex);
+			if (this->readAhead->generation != generation) // rewound in the meantime, the next decode starts over
+			{
+				break;
+			}
+			this->readAhead->ring->write(this->readAhead->data, read);
+			if (ended) // set only after the last data was published
+			{
+				this->readAhead->ended = true;
+			}
+			lock.release();
+			remaining -= read;
+			result += read;
+		}
+		return result;
+	}
+
+	int Buffer::_loadFromReadAhead(int size)
+	{
+		if (!this->readAhead->primed)
+		{
+			// playback has to start with actual data so the first chunk is decoded right away
+			this->_decodeAhead(size);
+			this->readAhead->primed = true;
+		}
+		// the flag is checked before reading, because the streaming service publishes the last data before setting it
+		bool ended = this->readAhead->ended;
+		int read = this->readAhead->ring->read(this->chunkData, size);
+		if (read < size && !ended)
+		{
+			// filling with silence so the audio-system doesn't think that the stream has ended
+			xal::manager->_countStreamUnderrun(size - read);
+			memset(&this->chunkData[read], 0, (size - read) * sizeof(unsigned char));
+			read = size;
+		}
+		BufferStream::wake();
+		return read;
 	}
 
 	int Buffer::calcOutputSize(int size)
 	{
+		if (this->isFloat())
+		{
+			return size;
+		}
 		return hround((float)size * xal::manager->getSamplingRate() * xal::manager->getChannels() * xal::manager->getBitsPerSample() /
 			((float)this->getSamplingRate() * this->getChannels() * this->getBitsPerSample()));
 	}
 
 	int Buffer::calcInputSize(int size)
 	{
+		if (this->isFloat())
+		{
+			return size;
+		}
 		return hround((float)size * this->getSamplingRate() * this->getChannels() * this->getBitsPerSample() /
 			((float)xal::manager->getSamplingRate() * xal::manager->getChannels() * xal::manager->getBitsPerSample()));
 	}
@@ -325,7 +756,7 @@ namespace xal
 		// no mutex locking, because a separate source is used
 		if (this->getFormat() != UNKNOWN)
 		{
-			Source* source = xal::manager->_createSource(this->filename, xal::DISK, xal::FULL, this->getFormat());
+			Source* source = xal::manager->_createSource(this->filename, xal::DISK, xal::FULL, this->getFormat(), this->vorbisDecoder);
 			source->open();
 			if (source->getSize() > 0)
 			{
@@ -337,6 +768,11 @@ namespace xal
 		}
 	}
 
+	void Buffer::_setSharedStream(SharedStream* sharedStream)
+	{
+		this->sharedStream = sharedStream;
+	}
+
 	void Buffer::_update(float timeDelta)
 	{
 		this->idleTime += timeDelta;
@@ -360,6 +796,8 @@ namespace xal
 			this->samplingRate = this->source->getSamplingRate();
 			this->bitsPerSample = this->source->getBitsPerSample();
 			this->duration = this->source->getDuration();
+			// when a conversion is required, the Converter turns float samples into the audio system's format
+			this->floatData = (this->bitsPerSample == 32 && !xal::manager->_isConversionRequired(this->source));
 			this->loadedMetaData = true;
 			if (!open)
 			{
@@ -371,26 +809,244 @@ namespace xal
 	bool Buffer::_tryClearMemory()
 	{
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
-		if (this->isMemoryManaged() && this->boundPlayers.size() == 0 && (this->loaded || this->mode == STREAMED))
+		if (this->isMemoryManaged() && this->boundPlayers.size() == 0 && (this->asyncLoad->loaded || this->isStreamed()))
 		{
 			hlog::debug(logTag, "Clearing memory for: " + this->filename);
 			this->stream.clear(1L);
+			this->_releaseView();
+			xal::manager->_onBufferCleared(this);
+			xal::manager->_requestCacheUpdate();
 			this->source->close();
 			this->asyncLoadQueued = false;
 			this->asyncLoadDiscarded = true;
-			this->loaded = false;
+			this->asyncLoad->loaded = false;
 			return true;
 		}
 		return false;
 	}
 
+	bool Buffer::_isCached()
+	{
+		return (this->mode == LAZY || this->mode == MANAGED || this->mode == ON_DEMAND);
+	}
+
+	int Buffer::_getResidentSize()
+	{
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		// a view is owned by the Source and not counted here
+		return (this->asyncLoad->loaded && this->viewData == NULL ? (int)this->stream.size() : 0);
+	}
+
+	bool Buffer::_isEvictable()
+	{
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		return (this->_isCached() && this->asyncLoad->loaded && this->boundPlayers.size() == 0);
+	}
+
+	bool Buffer::_tryEvict()
+	{
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		if (!this->_isCached() || !this->asyncLoad->loaded || this->boundPlayers.size() > 0)
+		{
+			return false;
+		}
+		this->stream.clear(1L);
+		this->_releaseView();
+		xal::manager->_onBufferCleared(this);
+		this->source->close();
+		this->asyncLoadQueued = false;
+		this->asyncLoadDiscarded = true;
+		this->asyncLoad->loaded = false;
+		return true;
+	}
+
+	void Buffer::_loadFromSource()
+	{
+		this->_releaseView();
+		int size = 0;
+		const unsigned char* data = NULL;
+		if (!xal::manager->_isConversionRequired(this->source))
+		{
+			data = this->source->_getDataView(&size);
+		}
+		if (data != NULL)
+		{
+			// the Source already holds the data in the format the audio system needs so it doesn't have to be copied
+			this->stream.clear(1L);
+			this->viewData = data;
+			this->viewSize = size;
+		}
+		else // the disk cache was already checked before the Source was opened
+		{
+			this->stream.clear(this->source->getSize());
+			this->source->load(this->stream);
+			xal::manager->_convertStream(this->source, this->stream);
+			this->_saveToDiskCache();
+		}
+		this->source->close();
+	}
+
+	void Buffer::_releaseView()
+	{
+		this->viewData = NULL;
+		this->viewSize = 0;
+		this->asyncLoad->progressiveLoad = false;
+		this->asyncLoad->loadedSize = 0;
+		if (this->diskCacheFile != NULL)
+		{
+			delete this->diskCacheFile;
+			this->diskCacheFile = NULL;
+		}
+	}
+
+	hstr Buffer::_makeDiskCacheFilename(hstr& key)
+	{
+		hstr path = xal::manager->diskCachePath;
+		// uncompressed files are already as fast to load as a cache entry would be
+		if (path == "" || this->getFormat() == WAV || this->getFormat() == UNKNOWN)
+		{
+			return "";
+		}
+		key = hsprintf("%s|%d|%lld|%d|%d|%d", this->filename.cStr(), this->fileSize, (long long)hresource::hinfo(this->filename).modificationTime,
+			xal::manager->getSamplingRate(), xal::manager->getChannels(), xal::manager->getBitsPerSample());
+		if (this->source->isFloatOutput()) // only appended for float data so existing entries stay valid
+		{
+			key += "|float";
+		}
+		if (this->getFormat() == OGG && this->vorbisDecoder == VORBIS_INTEGER) // Tremor's output differs slightly from libvorbis's
+		{
+			key += "|tremor";
+		}
+		// FNV-1a, collisions are caught by comparing the stored key
+		unsigned long long hash = 14695981039346656037ULL;
+		const char* chars = key.cStr();
+		for_iter (i, 0, key.size())
+		{
+			hash = (hash ^ (unsigned char)chars[i]) * 1099511628211ULL;
+		}
+		return (path + "/" + hsprintf("%016llx.pcm", hash));
+	}
+
+	bool Buffer::_loadFromDiskCache()
+	{
+		hstr key;
+		hstr filename = this->_makeDiskCacheFilename(key);
+		if (filename == "" || !hfile::exists(filename))
+		{
+			return false;
+		}
+		MappedFile* file = new MappedFile(filename);
+		if (!file->isMapped()) // e.g. WinRT
+		{
+			delete file;
+			return false;
+		}
+		// layout: magic, key size, key, meta data, data size, data
+		int headerSize = DISK_CACHE_MAGIC_SIZE + 4 + key.size() + DISK_CACHE_META_DATA_SIZE + 4;
+		int keySize = 0;
+		int dataSize = 0;
+		if (file->getSize() >= headerSize)
+		{
+			const unsigned char* data = file->getData();
+			memcpy(&keySize, &data[DISK_CACHE_MAGIC_SIZE], 4);
+			memcpy(&dataSize, &data[headerSize - 4], 4);
+			if (memcmp(data, DISK_CACHE_MAGIC, DISK_CACHE_MAGIC_SIZE) == 0 && keySize == key.size() &&
+				memcmp(&data[DISK_CACHE_MAGIC_SIZE + 4], key.cStr(), keySize) == 0 && dataSize == file->getSize() - headerSize)
+			{
+				this->_releaseView();
+				this->stream.clear(1L);
+				this->diskCacheFile = file;
+				this->viewData = &data[headerSize];
+				this->viewSize = dataSize;
+				if (!this->loadedMetaData)
+				{
+					const unsigned char* metaData = &data[DISK_CACHE_MAGIC_SIZE + 4 + keySize];
+					int floatData = 0;
+					memcpy(&this->size, &metaData[0], 4);
+					memcpy(&this->channels, &metaData[4], 4);
+					memcpy(&this->samplingRate, &metaData[8], 4);
+					memcpy(&this->bitsPerSample, &metaData[12], 4);
+					memcpy(&floatData, &metaData[16], 4);
+					memcpy(&this->duration, &metaData[20], 4);
+					this->floatData = (floatData != 0);
+					this->loadedMetaData = true;
+				}
+				return true;
+			}
+		}
+		hlog::warn(logTag, "Discarding invalid disk cache entry for: " + this->filename);
+		delete file;
+		hfile::remove(filename);
+		return false;
+	}
+
+	void Buffer::_saveToDiskCache()
+	{
+		hstr key;
+		hstr filename = this->_makeDiskCacheFilename(key);
+		if (filename == "" || this->getDataSize() == 0 || hfile::exists(filename)) // an existing entry is only there if it can't be mapped
+		{
+			return;
+		}
+		// written under a temporary name first so an interrupted write never leaves a broken entry behind
+		hstr tempFilename = hsprintf("%s.%p.tmp", filename.cStr(), this);
+		int keySize = key.size();
+		int dataSize = this->getDataSize();
+		this->_tryLoadMetaData();
+		int floatData = (this->floatData ? 1 : 0);
+		hfile file;
+		file.open(tempFilename, hfile::WRITE);
+		file.writeRaw(DISK_CACHE_MAGIC, DISK_CACHE_MAGIC_SIZE);
+		file.writeRaw(&keySize, 4);
+		file.writeRaw(key.cStr(), keySize);
+		file.writeRaw(&this->size, 4);
+		file.writeRaw(&this->channels, 4);
+		file.writeRaw(&this->samplingRate, 4);
+		file.writeRaw(&this->bitsPerSample, 4);
+		file.writeRaw(&floatData, 4);
+		file.writeRaw(&this->duration, 4);
+		file.writeRaw(&dataSize, 4);
+		int written = file.writeRaw((unsigned char*)this->stream, dataSize);
+		file.close();
+		if (written != dataSize)
+		{
+			hlog::warn(logTag, "Could not write disk cache entry for: " + this->filename);
+			hfile::remove(tempFilename);
+			return;
+		}
+		hfile::remove(filename);
+		hfile::rename(tempFilename, filename);
+	}
+
 	bool Buffer::_prepareAsyncStream()
 	{
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
-		if (!this->asyncLoadQueued || this->asyncLoadDiscarded)
+		this->asyncLoad->lane = NO_LANE; // the worker has the Buffer now
+		if (this->asyncLoadRunning) // another worker is already loading this Buffer
+		{
+			lock.release();
+			this->_signalAsyncLoad(); // the destructor could be waiting for the entry to be cleared
+			return false;
+		}
+		if (!this->asyncLoadQueued || this->asyncLoadDiscarded || this->asyncLoad->loaded)
+		{
+			this->asyncLoadQueued = false;
+			this->asyncLoadDiscarded = false;
+			lock.release();
+			this->_signalAsyncLoad();
+			return false;
+		}
+		// checked before the Source is opened, because opening alone can already read the whole file
+		if (this->_loadFromDiskCache())
 		{
 			this->asyncLoadQueued = false;
 			this->asyncLoadDiscarded = false;
+			this->asyncLoad->loaded = true;
+			this->asyncLoadRunning = true;
+			lock.release();
+			this->_finishAsyncLoad(true);
+			// the destructor waits for this so the Buffer stays alive while waiting threads are signaled and the callback is called
+			this->_endAsyncLoadRun();
 			return false;
 		}
 		this->source->open();
@@ -398,54 +1054,249 @@ namespace xal
 		{
 			this->asyncLoadQueued = false;
 			this->asyncLoadDiscarded = false;
+			lock.release();
+			this->_finishAsyncLoad(false);
 			return false;
 		}
+		this->asyncLoadRunning = true;
 		return true;
 	}
 
 	void Buffer::_decodeFromAsyncStream()
 	{
 		hmutex::ScopeLock lock(&this->asyncLoadMutex);
-		if (!this->asyncLoadQueued || this->asyncLoadDiscarded || this->loaded)
+		if (!this->asyncLoadQueued || this->asyncLoadDiscarded || this->asyncLoad->loaded)
 		{
+			bool discarded = (this->asyncLoadQueued && this->asyncLoadDiscarded);
 			this->source->close();
 			this->asyncLoadQueued = false;
 			this->asyncLoadDiscarded = false;
+			lock.release();
+			if (discarded)
+			{
+				this->_finishAsyncLoad(false);
+			}
+			else
+			{
+				this->_signalAsyncLoad();
+			}
+			this->_endAsyncLoadRun();
 			return;
 		}
 		this->_tryLoadMetaData();
-		this->stream.clear(this->source->getSize());
-		this->source->load(this->stream);
-		xal::manager->_convertStream(this->source, this->stream);
-		this->source->close();
+		if (!this->_isProgressiveLoadEnabled() || !this->_loadProgressively(lock))
+		{
+			this->_loadFromSource();
+		}
+		bool loaded = !this->asyncLoadDiscarded;
+		if (!loaded) // only possible with progressive loading
+		{
+			this->stream.clear(1);
+			this->_releaseView();
+			xal::manager->_onBufferCleared(this);
+		}
 		this->asyncLoadQueued = false;
 		this->asyncLoadDiscarded = false;
-		this->loaded = true;
+		this->asyncLoad->loaded = loaded;
+		lock.release();
+		this->_finishAsyncLoad(loaded);
+		// the destructor waits for this so the Buffer stays alive while waiting threads are signaled and the callback is called
+		this->_endAsyncLoadRun();
+	}
+
+	bool Buffer::_isProgressiveLoadEnabled()
+	{
+		if (xal::manager->progressiveLoadLeadTime <= 0.0f || !xal::manager->_isProgressiveLoadSupported())
+		{
+			return false;
+		}
+		// only Sources that can decode chunk by chunk
+		Format format = this->getFormat();
+		return (format == OGG || format == WAV || format == FLAC || format == SPX);
+	}
+
+	bool Buffer::_loadProgressively(hmutex::ScopeLock& lock)
+	{
+		int size = 0;
+		if (!xal::manager->_isConversionRequired(this->source) && this->source->_getDataView(&size) != NULL)
+		{
+			return false;
+		}
+		hstr key;
+		hstr filename = this->_makeDiskCacheFilename(key);
+		if (filename != "" && hfile::exists(filename))
+		{
+			return false;
+		}
+		this->_releaseView();
+		Converter* converter = xal::manager->_createConverter(this->source);
+		int remaining = this->source->getSize();
+		int capacity = remaining;
+		int frameSize = this->channels * this->bitsPerSample / 8;
+		int samplingRate = this->samplingRate;
+		if (converter != NULL)
+		{
+			capacity = converter->calcOutputSize(capacity); // includes what the resampler flushes at the end
+			frameSize = xal::manager->getChannels() * xal::manager->getBitsPerSample() / 8;
+			samplingRate = xal::manager->getSamplingRate();
+		}
+		// the stream must never be reallocated while it's being played so its whole capacity is prepared right away
+		this->stream.clear(hmax(capacity, 1));
+		this->stream.prepareManualWriteRaw(capacity);
+		this->stream.rewind();
+		unsigned char* data = (unsigned char*)this->stream;
+		this->progressiveLeadSize = hmin(hround(xal::manager->progressiveLoadLeadTime * samplingRate) * frameSize, capacity);
+		this->asyncLoad->loadedSize = 0;
+		this->asyncLoad->progressiveLoad = true;
+		lock.release();
+		unsigned char* chunk = (converter != NULL ? new unsigned char[PROGRESSIVE_LOAD_CHUNK_SIZE] : NULL);
+		int written = 0;
+		int read = 0;
+		while (true)
+		{
+			if (converter == NULL)
+			{
+				read = this->source->loadChunkRaw(&data[written], hmin(PROGRESSIVE_LOAD_CHUNK_SIZE, capacity - written));
+				written += read;
+			}
+			else
+			{
+				// data beyond the size that the Source announced wouldn't fit anymore
+				read = this->source->loadChunkRaw(chunk, hmin(PROGRESSIVE_LOAD_CHUNK_SIZE, remaining));
+				remaining -= read;
+				// whatever the resampler still holds belongs to the end of the data
+				written += (read > 0 ? converter->convert(chunk, read, &data[written]) : converter->flush(&data[written]));
+			}
+			lock.acquire(&this->asyncLoadMutex);
+			// published only after the data was written so readers never see undecoded data
+			this->asyncLoad->loadedSize = written;
+			if (read <= 0 || written >= capacity || this->asyncLoadDiscarded)
+			{
+				break;
+			}
+			lock.release();
+			// somebody might be waiting until the data becomes playable
+			this->_signalAsyncLoad();
+		}
+		bool discarded = this->asyncLoadDiscarded;
+		// the stream is still protected by asyncLoadRunning, the mixer shouldn't be blocked by the remaining work
+		lock.release();
+		if (!discarded && written < capacity)
+		{
+			// the rest of the stream is never accessed, but it's not left uninitialized
+			memset(&data[written], 0, (capacity - written) * sizeof(unsigned char));
+		}
+		if (chunk != NULL)
+		{
+			delete[] chunk;
+		}
+		if (converter != NULL)
+		{
+			delete converter;
+		}
+		this->source->close();
+		if (!discarded)
+		{
+			this->_saveToDiskCache();
+		}
+		lock.acquire(&this->asyncLoadMutex);
+		return true;
+	}
+
+	bool Buffer::waitForAsyncLoad(float timeout)
+	{
+		return this->_waitForAsyncLoad(timeout, false);
+	}
+
+	void Buffer::setAsyncLoadCallback(void (*callback)(Buffer*, bool, void*), void* userData)
+	{
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		this->asyncLoadCallback = callback;
+		this->asyncLoadCallbackData = userData;
 	}
 
-	void Buffer::_waitForAsyncLoad(float timeout)
+	bool Buffer::_waitForAsyncLoad(float timeout, bool playable)
 	{
 		BufferAsync::prioritizeLoad(this);
-		float time = timeout;
+		BufferAsync::update(); // makes sure there are workers that will signal the Buffer
+		int64_t end = htickCount() + (int64_t)(timeout * 1000.0f);
+		bool timedOut = false;
+		Condition::ScopeLock signalLock(&this->asyncLoad->condition);
 		hmutex::ScopeLock lock;
-		while (time > 0.0f || timeout <= 0.0f)
+		while (true)
 		{
 			lock.acquire(&this->asyncLoadMutex);
-			if (this->loaded || this->asyncLoadDiscarded)
+			// progressively loaded data can be used before it is complete
+			if (playable && this->asyncLoad->progressiveLoad && this->asyncLoad->loadedSize >= this->progressiveLeadSize)
+			{
+				return true;
+			}
+			if (this->asyncLoad->loaded || this->asyncLoadDiscarded || !this->asyncLoadQueued)
 			{
 				if (this->asyncLoadDiscarded)
 				{
-					this->loaded = false;
+					this->asyncLoad->loaded = false;
 				}
 				this->asyncLoadQueued = false;
 				this->asyncLoadDiscarded = false;
-				break;
+				return this->asyncLoad->loaded;
 			}
 			lock.release();
-			hthread::sleep(0.1f);
-			time -= 0.0001f;
-			BufferAsync::update();
+			if (timedOut)
+			{
+				return false;
+			}
+			// the state is only changed before signaling, so checking it while holding the condition's lock can't miss a wake-up
+			if (timeout <= 0.0f)
+			{
+				this->asyncLoad->condition.wait();
+			}
+			else if (!this->asyncLoad->condition.wait((float)hmax(end - htickCount(), (int64_t)0)))
+			{
+				timedOut = true; // the state is checked one last time
+			}
+		}
+	}
+
+	void Buffer::_signalAsyncLoad()
+	{
+		Condition::ScopeLock signalLock(&this->asyncLoad->condition);
+		this->asyncLoad->condition.broadcast();
+	}
+
+	void Buffer::_endAsyncLoadRun()
+	{
+		Condition::ScopeLock signalLock(&this->asyncLoad->condition);
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		this->asyncLoadRunning = false;
+		lock.release();
+		this->asyncLoad->condition.broadcast();
+	}
+
+	void Buffer::_finishAsyncLoad(bool loaded)
+	{
+		this->_signalAsyncLoad();
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		void (*callback)(Buffer*, bool, void*) = this->asyncLoadCallback;
+		void* userData = this->asyncLoadCallbackData;
+		lock.release();
+		if (callback != NULL)
+		{
+			callback(this, loaded, userData);
+		}
+	}
+
+	void Buffer::_cancelAsyncLoad()
+	{
+		hmutex::ScopeLock lock(&this->asyncLoadMutex);
+		if (!this->asyncLoadQueued)
+		{
+			return;
 		}
+		this->asyncLoadQueued = false;
+		this->asyncLoadDiscarded = false;
+		lock.release();
+		this->_finishAsyncLoad(false);
 	}
 
 }
@@ -11,6 +11,8 @@
 #endif
 
 #include <hltypes/harray.h>
+#include <hltypes/hlist.h>
+#include <hltypes/hlog.h>
 #include <hltypes/hmap.h>
 #include <hltypes/hmutex.h>
 #include <hltypes/hstream.h>
@@ -22,33 +24,20 @@
 
 namespace xal
 {
-	harray<Buffer*> BufferAsync::buffers;
-	int BufferAsync::loaded = 0;
-	hmutex BufferAsync::queueMutex;
-
-	hthread BufferAsync::readerThread(&BufferAsync::_read, "XAL async loader");
-	bool BufferAsync::readerRunning = false;
-
-	harray<hthread*> BufferAsync::decoderThreads;
+	Condition BufferAsync::condition;
+	harray<BufferAsync::Worker*> BufferAsync::workers;
+	int BufferAsync::workerCount = 0;
+	std::atomic<bool> BufferAsync::workersRunning(false);
+	harray<BufferAsync::Lane*> BufferAsync::lanes;
+	BufferAsync::Lane BufferAsync::priorityLane;
+	std::atomic<unsigned int> BufferAsync::nextLane(0);
+	std::atomic<int> BufferAsync::pending(0);
+	std::atomic<int> BufferAsync::active(0);
+	std::atomic<int> BufferAsync::idle(0);
 
 	static int cpus = 0; // needed, because certain calls are made when fetching SystemInfo that are not allowed to be made in secondary threads on some platforms
 
-	void BufferAsync::update()
-	{
-		hmutex::ScopeLock lock(&BufferAsync::queueMutex);
-		if (BufferAsync::readerRunning && !BufferAsync::readerThread.isRunning())
-		{
-			BufferAsync::readerThread.join();
-			BufferAsync::readerRunning = false;
-		}
-		if (!BufferAsync::readerRunning && BufferAsync::buffers.size() > 0) // new textures got queued in the meantime
-		{
-			BufferAsync::readerRunning = true;
-			BufferAsync::readerThread.start();
-		}
-	}
-
-	bool BufferAsync::queueLoad(Buffer* buffer)
+	static int _getCpuCount()
 	{
 		if (cpus == 0)
 		{
@@ -61,134 +50,335 @@ namespace xal
 #else // on Android and other Unix it's better to use CONF since they are more flexible than Apple's hardware and might switch cores on/off dynamically
 			cpus = (int)sysconf(_SC_NPROCESSORS_CONF);
 #endif
+			cpus = hmax(cpus, 1);
 		}
-		hmutex::ScopeLock lock(&BufferAsync::queueMutex);
-		if (BufferAsync::buffers.has(buffer))
+		return cpus;
+	}
+
+	void BufferAsync::initialize()
+	{
+		if (BufferAsync::lanes.size() > 0)
 		{
-			return false;
+			return;
 		}
-		BufferAsync::buffers += buffer;
-		if (!BufferAsync::readerRunning)
+		// one lane per core is enough to keep workers from contending, additional workers share lanes
+		int count = _getCpuCount();
+		for_iter (i, 0, count)
 		{
-			BufferAsync::readerRunning = true;
-			BufferAsync::readerThread.start();
+			BufferAsync::lanes += new Lane();
 		}
-		return true;
 	}
 
-	bool BufferAsync::prioritizeLoad(Buffer* buffer)
+	void BufferAsync::update()
 	{
-		hmutex::ScopeLock lock(&BufferAsync::queueMutex);
-		if (!BufferAsync::buffers.has(buffer))
+		Condition::ScopeLock lock(&BufferAsync::condition);
+		if (!BufferAsync::workersRunning && BufferAsync::pending > 0) // new buffers got queued while the pool was stopped
 		{
-			return false;
+			BufferAsync::_startWorkers();
 		}
-		int index = BufferAsync::buffers.indexOf(buffer);
-		if (index >= BufferAsync::loaded) // if not loaded from disk yet
+	}
+
+	bool BufferAsync::queueLoad(Buffer* buffer)
+	{
+		AsyncLoadState* state = buffer->asyncLoad;
+		// the entry of a previously discarded load is still queued or just being taken, it loads the Buffer again
+		if (state->lane != NO_LANE)
+		{
+			return true;
+		}
+		// round-robin distribution, idle workers will steal whatever ends up unevenly distributed
+		int index = (int)(BufferAsync::nextLane++ % (unsigned int)BufferAsync::lanes.size());
+		Lane* lane = BufferAsync::lanes[index];
+		++BufferAsync::pending;
+		hmutex::ScopeLock lock(&lane->mutex);
+		state->entry = lane->buffers.insert(lane->buffers.end(), buffer);
+		state->lane = index;
+		lock.release();
+		BufferAsync::_wakeWorker();
+		return true;
+	}
+
+	bool BufferAsync::prioritizeLoad(Buffer* buffer)
+	{
+		AsyncLoadState* state = buffer->asyncLoad;
+		hmutex::ScopeLock lock;
+		hmutex::ScopeLock priorityLock;
+		int index = NO_LANE;
+		Lane* lane = NULL;
+		while (true)
 		{
-			if (index > BufferAsync::loaded) // if not already at the front
+			index = state->lane;
+			if (index == NO_LANE)
+			{
+				return false;
+			}
+			if (index == PRIORITY_LANE || index == TAKEN_LANE)
+			{
+				return true;
+			}
+			lane = BufferAsync::lanes[index];
+			lock.acquire(&lane->mutex);
+			if (state->lane == index) // a worker could have taken the Buffer in the meantime
 			{
-				BufferAsync::buffers.removeAt(index);
-				BufferAsync::buffers.insertAt(BufferAsync::loaded, buffer);
+				break;
 			}
+			lock.release();
 		}
-		else if (index > 0) // if data was already loaded in RAM, but not decoded and not already at the front
+		// the entry is moved so the Buffer is never queued twice
+		priorityLock.acquire(&BufferAsync::priorityLane.mutex);
+		BufferAsync::priorityLane.buffers.splice(BufferAsync::priorityLane.buffers.end(), lane->buffers, state->entry);
+		state->lane = PRIORITY_LANE;
+		priorityLock.release();
+		lock.release();
+		BufferAsync::_wakeWorker();
+		return true;
+	}
+
+	bool BufferAsync::cancelLoad(Buffer* buffer)
+	{
+		AsyncLoadState* state = buffer->asyncLoad;
+		hmutex::ScopeLock lock;
+		int index = NO_LANE;
+		Lane* lane = NULL;
+		while (true)
 		{
-			BufferAsync::buffers.removeAt(index);
-			BufferAsync::buffers.addFirst(buffer);
+			index = state->lane;
+			if (index == NO_LANE || index == TAKEN_LANE)
+			{
+				return false;
+			}
+			lane = BufferAsync::_getLane(index);
+			lock.acquire(&lane->mutex);
+			if (state->lane == index) // the Buffer could have been prioritized or taken in the meantime
+			{
+				break;
+			}
+			lock.release();
 		}
+		lane->buffers.erase(state->entry);
+		state->lane = NO_LANE;
+		--BufferAsync::pending;
 		return true;
 	}
 
 	bool BufferAsync::isRunning()
 	{
-		hmutex::ScopeLock lock(&BufferAsync::queueMutex);
-		return BufferAsync::readerRunning;
+		return (BufferAsync::pending > 0 || BufferAsync::active > 0);
+	}
+
+	int BufferAsync::getWorkerCount()
+	{
+		Condition::ScopeLock lock(&BufferAsync::condition);
+		return (BufferAsync::workerCount > 0 ? BufferAsync::workerCount : _getCpuCount());
+	}
+
+	void BufferAsync::setWorkerCount(int value)
+	{
+		value = hmax(value, 0);
+		Condition::ScopeLock lock(&BufferAsync::condition);
+		if (BufferAsync::workerCount == value)
+		{
+			return;
+		}
+		BufferAsync::workerCount = value;
+		if (!BufferAsync::workersRunning)
+		{
+			return;
+		}
+		lock.release();
+		BufferAsync::_stopWorkers();
+		lock.acquire(&BufferAsync::condition);
+		// queued Buffers stay in their lanes and are picked up by the new workers
+		if (!BufferAsync::workersRunning && BufferAsync::pending > 0) // queueLoad() could have started them again in the meantime
+		{
+			BufferAsync::_startWorkers();
+		}
 	}
 
-	void BufferAsync::_read(hthread* thread)
+	void BufferAsync::destroy()
 	{
+		BufferAsync::_stopWorkers();
+		hlist<Buffer*> remaining;
+		Lane* lane = NULL;
 		Buffer* buffer = NULL;
-		bool streamLoaded = true;
-		hthread* decoderThread = NULL;
-		int index = 0;
-		int size = 0;
-		bool running = true;
-		hmutex::ScopeLock lock;
-		while (running)
+		for_iter (i, -1, BufferAsync::lanes.size())
 		{
-			running = false;
-			// check for new queued textures
-			lock.acquire(&BufferAsync::queueMutex);
-			if (BufferAsync::buffers.size() > BufferAsync::loaded)
+			lane = (i >= 0 ? BufferAsync::lanes[i] : &BufferAsync::priorityLane);
+			hmutex::ScopeLock lock(&lane->mutex);
+			while (lane->buffers.size() > 0)
 			{
-				running = true;
-				buffer = BufferAsync::buffers[BufferAsync::loaded];
-				lock.release();
-				streamLoaded = buffer->_prepareAsyncStream();
-				lock.acquire(&BufferAsync::queueMutex);
-				index = BufferAsync::buffers.indexOf(buffer); // it's possible that the queue was rearranged in the meantime
-				if (streamLoaded)
-				{
-					if (index >= BufferAsync::loaded)
-					{
-						if (index > BufferAsync::loaded) // if texture was moved towards the back of the queue
-						{
-							// put it back to the current decoder position
-							BufferAsync::buffers.removeAt(index);
-							BufferAsync::buffers.insertAt(BufferAsync::loaded, buffer);
-						}
-					}
-					++BufferAsync::loaded;
-				}
-				else // it was canceled
-				{
-					BufferAsync::buffers.removeAt(index);
-				}
+				buffer = lane->buffers.removeFirst();
+				buffer->asyncLoad->lane = NO_LANE;
+				remaining += buffer;
+				--BufferAsync::pending;
 			}
-			size = BufferAsync::loaded;
-			lock.release();
-			// create new worker threads if needed
-			if (size > 0)
-			{
-				running = true;
-				size = hmin(size, cpus) - BufferAsync::decoderThreads.size();
-				for_iter (i, 0, size)
-				{
-					decoderThread = new hthread(&BufferAsync::_decode, "XAL async decoder");
-					BufferAsync::decoderThreads += decoderThread;
-					decoderThread->start();
-				}
-			}
-			// check current worker threads' status
-			if (BufferAsync::decoderThreads.size() > 0)
+		}
+		foreach (Lane*, it, BufferAsync::lanes)
+		{
+			delete (*it);
+		}
+		BufferAsync::lanes.clear();
+		// the Buffers would otherwise stay queued forever and never load again
+		while (remaining.size() > 0)
+		{
+			remaining.removeFirst()->_cancelAsyncLoad();
+		}
+	}
+
+	void BufferAsync::_startWorkers()
+	{
+		if (BufferAsync::workersRunning)
+		{
+			return;
+		}
+		int count = (BufferAsync::workerCount > 0 ? BufferAsync::workerCount : _getCpuCount());
+		hlog::debugf(logTag, "Starting %d async decoder workers.", count);
+		Worker* worker = NULL;
+		for_iter (i, 0, count)
+		{
+			worker = new Worker();
+			worker->thread = new hthread(&BufferAsync::_process, hsprintf("XAL async decoder %d", i));
+			worker->index = i;
+			worker->running = true;
+			BufferAsync::workers += worker;
+		}
+		BufferAsync::workersRunning = true;
+		// workers look themselves up in the list, but they can't do that before the caller releases the lock
+		foreach (Worker*, it, BufferAsync::workers)
+		{
+			(*it)->thread->start();
+		}
+	}
+
+	void BufferAsync::_stopWorkers()
+	{
+		Condition::ScopeLock lock(&BufferAsync::condition);
+		if (!BufferAsync::workersRunning)
+		{
+			return;
+		}
+		harray<Worker*> stopped = BufferAsync::workers;
+		BufferAsync::workers.clear();
+		BufferAsync::workersRunning = false;
+		foreach (Worker*, it, stopped)
+		{
+			(*it)->running = false;
+		}
+		BufferAsync::condition.broadcast();
+		lock.release();
+		// a worker might be in the middle of loading a Buffer which has to finish first
+		foreach (Worker*, it, stopped)
+		{
+			(*it)->thread->join();
+			delete (*it)->thread;
+			delete (*it);
+		}
+	}
+
+	void BufferAsync::_wakeWorker()
+	{
+		// pending is always incremented before this is called, a worker that goes idle afterwards sees it and doesn't wait
+		if (BufferAsync::idle == 0 && BufferAsync::workersRunning)
+		{
+			return;
+		}
+		Condition::ScopeLock lock(&BufferAsync::condition);
+		if (!BufferAsync::workersRunning)
+		{
+			BufferAsync::_startWorkers();
+		}
+		BufferAsync::condition.signal();
+	}
+
+	BufferAsync::Lane* BufferAsync::_getLane(int index)
+	{
+		return (index == PRIORITY_LANE ? &BufferAsync::priorityLane : BufferAsync::lanes[index]);
+	}
+
+	Buffer* BufferAsync::_takeFrom(Lane* lane, bool front)
+	{
+		hmutex::ScopeLock lock(&lane->mutex);
+		if (lane->buffers.size() == 0)
+		{
+			return NULL;
+		}
+		Buffer* buffer = (front ? lane->buffers.removeFirst() : lane->buffers.removeLast());
+		// the Buffer clears this once it's locked by the worker, until then it must not be destroyed
+		buffer->asyncLoad->lane = TAKEN_LANE;
+		return buffer;
+	}
+
+	Buffer* BufferAsync::_take(Worker* worker)
+	{
+		// the priority lane always goes first
+		Buffer* buffer = BufferAsync::_takeFrom(&BufferAsync::priorityLane, true);
+		if (buffer != NULL)
+		{
+			return buffer;
+		}
+		// own lane is processed in queueing order
+		int size = BufferAsync::lanes.size();
+		int index = worker->index % size;
+		buffer = BufferAsync::_takeFrom(BufferAsync::lanes[index], true);
+		if (buffer != NULL)
+		{
+			return buffer;
+		}
+		// stealing from the back of the other lanes so their owners keep their queueing order
+		for_iter (i, 1, size)
+		{
+			buffer = BufferAsync::_takeFrom(BufferAsync::lanes[(index + i) % size], false);
+			if (buffer != NULL)
 			{
-				running = true;
-				for_iter (i, 0, BufferAsync::decoderThreads.size())
-				{
-					if (!BufferAsync::decoderThreads[i]->isRunning())
-					{
-						decoderThread = BufferAsync::decoderThreads.removeAt(i);
-						decoderThread->join();
-						delete decoderThread;
-						--i;
-					}
-				}
+				return buffer;
 			}
 		}
+		return NULL;
 	}
 
-	void BufferAsync::_decode(hthread* thread)
+	void BufferAsync::_process(hthread* thread)
 	{
+		Condition::ScopeLock lock(&BufferAsync::condition);
+		Worker* worker = NULL;
+		foreach (Worker*, it, BufferAsync::workers)
+		{
+			if ((*it)->thread == thread)
+			{
+				worker = (*it);
+				break;
+			}
+		}
+		lock.release();
+		if (worker == NULL) // the pool was already stopped again before this worker got to run
+		{
+			return;
+		}
 		Buffer* buffer = NULL;
-		hmutex::ScopeLock lock(&BufferAsync::queueMutex);
-		while (BufferAsync::loaded > 0)
+		// the Worker stays valid until this thread has been joined
+		while (worker->running)
 		{
-			buffer = BufferAsync::buffers.removeFirst();
-			--BufferAsync::loaded;
-			lock.release();
-			buffer->_decodeFromAsyncStream();
-			lock.acquire(&BufferAsync::queueMutex);
+			buffer = BufferAsync::_take(worker);
+			if (buffer == NULL)
+			{
+				lock.acquire(&BufferAsync::condition);
+				// queueLoad() only wakes up workers that are counted as idle, so this has to be counted before checking
+				++BufferAsync::idle;
+				if (BufferAsync::pending <= 0 && worker->running)
+				{
+					BufferAsync::condition.wait();
+				}
+				--BufferAsync::idle;
+				lock.release();
+				continue;
+			}
+			++BufferAsync::active;
+			--BufferAsync::pending;
+			// stale entries (e.g. already loaded synchronously) are rejected by the Buffer itself
+			if (buffer->_prepareAsyncStream())
+			{
+				buffer->_decodeFromAsyncStream();
+			}
+			--BufferAsync::active;
 		}
 	}
 
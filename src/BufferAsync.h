@@ -13,6 +13,8 @@
 #ifndef XAL_BUFFER_ASYNC_H
 #define XAL_BUFFER_ASYNC_H
 
+#include <atomic>
+
 #include <hltypes/harray.h>
 #include <hltypes/hlist.h>
 #include <hltypes/hmap.h>
@@ -21,39 +23,136 @@
 #include <hltypes/hthread.h>
 #include <hltypes/hstring.h>
 
+#include "Condition.h"
 #include "xalExport.h"
 
+/// @brief Lane index of a Buffer that is not queued.
+#define NO_LANE -1
+/// @brief Lane index of a Buffer that is queued in the priority lane.
+#define PRIORITY_LANE -2
+/// @brief Lane index of a Buffer that a worker has taken out of its lane, but not started loading yet.
+#define TAKEN_LANE -3
+
 namespace xal
 {
 	class Buffer;
 
+	/// @brief State of a Buffer's asynchronous load that is accessed by waiting threads and the audio-system.
+	struct AsyncLoadState
+	{
+		/// @brief Wakes up threads that wait for the load when its state changes.
+		/// @note Its lock is always acquired before the Buffer's asyncLoadMutex.
+		Condition condition;
+		/// @brief Whether the Buffer's data was loaded.
+		/// @note Only changed while asyncLoadMutex is locked, but it can be read without locking.
+		std::atomic<bool> loaded;
+		/// @brief Whether the data is loaded progressively, i.e. the stream's capacity is preallocated and only loadedSize bytes are valid.
+		/// @note The data can be played while it's being decoded as long as only loadedSize bytes are accessed.
+		std::atomic<bool> progressiveLoad;
+		/// @brief Byte-size of the progressively loaded data that has been decoded so far.
+		std::atomic<int> loadedSize;
+		/// @brief Index of the BufferAsync lane that holds the Buffer's queue entry, NO_LANE, PRIORITY_LANE or TAKEN_LANE.
+		/// @note Only changed while the lane's lock is held, except that TAKEN_LANE is cleared while asyncLoadMutex is locked.
+		std::atomic<int> lane;
+		/// @brief Position of the queue entry in its lane so it can be moved and removed without searching.
+		hlist<Buffer*>::iterator entry;
+
+		AsyncLoadState() : loaded(false), progressiveLoad(false), loadedSize(0), lane(NO_LANE) { }
+
+	};
+
+	/// @brief Persistent pool of decoder workers for asynchronous Buffer loading.
+	/// @note Queued Buffers are spread over lanes that each have their own lock. Every worker owns a lane and steals from the
+	/// other lanes when its own lane runs empty.
+	/// @note The lanes outlive the workers so the worker count can change while Buffers are being queued.
 	class BufferAsync
 	{
 	public:
+		/// @brief Creates the lanes.
+		/// @note Has to be called before any Buffer is queued.
+		static void initialize();
 		static void update();
+		/// @brief Queues a Buffer for loading.
+		/// @param[in] buffer The Buffer.
+		/// @return True if the Buffer is queued.
+		/// @note The Buffer's asyncLoadMutex must be locked by the calling thread and asyncLoadQueued has to be checked first,
+		/// because the pool doesn't search for already queued Buffers.
 		static bool queueLoad(Buffer* buffer);
+		/// @brief Moves a queued Buffer to the priority lane.
+		/// @param[in] buffer The Buffer.
+		/// @return False if the Buffer is not queued (anymore).
 		static bool prioritizeLoad(Buffer* buffer);
+		/// @brief Removes a queued Buffer from its lane.
+		/// @param[in] buffer The Buffer.
+		/// @return False if the Buffer is not queued (anymore).
+		/// @note A worker could have already taken the Buffer out of its lane. It accesses the Buffer until it has cleared TAKEN_LANE.
+		static bool cancelLoad(Buffer* buffer);
 		static bool isRunning();
+		static int getWorkerCount();
+		/// @brief Sets the number of decoder workers.
+		/// @param[in] value Number of workers. A value of 0 or less uses the number of available CPU cores.
+		/// @note Already queued Buffers stay queued in their lanes.
+		static void setWorkerCount(int value);
+		/// @brief Stops all workers, cancels the loads of all queued Buffers and destroys the lanes.
+		static void destroy();
 
 	protected:
-		static harray<Buffer*> buffers;
-		static int loaded;
-		static hmutex queueMutex;
+		/// @brief A deque of queued Buffers with its own lock.
+		struct Lane
+		{
+			hmutex mutex;
+			hlist<Buffer*> buffers;
+		};
 
-		static hthread readerThread;
-		static bool readerRunning;
+		/// @brief A single decoder worker.
+		struct Worker
+		{
+			hthread* thread;
+			/// @brief Index in the workers array, also selects the worker's own lane.
+			int index;
+			/// @brief Cleared when the worker has to exit.
+			std::atomic<bool> running;
+		};
 
-		static harray<hthread*> decoderThreads;
+		/// @brief Guards the workers and wakes up idle workers.
+		/// @note A lane's lock is never acquired while this lock is held.
+		static Condition condition;
+		static harray<Worker*> workers;
+		static int workerCount;
+		static std::atomic<bool> workersRunning;
+		static harray<Lane*> lanes;
+		static Lane priorityLane;
+		static std::atomic<unsigned int> nextLane;
+		/// @brief Number of queued Buffers.
+		/// @note Incremented before a Buffer is added to a lane so idle workers never miss it.
+		static std::atomic<int> pending;
+		/// @brief Number of Buffers that are being loaded.
+		static std::atomic<int> active;
+		/// @brief Number of workers that wait for Buffers to be queued.
+		static std::atomic<int> idle;
 
-		static void _read(hthread* thread);
-		static void _decode(hthread* thread);
+		/// @note The pool lock must be held by the calling thread.
+		static void _startWorkers();
+		/// @brief Stops all workers.
+		/// @note The pool lock must not be held by the calling thread, because it waits for the workers to exit.
+		static void _stopWorkers();
+		/// @brief Starts the workers if necessary and wakes up an idle one.
+		static void _wakeWorker();
+		static Lane* _getLane(int index);
+		/// @brief Takes a Buffer out of a lane.
+		/// @param[in] lane The lane.
+		/// @param[in] front Whether to take the first Buffer instead of the last one.
+		/// @return The Buffer or NULL if the lane is empty.
+		static Buffer* _takeFrom(Lane* lane, bool front);
+		static Buffer* _take(Worker* worker);
+		static void _process(hthread* thread);
 
 	private: // prevents inheritance and instantiation
 		BufferAsync() { }
 		~BufferAsync() { }
 
 	};
-	
+
 }
 
 #endif
@@ -0,0 +1,186 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#include <string.h>
+
+#include <hltypes/harray.h>
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hthread.h>
+
+#include "xal.h"
+#include "Buffer.h"
+#include "BufferStream.h"
+#include "Condition.h"
+
+#define STREAM_SERVICE_INTERVAL 20 // in milliseconds, safety net in case a wake-up is missed
+
+namespace xal
+{
+	StreamRing::StreamRing(int capacity)
+	{
+		unsigned int size = 2;
+		while ((int)size < capacity)
+		{
+			size <<= 1;
+		}
+		this->mask = size - 1;
+		this->data = new unsigned char[size];
+		this->writePosition.store(0, std::memory_order_relaxed);
+		this->readPosition.store(0, std::memory_order_relaxed);
+	}
+
+	StreamRing::~StreamRing()
+	{
+		delete[] this->data;
+	}
+
+	int StreamRing::getAvailable()
+	{
+		return (int)(this->writePosition.load(std::memory_order_acquire) - this->readPosition.load(std::memory_order_relaxed));
+	}
+
+	int StreamRing::getFree()
+	{
+		return (this->getCapacity() - (int)(this->writePosition.load(std::memory_order_relaxed) - this->readPosition.load(std::memory_order_acquire)));
+	}
+
+	int StreamRing::write(const unsigned char* data, int size)
+	{
+		unsigned int position = this->writePosition.load(std::memory_order_relaxed);
+		size = hmin(size, this->getFree());
+		if (size <= 0)
+		{
+			return 0;
+		}
+		int index = (int)(position & this->mask);
+		int first = hmin(size, this->getCapacity() - index);
+		memcpy(&this->data[index], data, first * sizeof(unsigned char));
+		if (size > first)
+		{
+			memcpy(this->data, &data[first], (size - first) * sizeof(unsigned char));
+		}
+		// publishes the data to the consumer
+		this->writePosition.store(position + size, std::memory_order_release);
+		return size;
+	}
+
+	int StreamRing::read(unsigned char* output, int size)
+	{
+		unsigned int position = this->readPosition.load(std::memory_order_relaxed);
+		size = hmin(size, this->getAvailable());
+		if (size <= 0)
+		{
+			return 0;
+		}
+		int index = (int)(position & this->mask);
+		int first = hmin(size, this->getCapacity() - index);
+		memcpy(output, &this->data[index], first * sizeof(unsigned char));
+		if (size > first)
+		{
+			memcpy(&output[first], this->data, (size - first) * sizeof(unsigned char));
+		}
+		// hands the space back to the producer
+		this->readPosition.store(position + size, std::memory_order_release);
+		return size;
+	}
+
+	void StreamRing::reset()
+	{
+		this->writePosition.store(0, std::memory_order_relaxed);
+		this->readPosition.store(0, std::memory_order_relaxed);
+	}
+
+	hthread* BufferStream::thread = NULL;
+	bool BufferStream::running = false;
+	harray<Buffer*> BufferStream::buffers;
+	Buffer* BufferStream::current = NULL;
+	bool BufferStream::pending = false;
+
+	Condition BufferStream::condition;
+
+	void BufferStream::add(Buffer* buffer)
+	{
+		Condition::ScopeLock lock(&BufferStream::condition);
+		BufferStream::buffers |= buffer;
+		BufferStream::pending = true;
+		if (!BufferStream::running)
+		{
+			hlog::debug(logTag, "Starting streaming service thread.");
+			BufferStream::running = true;
+			BufferStream::thread = new hthread(&BufferStream::_process, "XAL streaming service");
+			BufferStream::thread->start();
+		}
+		BufferStream::condition.broadcast();
+	}
+
+	void BufferStream::remove(Buffer* buffer)
+	{
+		Condition::ScopeLock lock(&BufferStream::condition);
+		BufferStream::buffers /= buffer;
+		while (BufferStream::current == buffer)
+		{
+			BufferStream::condition.wait();
+		}
+	}
+
+	void BufferStream::wake()
+	{
+		Condition::ScopeLock lock(&BufferStream::condition);
+		BufferStream::pending = true;
+		BufferStream::condition.broadcast();
+	}
+
+	void BufferStream::destroy()
+	{
+		Condition::ScopeLock lock(&BufferStream::condition);
+		BufferStream::buffers.clear();
+		if (!BufferStream::running)
+		{
+			return;
+		}
+		BufferStream::running = false;
+		BufferStream::condition.broadcast();
+		lock.release();
+		BufferStream::thread->join();
+		delete BufferStream::thread;
+		BufferStream::thread = NULL;
+	}
+
+	void BufferStream::_process(hthread* thread)
+	{
+		Buffer* buffer = NULL;
+		bool decoded = false;
+		Condition::ScopeLock lock(&BufferStream::condition);
+		while (BufferStream::running)
+		{
+			BufferStream::pending = false;
+			decoded = false;
+			// Buffers removed in the meantime shift the array, at worst one Buffer waits for the next pass
+			for_iter (i, 0, BufferStream::buffers.size())
+			{
+				buffer = BufferStream::buffers[i];
+				BufferStream::current = buffer;
+				lock.release();
+				if (buffer->_decodeAhead() > 0)
+				{
+					decoded = true;
+				}
+				lock.acquire(&BufferStream::condition);
+				BufferStream::current = NULL;
+				BufferStream::condition.broadcast();
+			}
+			// keeps going while there is still something to decode
+			if (!decoded && !BufferStream::pending && BufferStream::running)
+			{
+				BufferStream::condition.wait((float)STREAM_SERVICE_INTERVAL);
+			}
+		}
+	}
+
+}
@@ -0,0 +1,146 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Defines the streaming service that decodes streamed Buffers ahead of playback.
+
+#ifndef XAL_BUFFER_STREAM_H
+#define XAL_BUFFER_STREAM_H
+
+#include <atomic>
+
+#include <hltypes/harray.h>
+#include <hltypes/hmutex.h>
+#include <hltypes/hthread.h>
+
+#include "Condition.h"
+#include "xalExport.h"
+
+namespace xal
+{
+	class Buffer;
+
+	/// @brief Bounded single-producer single-consumer ring of bytes that does not require locking.
+	/// @note Only one thread may write and only one thread may read at the same time.
+	class StreamRing
+	{
+	public:
+		/// @brief Constructor.
+		/// @param[in] capacity Byte-size of the ring. Rounded up to a power of 2.
+		StreamRing(int capacity);
+		~StreamRing();
+
+		inline int getCapacity() { return (int)(this->mask + 1); }
+		/// @return Number of bytes that can be read.
+		/// @note Only the consumer may call this.
+		int getAvailable();
+		/// @return Number of bytes that can be written.
+		/// @note Only the producer may call this.
+		int getFree();
+
+		/// @brief Appends data to the ring.
+		/// @param[in] data The data.
+		/// @param[in] size Byte-size of the data.
+		/// @return Number of bytes that fit into the ring.
+		int write(const unsigned char* data, int size);
+		/// @brief Removes data from the ring.
+		/// @param[out] output Memory where the data will be stored.
+		/// @param[in] size Maximum number of bytes to read.
+		/// @return Number of bytes read.
+		int read(unsigned char* output, int size);
+		/// @brief Discards all data in the ring.
+		/// @note Neither the producer nor the consumer may access the ring at the same time.
+		void reset();
+
+	protected:
+		/// @brief The ring.
+		unsigned char* data;
+		/// @brief Index mask of the ring.
+		unsigned int mask;
+		/// @brief Total number of bytes written, owned by the producer.
+		std::atomic<unsigned int> writePosition;
+		/// @brief Total number of bytes read, owned by the consumer.
+		std::atomic<unsigned int> readPosition;
+
+	private:
+		StreamRing(const StreamRing& other);
+		StreamRing& operator=(const StreamRing& other);
+
+	};
+
+	/// @brief Read-ahead state of a streamed Buffer that is shared with the streaming service.
+	/// @note The Source is only decoded while decodeMutex is held, mutex is only held briefly to publish or discard data.
+	struct ReadAhead
+	{
+		/// @brief Audio data that was decoded ahead by the streaming service.
+		/// @note NULL if the streaming service is not used for the Buffer.
+		StreamRing* ring;
+		/// @brief Persistent memory into which the streaming service decodes before the data is moved into the ring.
+		unsigned char* data;
+		/// @brief Byte-size of data.
+		int capacity;
+		/// @brief Mutex for access of the ring, generation and rewindRequested.
+		hmutex mutex;
+		/// @brief Mutex that makes sure that only one thread decodes from the Source at the same time.
+		hmutex decodeMutex;
+		/// @brief Whether the streaming service should rewind the Source when its end is reached.
+		std::atomic<bool> looping;
+		/// @brief Whether the streaming service reached the end of the Source.
+		std::atomic<bool> ended;
+		/// @brief Whether the ring was filled at least once since the last rewind.
+		bool primed;
+		/// @brief Whether the Source has to be rewound before anything else is decoded.
+		bool rewindRequested;
+		/// @brief Incremented on every rewind so data that was decoded for the old position is discarded.
+		unsigned int generation;
+
+		ReadAhead() : ring(NULL), data(NULL), capacity(0), looping(false), ended(false), primed(false), rewindRequested(false), generation(0) { }
+
+	};
+
+	/// @brief Streaming service thread that keeps the read-ahead rings of streamed Buffers filled.
+	/// @note The update and mixer threads only consume already decoded data from the rings.
+	class BufferStream
+	{
+	public:
+		/// @brief Adds a Buffer to the streaming service and starts the thread if needed.
+		/// @param[in] buffer The Buffer.
+		static void add(Buffer* buffer);
+		/// @brief Removes a Buffer from the streaming service.
+		/// @param[in] buffer The Buffer.
+		/// @note Blocks until the thread has stopped decoding the Buffer's data.
+		static void remove(Buffer* buffer);
+		/// @brief Notifies the thread that data was consumed.
+		static void wake();
+		/// @brief Stops the thread and removes all Buffers.
+		static void destroy();
+
+	protected:
+		static hthread* thread;
+		static bool running;
+		static harray<Buffer*> buffers;
+		/// @brief The Buffer that is currently being decoded by the thread.
+		static Buffer* current;
+		static bool pending;
+
+		/// @brief Guards the members above.
+		/// @note Broadcast when there is something to decode and when the thread has finished decoding a Buffer.
+		static Condition condition;
+
+		static void _process(hthread* thread);
+
+	private: // prevents inheritance and instantiation
+		BufferStream() { }
+		~BufferStream() { }
+
+	};
+
+}
+
+#endif
@@ -14,7 +14,8 @@
 
 namespace xal
 {
-	Category::Category(chstr name, BufferMode bufferMode, SourceMode sourceMode) : gain(1.0f)
+	Category::Category(chstr name, BufferMode bufferMode, SourceMode sourceMode) : gain(1.0f), priority(0), streamBufferCount(0), streamBufferSize(0),
+		streamShared(false), vorbisDecoder(VORBIS_DEFAULT)
 	{
 		this->name = name;
 		this->bufferMode = bufferMode;
@@ -32,9 +33,33 @@ namespace xal
 		xal::manager->_setGlobalGain(xal::manager->globalGain); // updates all Player instances with the new category gain
 	}
 
+	void Category::setStreamBufferCount(int value)
+	{
+		hmutex::ScopeLock lock(&xal::manager->mutex);
+		this->streamBufferCount = (value > 0 ? hmax(value, 2) : 0);
+	}
+
+	void Category::setStreamBufferSize(int value)
+	{
+		hmutex::ScopeLock lock(&xal::manager->mutex);
+		this->streamBufferSize = (value > 0 ? AudioManager::_roundStreamBufferSize(value) : 0);
+	}
+
+	void Category::setStreamShared(bool value)
+	{
+		hmutex::ScopeLock lock(&xal::manager->mutex);
+		this->streamShared = value;
+	}
+
+	void Category::setVorbisDecoder(VorbisDecoder value)
+	{
+		hmutex::ScopeLock lock(&xal::manager->mutex);
+		this->vorbisDecoder = value;
+	}
+
 	bool Category::isStreamed()
 	{
-		return (this->bufferMode == STREAMED);
+		return (this->bufferMode == STREAMED || this->bufferMode == COMPRESSED);
 	}
 
 	bool Category::isMemoryManaged()
@@ -0,0 +1,106 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#include <string.h>
+
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hstring.h>
+
+#include "CommandQueue.h"
+
+namespace xal
+{
+	Command::Command() : type(NONE), player(NULL), nameTruncated(false), fadeTime(0.0f), looping(false), value(0.0f)
+	{
+		this->name[0] = '\0';
+	}
+
+	Command::Command(Type type, Player* player, chstr name, float fadeTime, bool looping, float value)
+	{
+		this->type = type;
+		this->player = player;
+		int size = hmin(name.size(), COMMAND_NAME_SIZE - 1);
+		memcpy(this->name, name.cStr(), size * sizeof(char));
+		this->name[size] = '\0';
+		this->nameTruncated = (name.size() >= COMMAND_NAME_SIZE);
+		this->fadeTime = fadeTime;
+		this->looping = looping;
+		this->value = value;
+	}
+
+	PlayerState::PlayerState() : gain(1.0f), pitch(1.0f), playing(false), samplePosition(0), pendingCommands(0), paused(false)
+	{
+	}
+
+	CommandQueue::CommandQueue(int capacity) : dequeuePosition(0), active(false)
+	{
+		unsigned int size = 2;
+		while ((int)size < capacity)
+		{
+			size <<= 1;
+		}
+		this->mask = size - 1;
+		this->cells = new Cell[size];
+		for_itert (unsigned int, i, 0, size)
+		{
+			this->cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+		this->enqueuePosition.store(0, std::memory_order_relaxed);
+	}
+
+	CommandQueue::~CommandQueue()
+	{
+		delete[] this->cells;
+	}
+
+	bool CommandQueue::push(const Command& command)
+	{
+		Cell* cell = NULL;
+		unsigned int position = this->enqueuePosition.load(std::memory_order_relaxed);
+		unsigned int sequence = 0;
+		int difference = 0;
+		while (true)
+		{
+			cell = &this->cells[position & this->mask];
+			sequence = cell->sequence.load(std::memory_order_acquire);
+			difference = (int)(sequence - position);
+			if (difference == 0) // slot is free, try to claim it
+			{
+				if (this->enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (difference < 0) // consumer hasn't freed this slot yet, the queue is full
+			{
+				return false;
+			}
+			else // another producer claimed the slot in the meantime
+			{
+				position = this->enqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+		cell->command = command;
+		cell->sequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool CommandQueue::pop(Command& command)
+	{
+		Cell* cell = &this->cells[this->dequeuePosition & this->mask];
+		if (cell->sequence.load(std::memory_order_acquire) != this->dequeuePosition + 1) // nothing was published to this slot yet
+		{
+			return false;
+		}
+		command = cell->command;
+		cell->sequence.store(this->dequeuePosition + this->mask + 1, std::memory_order_release);
+		++this->dequeuePosition;
+		return true;
+	}
+
+}
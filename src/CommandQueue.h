@@ -0,0 +1,151 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Defines a lock-free command queue for deferred execution of calls on the update thread.
+
+#ifndef XAL_COMMAND_QUEUE_H
+#define XAL_COMMAND_QUEUE_H
+
+#include <atomic>
+
+#include <hltypes/hstring.h>
+
+#include "xalExport.h"
+
+#define COMMAND_NAME_SIZE 64 // names are stored inline so pushing a Command never allocates memory
+
+namespace xal
+{
+	class Player;
+
+	/// @brief A single deferred call into the audio system.
+	class Command
+	{
+	public:
+		enum Type
+		{
+			NONE,
+			PLAY,
+			PLAY_ASYNC,
+			STOP,
+			STOP_FIRST,
+			STOP_ALL,
+			STOP_CATEGORY,
+			PLAYER_PLAY,
+			PLAYER_PLAY_ASYNC,
+			PLAYER_STOP,
+			PLAYER_PAUSE,
+			PLAYER_SET_GAIN,
+			PLAYER_SET_PITCH
+		};
+
+		Command();
+		Command(Type type, Player* player, chstr name, float fadeTime = 0.0f, bool looping = false, float value = 0.0f);
+
+		/// @return False if the name was too long to be stored and the Command cannot be queued.
+		inline bool isValid() const { return !this->nameTruncated; }
+
+		/// @brief Type of the call.
+		Type type;
+		/// @brief The Player the call refers to.
+		/// @note NULL for calls on the AudioManager.
+		Player* player;
+		/// @brief Sound or Category name the call refers to.
+		char name[COMMAND_NAME_SIZE];
+		/// @brief Whether the name did not fit into the inline storage.
+		bool nameTruncated;
+		/// @brief Fade time parameter.
+		float fadeTime;
+		/// @brief Looping parameter.
+		bool looping;
+		/// @brief Gain or pitch parameter.
+		float value;
+
+	};
+
+	/// @brief State of a Player as last seen by the update thread.
+	/// @note Used for lock-free reading when the AudioManager defers Commands.
+	class PlayerState
+	{
+	public:
+		PlayerState();
+
+		/// @brief Gain as last seen by the update thread.
+		std::atomic<float> gain;
+		/// @brief Pitch as last seen by the update thread.
+		std::atomic<float> pitch;
+		/// @brief Playing state as last seen by the update thread.
+		std::atomic<bool> playing;
+		/// @brief Sample position as last seen by the update thread.
+		std::atomic<unsigned int> samplePosition;
+		/// @brief Number of queued Commands for the Player that haven't been executed yet.
+		/// @note While there are any, the update thread doesn't overwrite what the caller already published.
+		std::atomic<int> pendingCommands;
+		/// @brief Whether the Player was paused when the state was last published.
+		/// @note Only accessed by the update thread.
+		bool paused;
+
+	};
+
+	/// @brief Bounded multi-producer single-consumer ring of Commands that does not require locking.
+	/// @note Any thread may push. Only the thread that holds the AudioManager mutex may pop.
+	class CommandQueue
+	{
+	public:
+		/// @brief Constructor.
+		/// @param[in] capacity Number of Commands that fit into the queue. Rounded up to a power of 2.
+		CommandQueue(int capacity);
+		~CommandQueue();
+
+		/// @brief Adds a Command to the queue.
+		/// @param[in] command The Command.
+		/// @return False if the queue is full.
+		bool push(const Command& command);
+		/// @brief Removes the oldest Command from the queue.
+		/// @param[out] command The Command.
+		/// @return False if the queue is empty.
+		bool pop(Command& command);
+		/// @return True if Commands are being queued.
+		inline bool isActive() { return this->active.load(std::memory_order_acquire); }
+		/// @brief Sets whether Commands are being queued.
+		/// @param[in] value Whether Commands are being queued.
+		/// @note Requires the AudioManager mutex to be locked.
+		inline void setActive(bool value) { this->active.store(value, std::memory_order_release); }
+
+	protected:
+		/// @brief A slot in the ring.
+		/// @note The sequence number tells producers and the consumer whose turn it is to access the slot.
+		struct Cell
+		{
+			std::atomic<unsigned int> sequence;
+			Command command;
+		};
+
+		/// @brief The ring.
+		Cell* cells;
+		/// @brief Index mask of the ring.
+		unsigned int mask;
+		/// @brief Next write position, shared by all producers.
+		std::atomic<unsigned int> enqueuePosition;
+		/// @brief Next read position, owned by the consumer.
+		unsigned int dequeuePosition;
+		/// @brief Whether Commands are being queued.
+		/// @note Read by any thread, so it can't be derived from the AudioManager's unsynchronized flags.
+		std::atomic<bool> active;
+
+	private:
+		CommandQueue(const CommandQueue& other);
+		CommandQueue& operator=(const CommandQueue& other);
+
+	};
+
+}
+
+#endif
@@ -0,0 +1,104 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+#include "Condition.h"
+
+namespace xal
+{
+	struct ConditionData
+	{
+		std::mutex mutex;
+		std::condition_variable condition;
+	};
+
+	Condition::ScopeLock::ScopeLock(Condition* condition)
+	{
+		this->condition = NULL;
+		this->acquire(condition);
+	}
+
+	Condition::ScopeLock::~ScopeLock()
+	{
+		this->release();
+	}
+
+	bool Condition::ScopeLock::acquire(Condition* condition)
+	{
+		if (this->condition != NULL || condition == NULL)
+		{
+			return false;
+		}
+		this->condition = condition;
+		this->condition->_lock();
+		return true;
+	}
+
+	bool Condition::ScopeLock::release()
+	{
+		if (this->condition == NULL)
+		{
+			return false;
+		}
+		this->condition->_unlock();
+		this->condition = NULL;
+		return true;
+	}
+
+	Condition::Condition()
+	{
+		this->data = new ConditionData();
+	}
+
+	Condition::~Condition()
+	{
+		delete (ConditionData*)this->data;
+	}
+
+	void Condition::wait()
+	{
+		ConditionData* data = (ConditionData*)this->data;
+		// the caller already holds the mutex and keeps holding it afterwards
+		std::unique_lock<std::mutex> lock(data->mutex, std::adopt_lock);
+		data->condition.wait(lock);
+		lock.release();
+	}
+
+	bool Condition::wait(float timeout)
+	{
+		ConditionData* data = (ConditionData*)this->data;
+		std::unique_lock<std::mutex> lock(data->mutex, std::adopt_lock);
+		bool result = (data->condition.wait_for(lock, std::chrono::microseconds((int64_t)(timeout * 1000.0f))) == std::cv_status::no_timeout);
+		lock.release();
+		return result;
+	}
+
+	void Condition::signal()
+	{
+		((ConditionData*)this->data)->condition.notify_one();
+	}
+
+	void Condition::broadcast()
+	{
+		((ConditionData*)this->data)->condition.notify_all();
+	}
+
+	void Condition::_lock()
+	{
+		((ConditionData*)this->data)->mutex.lock();
+	}
+
+	void Condition::_unlock()
+	{
+		((ConditionData*)this->data)->mutex.unlock();
+	}
+
+}
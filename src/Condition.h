@@ -0,0 +1,94 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Defines a mutex with a condition variable.
+
+#ifndef XAL_CONDITION_H
+#define XAL_CONDITION_H
+
+#include <hltypes/hltypesUtil.h>
+
+#include "xalExport.h"
+
+namespace xal
+{
+	/// @brief A mutex with a condition variable on which threads can wait until another thread wakes them up.
+	/// @note hltypes has no condition variable so this fills the gap without exposing the underlying implementation.
+	class Condition
+	{
+	public:
+		/// @brief Locks a Condition for the lifetime of the object, same as hmutex::ScopeLock.
+		class ScopeLock
+		{
+		public:
+			/// @brief Constructor.
+			/// @param[in] condition The Condition to lock. Can be NULL.
+			ScopeLock(Condition* condition = NULL);
+			/// @brief Destructor.
+			~ScopeLock();
+			/// @brief Locks the Condition.
+			/// @param[in] condition The Condition to lock.
+			/// @return True if successful.
+			bool acquire(Condition* condition);
+			/// @brief Unlocks the Condition.
+			/// @return True if successful.
+			bool release();
+
+		protected:
+			/// @brief The locked Condition.
+			Condition* condition;
+
+		private:
+			/// @brief Copy constructor.
+			ScopeLock(const ScopeLock& other);
+			/// @brief Assignment operator.
+			ScopeLock& operator=(const ScopeLock& other);
+
+		};
+
+		/// @brief Constructor.
+		Condition();
+		/// @brief Destructor.
+		~Condition();
+
+		/// @brief Waits until another thread calls signal() or broadcast().
+		/// @note The calling thread must hold the lock. It is released while waiting and acquired again before returning.
+		/// @note Spurious wake-ups are possible so the awaited state always has to be checked in a loop.
+		void wait();
+		/// @brief Waits until another thread calls signal() or broadcast() or the timeout expires.
+		/// @param[in] timeout Maximum time to wait in milliseconds.
+		/// @return False if the timeout expired.
+		/// @note The calling thread must hold the lock. It is released while waiting and acquired again before returning.
+		bool wait(float timeout);
+		/// @brief Wakes up one waiting thread.
+		void signal();
+		/// @brief Wakes up all waiting threads.
+		void broadcast();
+
+	protected:
+		/// @brief Implementation specific data.
+		void* data;
+
+		/// @brief Locks the mutex.
+		void _lock();
+		/// @brief Unlocks the mutex.
+		void _unlock();
+
+	private:
+		/// @brief Copy constructor.
+		Condition(const Condition& other);
+		/// @brief Assignment operator.
+		Condition& operator=(const Condition& other);
+
+	};
+
+}
+
+#endif
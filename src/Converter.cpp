@@ -0,0 +1,417 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define _CONVERTER_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define _CONVERTER_NEON
+#include <arm_neon.h>
+#endif
+
+#include <math.h>
+#include <string.h>
+
+#include <hltypes/hltypesUtil.h>
+
+#include "Converter.h"
+#include "Mixer.h"
+
+#define CONVERTER_PI 3.14159265358979323846
+
+namespace xal
+{
+#if defined(_CONVERTER_SSE2)
+	static inline void _interpolate(float* kernel, const float* row0, const float* row1, float weight)
+	{
+		__m128 factor = _mm_set1_ps(weight);
+		__m128 first;
+		for (int i = 0; i < CONVERTER_TAPS; i += 4)
+		{
+			first = _mm_loadu_ps(&row0[i]);
+			_mm_storeu_ps(&kernel[i], _mm_add_ps(first, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&row1[i]), first), factor)));
+		}
+	}
+
+	static inline float _dot(const float* kernel, const float* data)
+	{
+		__m128 sum = _mm_setzero_ps();
+		for (int i = 0; i < CONVERTER_TAPS; i += 4)
+		{
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&kernel[i]), _mm_loadu_ps(&data[i])));
+		}
+		// horizontal sum of the 4 lanes
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+		return _mm_cvtss_f32(sum);
+	}
+#elif defined(_CONVERTER_NEON)
+	static inline void _interpolate(float* kernel, const float* row0, const float* row1, float weight)
+	{
+		float32x4_t factor = vdupq_n_f32(weight);
+		float32x4_t first;
+		for (int i = 0; i < CONVERTER_TAPS; i += 4)
+		{
+			first = vld1q_f32(&row0[i]);
+			vst1q_f32(&kernel[i], vaddq_f32(first, vmulq_f32(vsubq_f32(vld1q_f32(&row1[i]), first), factor)));
+		}
+	}
+
+	static inline float _dot(const float* kernel, const float* data)
+	{
+		float32x4_t sum = vdupq_n_f32(0.0f);
+		for (int i = 0; i < CONVERTER_TAPS; i += 4)
+		{
+			sum = vaddq_f32(sum, vmulq_f32(vld1q_f32(&kernel[i]), vld1q_f32(&data[i])));
+		}
+		// horizontal sum of the 4 lanes in the same order as the SSE2 version, vaddvq_f32() would pair them differently
+		float32x2_t pairs = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+		return vget_lane_f32(vpadd_f32(pairs, pairs), 0);
+	}
+#else
+	static inline void _interpolate(float* kernel, const float* row0, const float* row1, float weight)
+	{
+		for_iter (i, 0, CONVERTER_TAPS)
+		{
+			kernel[i] = row0[i] + (row1[i] - row0[i]) * weight;
+		}
+	}
+
+	static inline float _dot(const float* kernel, const float* data)
+	{
+		float sum = 0.0f;
+		for_iter (i, 0, CONVERTER_TAPS)
+		{
+			sum += kernel[i] * data[i];
+		}
+		return sum;
+	}
+#endif
+
+	Converter::Converter(int inputChannels, int inputSamplingRate, int inputBitsPerSample, int outputChannels, int outputSamplingRate, int outputBitsPerSample) :
+		position(0), coefficients(NULL), kernel(NULL), planes(NULL), planeCapacity(0), planeSize(0), samples(NULL), samplesCapacity(0), partialFrameSize(0), allocations(0)
+	{
+		Mixer::initialize();
+		this->inputChannels = hclamp(inputChannels, 1, CONVERTER_MAX_CHANNELS);
+		this->inputSamplingRate = hmax(inputSamplingRate, 1);
+		this->inputBitsPerSample = (inputBitsPerSample == 8 || inputBitsPerSample == 32 ? inputBitsPerSample : 16);
+		this->outputChannels = hclamp(outputChannels, 1, CONVERTER_MAX_CHANNELS);
+		this->outputSamplingRate = hmax(outputSamplingRate, 1);
+		this->outputBitsPerSample = (outputBitsPerSample == 8 ? 8 : 16);
+		this->inputFrameSize = this->inputChannels * this->inputBitsPerSample / 8;
+		this->outputFrameSize = this->outputChannels * this->outputBitsPerSample / 8;
+		this->step = ((uint64_t)this->inputSamplingRate << 32) / this->outputSamplingRate;
+		if (this->isResampling())
+		{
+			this->_createCoefficients();
+			this->kernel = new float[CONVERTER_TAPS];
+		}
+		this->reset();
+	}
+
+	Converter::~Converter()
+	{
+		if (this->coefficients != NULL)
+		{
+			delete[] this->coefficients;
+		}
+		if (this->kernel != NULL)
+		{
+			delete[] this->kernel;
+		}
+		if (this->planes != NULL)
+		{
+			delete[] this->planes;
+		}
+		if (this->samples != NULL)
+		{
+			delete[] this->samples;
+		}
+	}
+
+	int Converter::calcOutputSize(int inputSize)
+	{
+		// the resampler may also flush out the frames it kept from earlier calls
+		int64_t frames = this->planeSize + CONVERTER_TAPS / 2 + (this->partialFrameSize + inputSize) / this->inputFrameSize;
+		return (int)((frames * this->outputSamplingRate / this->inputSamplingRate + 2) * this->outputFrameSize);
+	}
+
+	int Converter::convert(const unsigned char* input, int inputSize, unsigned char* output)
+	{
+		int size = 0;
+		if (this->partialFrameSize > 0 && inputSize > 0)
+		{
+			// completes the frame that was split between the last and this call first
+			size = hmin(this->inputFrameSize - this->partialFrameSize, inputSize);
+			memcpy(&this->partialFrame[this->partialFrameSize], input, size * sizeof(unsigned char));
+			this->partialFrameSize += size;
+			input += size;
+			inputSize -= size;
+			if (this->partialFrameSize == this->inputFrameSize)
+			{
+				this->_appendFrames(this->partialFrame, 1);
+				this->partialFrameSize = 0;
+			}
+		}
+		int frames = inputSize / this->inputFrameSize;
+		this->_appendFrames(input, frames);
+		size = inputSize - frames * this->inputFrameSize;
+		if (size > 0)
+		{
+			memcpy(this->partialFrame, &input[frames * this->inputFrameSize], size * sizeof(unsigned char));
+			this->partialFrameSize = size;
+		}
+		int count = (this->isResampling() ? this->_resample() : this->_interleave());
+		this->_writeFrames(output, count);
+		return (count * this->outputFrameSize);
+	}
+
+	int Converter::flush(unsigned char* output)
+	{
+		int count = 0;
+		if (this->isResampling())
+		{
+			// the last input frames need silence after them to get through the filter
+			int half = CONVERTER_TAPS / 2;
+			this->_reservePlanes(this->planeSize + half);
+			for_iter (i, 0, this->outputChannels)
+			{
+				memset(&this->planes[i * this->planeCapacity + this->planeSize], 0, half * sizeof(float));
+			}
+			this->planeSize += half;
+			count = this->_resample();
+		}
+		else
+		{
+			count = this->_interleave();
+		}
+		this->_writeFrames(output, count);
+		this->reset();
+		return (count * this->outputFrameSize);
+	}
+
+	void Converter::reset()
+	{
+		this->partialFrameSize = 0;
+		this->planeSize = 0;
+		this->position = 0;
+		if (this->isResampling())
+		{
+			// the first output frame is centered on the first input frame, so the filter starts with silence before it
+			int history = CONVERTER_TAPS / 2 - 1;
+			this->_reservePlanes(history);
+			for_iter (i, 0, this->outputChannels)
+			{
+				memset(&this->planes[i * this->planeCapacity], 0, history * sizeof(float));
+			}
+			this->planeSize = history;
+			this->position = (uint64_t)history << 32;
+		}
+	}
+
+	int Converter::takeAllocations()
+	{
+		int result = this->allocations;
+		this->allocations = 0;
+		return result;
+	}
+
+	void Converter::_createCoefficients()
+	{
+		int half = CONVERTER_TAPS / 2;
+		// when downsampling, the cutoff has to be below the output's Nyquist frequency to avoid aliasing
+		double cutoff = CONVERTER_CUTOFF * hmin(1.0, (double)this->outputSamplingRate / this->inputSamplingRate);
+		this->coefficients = new float[(CONVERTER_PHASES + 1) * CONVERTER_TAPS];
+		float* row = NULL;
+		double time = 0.0;
+		double value = 0.0;
+		double sum = 0.0;
+		for_iter (i, 0, CONVERTER_PHASES + 1)
+		{
+			row = &this->coefficients[i * CONVERTER_TAPS];
+			sum = 0.0;
+			for_iter (j, 0, CONVERTER_TAPS)
+			{
+				// distance of the tap's input frame from the output frame in input frames
+				time = (j - half + 1) - (double)i / CONVERTER_PHASES;
+				value = CONVERTER_PI * cutoff * time;
+				value = (value != 0.0 ? sin(value) / value : 1.0);
+				// Blackman window
+				if (fabs(time) < half)
+				{
+					value *= 0.42 + 0.5 * cos(CONVERTER_PI * time / half) + 0.08 * cos(2.0 * CONVERTER_PI * time / half);
+				}
+				else
+				{
+					value = 0.0;
+				}
+				row[j] = (float)value;
+				sum += value;
+			}
+			// every sub-filter is normalized to keep the gain at 1
+			for_iter (j, 0, CONVERTER_TAPS)
+			{
+				row[j] = (float)(row[j] / sum);
+			}
+		}
+	}
+
+	void Converter::_reservePlanes(int frames)
+	{
+		if (frames <= this->planeCapacity)
+		{
+			return;
+		}
+		float* planes = new float[this->outputChannels * frames];
+		if (this->planes != NULL)
+		{
+			for_iter (i, 0, this->outputChannels)
+			{
+				memcpy(&planes[i * frames], &this->planes[i * this->planeCapacity], this->planeSize * sizeof(float));
+			}
+			delete[] this->planes;
+		}
+		this->planes = planes;
+		this->planeCapacity = frames;
+		++this->allocations;
+	}
+
+	void Converter::_reserveSamples(int frames)
+	{
+		if (frames <= this->samplesCapacity)
+		{
+			return;
+		}
+		if (this->samples != NULL)
+		{
+			delete[] this->samples;
+		}
+		this->samples = new float[this->outputChannels * frames];
+		this->samplesCapacity = frames;
+		++this->allocations;
+	}
+
+	void Converter::_appendFrames(const unsigned char* input, int count)
+	{
+		if (count <= 0)
+		{
+			return;
+		}
+		this->_reservePlanes(this->planeSize + count);
+		float values[CONVERTER_MAX_CHANNELS];
+		float sample = 0.0f;
+		const unsigned char* frame = NULL;
+		float* plane = NULL;
+		for_iter (i, 0, count)
+		{
+			frame = &input[i * this->inputFrameSize];
+			if (this->inputBitsPerSample == 16)
+			{
+				for_iter (j, 0, this->inputChannels)
+				{
+					values[j] = (float)(short)(frame[j * 2] | (frame[j * 2 + 1] << 8));
+				}
+			}
+			else if (this->inputBitsPerSample == 32)
+			{
+				for_iter (j, 0, this->inputChannels)
+				{
+					memcpy(&sample, &frame[j * 4], sizeof(float)); // frames of a partial chunk may not be aligned
+					values[j] = sample * 32768.0f;
+				}
+			}
+			else
+			{
+				for_iter (j, 0, this->inputChannels)
+				{
+					values[j] = (frame[j] - 128) * 256.0f;
+				}
+			}
+			if (this->outputChannels == 1 && this->inputChannels > 1) // downmixing to mono
+			{
+				for_iter (j, 1, this->inputChannels)
+				{
+					values[0] += values[j];
+				}
+				values[0] /= this->inputChannels;
+			}
+			// mono is duplicated into all channels, additional channels are dropped
+			for_iter (j, 0, this->outputChannels)
+			{
+				plane = &this->planes[j * this->planeCapacity];
+				plane[this->planeSize + i] = values[j % this->inputChannels];
+			}
+		}
+		this->planeSize += count;
+	}
+
+	int Converter::_resample()
+	{
+		int half = CONVERTER_TAPS / 2;
+		this->_reserveSamples((int)((int64_t)this->planeSize * this->outputSamplingRate / this->inputSamplingRate) + 2);
+		int count = 0;
+		int index = 0;
+		int phase = 0;
+		float scaled = 0.0f;
+		while ((int)(this->position >> 32) + half < this->planeSize)
+		{
+			index = (int)(this->position >> 32);
+			scaled = (float)(uint32_t)this->position * (CONVERTER_PHASES / 4294967296.0f);
+			phase = hmin((int)scaled, CONVERTER_PHASES - 1);
+			_interpolate(this->kernel, &this->coefficients[phase * CONVERTER_TAPS], &this->coefficients[(phase + 1) * CONVERTER_TAPS], scaled - phase);
+			for_iter (i, 0, this->outputChannels)
+			{
+				this->samples[count * this->outputChannels + i] = _dot(this->kernel, &this->planes[i * this->planeCapacity + index - half + 1]);
+			}
+			++count;
+			this->position += this->step;
+		}
+		// frames before the first one needed by the next output frame are not needed anymore
+		int first = hmin((int)(this->position >> 32) - half + 1, this->planeSize);
+		if (first > 0)
+		{
+			for_iter (i, 0, this->outputChannels)
+			{
+				memmove(&this->planes[i * this->planeCapacity], &this->planes[i * this->planeCapacity + first], (this->planeSize - first) * sizeof(float));
+			}
+			this->planeSize -= first;
+			this->position -= (uint64_t)first << 32;
+		}
+		return count;
+	}
+
+	int Converter::_interleave()
+	{
+		int count = this->planeSize;
+		this->_reserveSamples(count);
+		for_iter (i, 0, this->outputChannels)
+		{
+			for_iter (j, 0, count)
+			{
+				this->samples[j * this->outputChannels + i] = this->planes[i * this->planeCapacity + j];
+			}
+		}
+		this->planeSize = 0;
+		return count;
+	}
+
+	void Converter::_writeFrames(unsigned char* output, int count)
+	{
+		count *= this->outputChannels;
+		if (this->outputBitsPerSample == 16)
+		{
+			Mixer::convert((short*)output, this->samples, count, NULL);
+			return;
+		}
+		for_iter (i, 0, count)
+		{
+			output[i] = (unsigned char)(hclamp(hround(this->samples[i] / 256.0f), -128, 127) + 128);
+		}
+	}
+
+}
@@ -0,0 +1,154 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Provides a stateful converter for PCM audio data.
+
+#ifndef XAL_CONVERTER_H
+#define XAL_CONVERTER_H
+
+#include <stdint.h>
+
+#include <hltypes/hltypesUtil.h>
+
+#include "xalExport.h"
+
+#define CONVERTER_TAPS 16 // filter length of the resampler, equal to any multiple of 4
+#define CONVERTER_PHASES 64 // number of precalculated sub-filters of the resampler
+#define CONVERTER_CUTOFF 0.95f // cutoff frequency of the resampler relative to the lower Nyquist frequency
+#define CONVERTER_MAX_CHANNELS 8
+
+namespace xal
+{
+	/// @brief Converts PCM audio data to a different sampling rate, number of channels and number of bits per sample.
+	/// @note The converter keeps its filter state between calls so consecutive chunks of a stream are converted without seams.
+	/// @note 8 bit samples are unsigned and 16 bit samples are signed, as in WAV files. 32 bit input samples are floats from -1 to 1.
+	class Converter
+	{
+	public:
+		/// @brief Constructor.
+		/// @param[in] inputChannels Number of channels of the input data.
+		/// @param[in] inputSamplingRate Sampling rate of the input data.
+		/// @param[in] inputBitsPerSample Number of bits per sample of the input data.
+		/// @param[in] outputChannels Number of channels of the output data.
+		/// @param[in] outputSamplingRate Sampling rate of the output data.
+		/// @param[in] outputBitsPerSample Number of bits per sample of the output data.
+		Converter(int inputChannels, int inputSamplingRate, int inputBitsPerSample, int outputChannels, int outputSamplingRate, int outputBitsPerSample);
+		/// @brief Destructor.
+		~Converter();
+
+		HL_DEFINE_GET(int, inputChannels, InputChannels);
+		HL_DEFINE_GET(int, inputSamplingRate, InputSamplingRate);
+		HL_DEFINE_GET(int, inputBitsPerSample, InputBitsPerSample);
+		HL_DEFINE_GET(int, outputChannels, OutputChannels);
+		HL_DEFINE_GET(int, outputSamplingRate, OutputSamplingRate);
+		HL_DEFINE_GET(int, outputBitsPerSample, OutputBitsPerSample);
+		/// @return True if the sampling rate is converted.
+		inline bool isResampling() { return (this->inputSamplingRate != this->outputSamplingRate); }
+
+		/// @brief Calculates the maximum byte-size of the output of a convert() call.
+		/// @param[in] inputSize Byte-size of the input data.
+		/// @return The maximum byte-size of the output data.
+		int calcOutputSize(int inputSize);
+		/// @brief Converts a chunk of data.
+		/// @param[in] input The input data.
+		/// @param[in] inputSize Byte-size of the input data.
+		/// @param[out] output Memory where the output data will be stored. Must be able to hold calcOutputSize(inputSize) bytes.
+		/// @return Byte-size of the output data.
+		/// @note Incomplete sample frames and the last few frames needed by the resampling filter are kept for the next call.
+		int convert(const unsigned char* input, int inputSize, unsigned char* output);
+		/// @brief Converts all data that is still kept by the converter as if the input was followed by silence.
+		/// @param[out] output Memory where the output data will be stored. Must be able to hold calcOutputSize(0) bytes.
+		/// @return Byte-size of the output data.
+		/// @note This should only be used after the last chunk of data, because it also resets the converter.
+		int flush(unsigned char* output);
+		/// @brief Discards all kept data and the filter state.
+		/// @note This has to be used when the input data jumps, e.g. when a stream is rewound.
+		void reset();
+		/// @return Number of heap allocations made since the last call and resets the count.
+		/// @note Memory is only allocated when a larger chunk than before is converted.
+		int takeAllocations();
+
+	protected:
+		/// @brief Number of channels of the input data.
+		int inputChannels;
+		/// @brief Sampling rate of the input data.
+		int inputSamplingRate;
+		/// @brief Number of bits per sample of the input data.
+		int inputBitsPerSample;
+		/// @brief Number of channels of the output data.
+		int outputChannels;
+		/// @brief Sampling rate of the output data.
+		int outputSamplingRate;
+		/// @brief Number of bits per sample of the output data.
+		int outputBitsPerSample;
+		/// @brief Byte-size of one input sample frame.
+		int inputFrameSize;
+		/// @brief Byte-size of one output sample frame.
+		int outputFrameSize;
+		/// @brief Distance between two output frames in input frames as 32.32 fixed point value.
+		uint64_t step;
+		/// @brief Position of the next output frame within the planes as 32.32 fixed point value.
+		uint64_t position;
+		/// @brief Precalculated sub-filters, CONVERTER_PHASES + 1 rows of CONVERTER_TAPS coefficients.
+		/// @note The additional row allows interpolation between the last and the first sub-filter.
+		float* coefficients;
+		/// @brief Sub-filter interpolated for the current output frame.
+		float* kernel;
+		/// @brief Input data converted to floats with the output's channel layout, one plane per channel.
+		/// @note Each plane starts with the input frames that are still needed by the resampling filter.
+		float* planes;
+		/// @brief Number of frames that fit into each plane.
+		int planeCapacity;
+		/// @brief Number of frames currently in each plane.
+		int planeSize;
+		/// @brief Interleaved float output frames before they are converted to the output format.
+		float* samples;
+		/// @brief Number of frames that fit into samples.
+		int samplesCapacity;
+		/// @brief Bytes of an incomplete input frame from the last call.
+		unsigned char partialFrame[CONVERTER_MAX_CHANNELS * 4];
+		/// @brief Number of bytes in partialFrame.
+		int partialFrameSize;
+		/// @brief Number of heap allocations made since the last call of takeAllocations().
+		int allocations;
+
+		/// @brief Creates the sub-filters of the resampler.
+		void _createCoefficients();
+		/// @brief Makes sure that the planes can hold the given number of frames.
+		/// @param[in] frames Number of frames.
+		void _reservePlanes(int frames);
+		/// @brief Makes sure that samples can hold the given number of frames.
+		/// @param[in] frames Number of frames.
+		void _reserveSamples(int frames);
+		/// @brief Appends input frames to the planes while converting the number of channels and the number of bits per sample.
+		/// @param[in] input The input frames.
+		/// @param[in] count Number of input frames.
+		void _appendFrames(const unsigned char* input, int count);
+		/// @brief Creates output frames from the planes.
+		/// @return Number of frames written to samples.
+		/// @note Frames that are not needed anymore are removed from the planes.
+		int _resample();
+		/// @brief Moves all planes' frames into samples without resampling.
+		/// @return Number of frames written to samples.
+		int _interleave();
+		/// @brief Converts float frames from samples to the output format.
+		/// @param[out] output Memory where the output data will be stored.
+		/// @param[in] count Number of frames.
+		void _writeFrames(unsigned char* output, int count);
+
+	private:
+		Converter(const Converter& other);
+		Converter& operator=(const Converter& other);
+
+	};
+
+}
+
+#endif
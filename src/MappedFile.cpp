@@ -0,0 +1,126 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#ifdef _WIN32
+#ifndef _WINRT
+#include <windows.h>
+#endif
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <hltypes/hlog.h>
+#include <hltypes/hresource.h>
+#include <hltypes/hstring.h>
+
+#include "MappedFile.h"
+#include "xal.h"
+
+namespace xal
+{
+	MappedFile::MappedFile(chstr filename, bool copy) : data(NULL), size(0), copied(copy)
+	{
+		this->filename = filename;
+		if (this->copied)
+		{
+			if (hresource::exists(this->filename))
+			{
+				hresource resource;
+				resource.open(this->filename);
+				int64_t fileSize = resource.size();
+				if (fileSize > 0 && fileSize <= 0x7FFFFFFF)
+				{
+					this->data = new unsigned char[(unsigned int)fileSize];
+					this->size = resource.readRaw(this->data, (int)fileSize);
+					if (this->size <= 0)
+					{
+						delete[] this->data;
+						this->data = NULL;
+						this->size = 0;
+					}
+				}
+				resource.close();
+			}
+			if (this->data == NULL)
+			{
+				hlog::error(logTag, "Unable to read file into memory: " + this->filename);
+			}
+			return;
+		}
+#ifdef _WIN32
+#ifndef _WINRT
+		HANDLE file = CreateFileA(this->filename.cStr(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file != INVALID_HANDLE_VALUE)
+		{
+			LARGE_INTEGER fileSize;
+			if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0 && fileSize.QuadPart <= 0x7FFFFFFF)
+			{
+				HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+				if (mapping != NULL)
+				{
+					this->data = (unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+					if (this->data != NULL)
+					{
+						this->size = (int)fileSize.QuadPart;
+					}
+					CloseHandle(mapping); // the view keeps the mapping alive
+				}
+			}
+			CloseHandle(file);
+		}
+#endif
+#else
+		int file = ::open(this->filename.cStr(), O_RDONLY);
+		if (file >= 0)
+		{
+			struct stat info;
+			if (fstat(file, &info) == 0 && info.st_size > 0 && info.st_size <= 0x7FFFFFFF)
+			{
+				void* mapped = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+				if (mapped != MAP_FAILED)
+				{
+					this->data = (unsigned char*)mapped;
+					this->size = (int)info.st_size;
+					madvise(mapped, (size_t)info.st_size, MADV_SEQUENTIAL); // audio data is usually read front to back
+				}
+			}
+			::close(file); // the mapping keeps the file alive
+		}
+#endif
+		if (this->data == NULL)
+		{
+			hlog::debug(logTag, "Unable to map file: " + this->filename);
+		}
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (this->data != NULL)
+		{
+			if (this->copied)
+			{
+				delete[] this->data;
+			}
+			else
+			{
+#ifdef _WIN32
+#ifndef _WINRT
+				UnmapViewOfFile(this->data);
+#endif
+#else
+				munmap(this->data, (size_t)this->size);
+#endif
+			}
+			this->data = NULL;
+		}
+	}
+
+}
@@ -0,0 +1,56 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Provides read-only memory-mapped file access.
+
+#ifndef XAL_MAPPED_FILE_H
+#define XAL_MAPPED_FILE_H
+
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hstring.h>
+
+namespace xal
+{
+	/// @brief Maps a whole file read-only into memory.
+	/// @note Mapped files are opened directly in the file system, bypassing hresource. Mapping fails for files that don't exist directly in the file system (e.g. files inside of archives) and on platforms without file mapping.
+	/// @note A copied file is read completely into memory through hresource instead so it works with any resource that can be opened.
+	class MappedFile
+	{
+	public:
+		/// @brief Constructor.
+		/// @param[in] filename Filename of the file to map.
+		/// @param[in] copy Whether the file is read into memory instead of being mapped.
+		MappedFile(chstr filename, bool copy = false);
+		/// @brief Destructor.
+		~MappedFile();
+
+		HL_DEFINE_GET(hstr, filename, Filename);
+		HL_DEFINE_GET(int, size, Size);
+		HL_DEFINE_IS(copied, Copied);
+		/// @return Pointer to the mapped data or NULL if the file could not be mapped.
+		inline const unsigned char* getData() const { return this->data; }
+		/// @return True if the file was mapped successfully.
+		inline bool isMapped() const { return (this->data != NULL); }
+
+	protected:
+		/// @brief Filename of the mapped file.
+		hstr filename;
+		/// @brief The mapped data.
+		unsigned char* data;
+		/// @brief Byte-size of the mapped data.
+		int size;
+		/// @brief Whether the data was read into memory instead of being mapped.
+		bool copied;
+
+	};
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#include <string.h>
+
+#include <hltypes/hltypesUtil.h>
+
+#include "Mixer.h"
+#include "MixBus.h"
+
+namespace xal
+{
+	MixBus::MixBus() : buffer(NULL), capacity(0), size(0), channels(1), dither(true), ditherOffset(0)
+	{
+		Mixer::initialize();
+	}
+
+	MixBus::~MixBus()
+	{
+		if (this->buffer != NULL)
+		{
+			delete[] this->buffer;
+			this->buffer = NULL;
+		}
+	}
+
+	void MixBus::begin(int count, int channels)
+	{
+		if (this->capacity < count) // only happens when the block size changes
+		{
+			if (this->buffer != NULL)
+			{
+				delete[] this->buffer;
+			}
+			this->buffer = new float[count];
+			this->capacity = count;
+		}
+		this->size = count;
+		this->channels = hmax(channels, 1);
+		memset(this->buffer, 0, count * sizeof(float));
+	}
+
+	void MixBus::add(int offset, const short* data, int count, float gain, float gainStep)
+	{
+		count = hmin(count, this->size - offset);
+		if (count > 0)
+		{
+			Mixer::mix(&this->buffer[offset], data, count, this->channels, gain, gainStep);
+		}
+	}
+
+	void MixBus::add(int offset, const float* data, int count, float gain, float gainStep)
+	{
+		count = hmin(count, this->size - offset);
+		if (count > 0)
+		{
+			// the accumulator uses the scale of 16 bit samples
+			Mixer::mixFloat(&this->buffer[offset], data, count, this->channels, gain * 32768.0f, gainStep * 32768.0f);
+		}
+	}
+
+	void MixBus::finish(short* output)
+	{
+		if (!this->dither)
+		{
+			Mixer::convert(output, this->buffer, this->size, NULL);
+			return;
+		}
+		// the noise table is continued across blocks so there is no audible repetition at the block rate
+		const float* noise = Mixer::getDitherNoise();
+		int offset = 0;
+		int count = 0;
+		while (offset < this->size)
+		{
+			count = hmin(this->size - offset, MIXER_DITHER_SIZE - this->ditherOffset);
+			Mixer::convert(&output[offset], &this->buffer[offset], count, &noise[this->ditherOffset]);
+			offset += count;
+			this->ditherOffset = (this->ditherOffset + count) % MIXER_DITHER_SIZE;
+		}
+	}
+
+}
@@ -0,0 +1,468 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define _MIXER_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER) && _MSC_VER >= 1700
+#define _MIXER_AVX2
+#define _MIXER_AVX2_TARGET
+#include <immintrin.h>
+#include <intrin.h>
+#elif defined(__GNUC__) && (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define _MIXER_AVX2
+#define _MIXER_AVX2_TARGET __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define _MIXER_NEON
+#include <arm_neon.h>
+#endif
+
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hmutex.h>
+#include <hltypes/hstring.h>
+
+#include "Mixer.h"
+#include "xal.h"
+
+namespace xal
+{
+	static void _mixScalar(float* accumulator, const short* data, int count, int channels, float gain, float gainStep)
+	{
+		if (gainStep == 0.0f)
+		{
+			for_iter (i, 0, count)
+			{
+				accumulator[i] += data[i] * gain;
+			}
+			return;
+		}
+		// all channels of a frame get the same gain so the stereo image doesn't shift during a ramp
+		float frameGain = 0.0f;
+		int frame = 0;
+		for (int i = 0; i < count; i += channels)
+		{
+			frameGain = gain + gainStep * frame;
+			for_iter (j, i, hmin(i + channels, count))
+			{
+				accumulator[j] += data[j] * frameGain;
+			}
+			++frame;
+		}
+	}
+
+	static void _mixFloatScalar(float* accumulator, const float* data, int count, int channels, float gain, float gainStep)
+	{
+		if (gainStep == 0.0f)
+		{
+			for_iter (i, 0, count)
+			{
+				accumulator[i] += data[i] * gain;
+			}
+			return;
+		}
+		// all channels of a frame get the same gain so the stereo image doesn't shift during a ramp
+		float frameGain = 0.0f;
+		int frame = 0;
+		for (int i = 0; i < count; i += channels)
+		{
+			frameGain = gain + gainStep * frame;
+			for_iter (j, i, hmin(i + channels, count))
+			{
+				accumulator[j] += data[j] * frameGain;
+			}
+			++frame;
+		}
+	}
+
+	static inline short _roundScalar(float value)
+	{
+		// half away from zero, the vectorized kernels do exactly the same so the output doesn't depend on the CPU
+		value = hclamp(value, -32768.0f, 32767.0f);
+		return (short)(int)(value >= 0.0f ? value + 0.5f : value - 0.5f);
+	}
+
+	static void _convertScalar(short* output, const float* accumulator, int count, const float* noise)
+	{
+		if (noise == NULL)
+		{
+			for_iter (i, 0, count)
+			{
+				output[i] = _roundScalar(accumulator[i]);
+			}
+			return;
+		}
+		for_iter (i, 0, count)
+		{
+			output[i] = _roundScalar(accumulator[i] + noise[i]);
+		}
+	}
+
+#ifdef _MIXER_SSE2
+	static void _mixSse2(float* accumulator, const short* data, int count, int channels, float gain, float gainStep)
+	{
+		if (gainStep != 0.0f && 4 % channels != 0) // the lanes can't be split into whole frames
+		{
+			_mixScalar(accumulator, data, count, channels, gain, gainStep);
+			return;
+		}
+		int i = 0;
+		// lane j belongs to frame j / channels
+		__m128 gainLow = _mm_setr_ps(gain, gain + gainStep * (1 / channels), gain + gainStep * (2 / channels), gain + gainStep * (3 / channels));
+		__m128 gainHalf = _mm_set1_ps(gainStep * (4 / channels));
+		__m128 gainFull = _mm_set1_ps(gainStep * (8 / channels));
+		__m128i samples;
+		__m128 low;
+		__m128 high;
+		for (; i + 8 <= count; i += 8)
+		{
+			samples = _mm_loadu_si128((const __m128i*)&data[i]);
+			// sign extension to 32 bit
+			low = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16));
+			high = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16));
+			_mm_storeu_ps(&accumulator[i], _mm_add_ps(_mm_loadu_ps(&accumulator[i]), _mm_mul_ps(low, gainLow)));
+			_mm_storeu_ps(&accumulator[i + 4], _mm_add_ps(_mm_loadu_ps(&accumulator[i + 4]), _mm_mul_ps(high, _mm_add_ps(gainLow, gainHalf))));
+			gainLow = _mm_add_ps(gainLow, gainFull);
+		}
+		if (i < count)
+		{
+			_mixScalar(&accumulator[i], &data[i], count - i, channels, gain + gainStep * (i / channels), gainStep);
+		}
+	}
+
+	static void _mixFloatSse2(float* accumulator, const float* data, int count, int channels, float gain, float gainStep)
+	{
+		if (gainStep != 0.0f && 4 % channels != 0) // the lanes can't be split into whole frames
+		{
+			_mixFloatScalar(accumulator, data, count, channels, gain, gainStep);
+			return;
+		}
+		int i = 0;
+		// lane j belongs to frame j / channels
+		__m128 gainLow = _mm_setr_ps(gain, gain + gainStep * (1 / channels), gain + gainStep * (2 / channels), gain + gainStep * (3 / channels));
+		__m128 gainHalf = _mm_set1_ps(gainStep * (4 / channels));
+		__m128 gainFull = _mm_set1_ps(gainStep * (8 / channels));
+		for (; i + 8 <= count; i += 8)
+		{
+			_mm_storeu_ps(&accumulator[i], _mm_add_ps(_mm_loadu_ps(&accumulator[i]), _mm_mul_ps(_mm_loadu_ps(&data[i]), gainLow)));
+			_mm_storeu_ps(&accumulator[i + 4], _mm_add_ps(_mm_loadu_ps(&accumulator[i + 4]), _mm_mul_ps(_mm_loadu_ps(&data[i + 4]), _mm_add_ps(gainLow, gainHalf))));
+			gainLow = _mm_add_ps(gainLow, gainFull);
+		}
+		if (i < count)
+		{
+			_mixFloatScalar(&accumulator[i], &data[i], count - i, channels, gain + gainStep * (i / channels), gainStep);
+		}
+	}
+
+	static inline __m128i _roundSse2(__m128 value, __m128 sign, __m128 half)
+	{
+		// the default conversion rounds half to even so half is added away from zero and the result truncated instead
+		return _mm_cvttps_epi32(_mm_add_ps(value, _mm_or_ps(_mm_and_ps(value, sign), half)));
+	}
+
+	static void _convertSse2(short* output, const float* accumulator, int count, const float* noise)
+	{
+		int i = 0;
+		__m128 minimum = _mm_set1_ps(-32768.0f);
+		__m128 maximum = _mm_set1_ps(32767.0f);
+		__m128 sign = _mm_set1_ps(-0.0f);
+		__m128 half = _mm_set1_ps(0.5f);
+		__m128 low;
+		__m128 high;
+		for (; i + 8 <= count; i += 8)
+		{
+			low = _mm_loadu_ps(&accumulator[i]);
+			high = _mm_loadu_ps(&accumulator[i + 4]);
+			if (noise != NULL)
+			{
+				low = _mm_add_ps(low, _mm_loadu_ps(&noise[i]));
+				high = _mm_add_ps(high, _mm_loadu_ps(&noise[i + 4]));
+			}
+			// clamping before the conversion, because out-of-range values would turn into 0x80000000
+			low = _mm_min_ps(_mm_max_ps(low, minimum), maximum);
+			high = _mm_min_ps(_mm_max_ps(high, minimum), maximum);
+			_mm_storeu_si128((__m128i*)&output[i], _mm_packs_epi32(_roundSse2(low, sign, half), _roundSse2(high, sign, half)));
+		}
+		if (i < count)
+		{
+			_convertScalar(&output[i], &accumulator[i], count - i, (noise != NULL ? &noise[i] : NULL));
+		}
+	}
+#endif
+
+#ifdef _MIXER_NEON
+	static void _mixNeon(float* accumulator, const short* data, int count, int channels, float gain, float gainStep)
+	{
+		if (gainStep != 0.0f && 4 % channels != 0) // the lanes can't be split into whole frames
+		{
+			_mixScalar(accumulator, data, count, channels, gain, gainStep);
+			return;
+		}
+		int i = 0;
+		// lane j belongs to frame j / channels
+		float gains[4] = {gain, gain + gainStep * (1 / channels), gain + gainStep * (2 / channels), gain + gainStep * (3 / channels)};
+		float32x4_t gainLow = vld1q_f32(gains);
+		float32x4_t gainHalf = vdupq_n_f32(gainStep * (4 / channels));
+		float32x4_t gainFull = vdupq_n_f32(gainStep * (8 / channels));
+		int16x8_t samples;
+		float32x4_t low;
+		float32x4_t high;
+		for (; i + 8 <= count; i += 8)
+		{
+			samples = vld1q_s16(&data[i]);
+			low = vcvtq_f32_s32(vmovl_s16(vget_low_s16(samples)));
+			high = vcvtq_f32_s32(vmovl_s16(vget_high_s16(samples)));
+			// no multiply-accumulate, a fused one would round differently than the other kernels
+			vst1q_f32(&accumulator[i], vaddq_f32(vld1q_f32(&accumulator[i]), vmulq_f32(low, gainLow)));
+			vst1q_f32(&accumulator[i + 4], vaddq_f32(vld1q_f32(&accumulator[i + 4]), vmulq_f32(high, vaddq_f32(gainLow, gainHalf))));
+			gainLow = vaddq_f32(gainLow, gainFull);
+		}
+		if (i < count)
+		{
+			_mixScalar(&accumulator[i], &data[i], count - i, channels, gain + gainStep * (i / channels), gainStep);
+		}
+	}
+
+	static void _mixFloatNeon(float* accumulator, const float* data, int count, int channels, float gain, float gainStep)
+	{
+		if (gainStep != 0.0f && 4 % channels != 0) // the lanes can't be split into whole frames
+		{
+			_mixFloatScalar(accumulator, data, count, channels, gain, gainStep);
+			return;
+		}
+		int i = 0;
+		// lane j belongs to frame j / channels
+		float gains[4] = {gain, gain + gainStep * (1 / channels), gain + gainStep * (2 / channels), gain + gainStep * (3 / channels)};
+		float32x4_t gainLow = vld1q_f32(gains);
+		float32x4_t gainHalf = vdupq_n_f32(gainStep * (4 / channels));
+		float32x4_t gainFull = vdupq_n_f32(gainStep * (8 / channels));
+		for (; i + 8 <= count; i += 8)
+		{
+			vst1q_f32(&accumulator[i], vaddq_f32(vld1q_f32(&accumulator[i]), vmulq_f32(vld1q_f32(&data[i]), gainLow)));
+			vst1q_f32(&accumulator[i + 4], vaddq_f32(vld1q_f32(&accumulator[i + 4]), vmulq_f32(vld1q_f32(&data[i + 4]), vaddq_f32(gainLow, gainHalf))));
+			gainLow = vaddq_f32(gainLow, gainFull);
+		}
+		if (i < count)
+		{
+			_mixFloatScalar(&accumulator[i], &data[i], count - i, channels, gain + gainStep * (i / channels), gainStep);
+		}
+	}
+
+	static inline int32x4_t _roundNeon(float32x4_t value, uint32x4_t sign, uint32x4_t half)
+	{
+		// the conversion truncates so half is added away from zero first, exactly like the scalar version
+		uint32x4_t bits = vreinterpretq_u32_f32(value);
+		return vcvtq_s32_f32(vaddq_f32(value, vreinterpretq_f32_u32(vorrq_u32(vandq_u32(bits, sign), half))));
+	}
+
+	static void _convertNeon(short* output, const float* accumulator, int count, const float* noise)
+	{
+		int i = 0;
+		float32x4_t minimum = vdupq_n_f32(-32768.0f);
+		float32x4_t maximum = vdupq_n_f32(32767.0f);
+		uint32x4_t sign = vdupq_n_u32(0x80000000);
+		uint32x4_t half = vreinterpretq_u32_f32(vdupq_n_f32(0.5f));
+		float32x4_t low;
+		float32x4_t high;
+		for (; i + 8 <= count; i += 8)
+		{
+			low = vld1q_f32(&accumulator[i]);
+			high = vld1q_f32(&accumulator[i + 4]);
+			if (noise != NULL)
+			{
+				low = vaddq_f32(low, vld1q_f32(&noise[i]));
+				high = vaddq_f32(high, vld1q_f32(&noise[i + 4]));
+			}
+			low = vminq_f32(vmaxq_f32(low, minimum), maximum);
+			high = vminq_f32(vmaxq_f32(high, minimum), maximum);
+			vst1q_s16(&output[i], vcombine_s16(vqmovn_s32(_roundNeon(low, sign, half)), vqmovn_s32(_roundNeon(high, sign, half))));
+		}
+		if (i < count)
+		{
+			_convertScalar(&output[i], &accumulator[i], count - i, (noise != NULL ? &noise[i] : NULL));
+		}
+	}
+#endif
+
+#ifdef _MIXER_AVX2
+	_MIXER_AVX2_TARGET static void _mixAvx2(float* accumulator, const short* data, int count, int channels, float gain, float gainStep)
+	{
+		if (gainStep != 0.0f && 8 % channels != 0) // the lanes can't be split into whole frames
+		{
+			_mixScalar(accumulator, data, count, channels, gain, gainStep);
+			return;
+		}
+		int i = 0;
+		// lane j belongs to frame j / channels
+		__m256 gains = _mm256_setr_ps(gain, gain + gainStep * (1 / channels), gain + gainStep * (2 / channels), gain + gainStep * (3 / channels),
+			gain + gainStep * (4 / channels), gain + gainStep * (5 / channels), gain + gainStep * (6 / channels), gain + gainStep * (7 / channels));
+		__m256 gainFull = _mm256_set1_ps(gainStep * (8 / channels));
+		__m256 samples;
+		for (; i + 8 <= count; i += 8)
+		{
+			samples = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)&data[i])));
+			_mm256_storeu_ps(&accumulator[i], _mm256_add_ps(_mm256_loadu_ps(&accumulator[i]), _mm256_mul_ps(samples, gains)));
+			gains = _mm256_add_ps(gains, gainFull);
+		}
+		if (i < count)
+		{
+			_mixScalar(&accumulator[i], &data[i], count - i, channels, gain + gainStep * (i / channels), gainStep);
+		}
+	}
+
+	_MIXER_AVX2_TARGET static void _mixFloatAvx2(float* accumulator, const float* data, int count, int channels, float gain, float gainStep)
+	{
+		if (gainStep != 0.0f && 8 % channels != 0) // the lanes can't be split into whole frames
+		{
+			_mixFloatScalar(accumulator, data, count, channels, gain, gainStep);
+			return;
+		}
+		int i = 0;
+		// lane j belongs to frame j / channels
+		__m256 gains = _mm256_setr_ps(gain, gain + gainStep * (1 / channels), gain + gainStep * (2 / channels), gain + gainStep * (3 / channels),
+			gain + gainStep * (4 / channels), gain + gainStep * (5 / channels), gain + gainStep * (6 / channels), gain + gainStep * (7 / channels));
+		__m256 gainFull = _mm256_set1_ps(gainStep * (8 / channels));
+		for (; i + 8 <= count; i += 8)
+		{
+			_mm256_storeu_ps(&accumulator[i], _mm256_add_ps(_mm256_loadu_ps(&accumulator[i]), _mm256_mul_ps(_mm256_loadu_ps(&data[i]), gains)));
+			gains = _mm256_add_ps(gains, gainFull);
+		}
+		if (i < count)
+		{
+			_mixFloatScalar(&accumulator[i], &data[i], count - i, channels, gain + gainStep * (i / channels), gainStep);
+		}
+	}
+
+	_MIXER_AVX2_TARGET static inline __m256i _roundAvx2(__m256 value, __m256 sign, __m256 half)
+	{
+		return _mm256_cvttps_epi32(_mm256_add_ps(value, _mm256_or_ps(_mm256_and_ps(value, sign), half)));
+	}
+
+	_MIXER_AVX2_TARGET static void _convertAvx2(short* output, const float* accumulator, int count, const float* noise)
+	{
+		int i = 0;
+		__m256 minimum = _mm256_set1_ps(-32768.0f);
+		__m256 maximum = _mm256_set1_ps(32767.0f);
+		__m256 sign = _mm256_set1_ps(-0.0f);
+		__m256 half = _mm256_set1_ps(0.5f);
+		__m256 low;
+		__m256 high;
+		__m256i packed;
+		for (; i + 16 <= count; i += 16)
+		{
+			low = _mm256_loadu_ps(&accumulator[i]);
+			high = _mm256_loadu_ps(&accumulator[i + 8]);
+			if (noise != NULL)
+			{
+				low = _mm256_add_ps(low, _mm256_loadu_ps(&noise[i]));
+				high = _mm256_add_ps(high, _mm256_loadu_ps(&noise[i + 8]));
+			}
+			low = _mm256_min_ps(_mm256_max_ps(low, minimum), maximum);
+			high = _mm256_min_ps(_mm256_max_ps(high, minimum), maximum);
+			packed = _mm256_packs_epi32(_roundAvx2(low, sign, half), _roundAvx2(high, sign, half));
+			// packing works per 128 bit lane so the middle quadwords have to be swapped back
+			_mm256_storeu_si256((__m256i*)&output[i], _mm256_permute4x64_epi64(packed, 0xD8));
+		}
+		if (i < count)
+		{
+			_convertSse2(&output[i], &accumulator[i], count - i, (noise != NULL ? &noise[i] : NULL));
+		}
+	}
+
+	static bool _isAvx2Supported()
+	{
+#ifdef _MSC_VER
+		int info[4] = {0};
+		__cpuid(info, 0);
+		if (info[0] < 7)
+		{
+			return false;
+		}
+		__cpuid(info, 1);
+		// OSXSAVE and AVX, then the OS has to actually save the YMM registers
+		if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 0x6) != 0x6)
+		{
+			return false;
+		}
+		__cpuidex(info, 7, 0);
+		return ((info[1] & (1 << 5)) != 0);
+#else
+		__builtin_cpu_init();
+		return (__builtin_cpu_supports("avx2") != 0);
+#endif
+	}
+#endif
+
+
+	void (*Mixer::mixFunction)(float*, const short*, int, int, float, float) = &_mixScalar;
+	void (*Mixer::mixFloatFunction)(float*, const float*, int, int, float, float) = &_mixFloatScalar;
+	void (*Mixer::convertFunction)(short*, const float*, int, const float*) = &_convertScalar;
+	float Mixer::ditherNoise[MIXER_DITHER_SIZE] = {0.0f};
+	hstr Mixer::kernelName = "";
+	bool Mixer::initialized = false;
+	hmutex Mixer::mutex;
+
+	void Mixer::initialize()
+	{
+		// Converters and MixBuses are created on worker threads as well
+		hmutex::ScopeLock lock(&Mixer::mutex);
+		if (Mixer::initialized)
+		{
+			return;
+		}
+		Mixer::mixFunction = &_mixScalar;
+		Mixer::mixFloatFunction = &_mixFloatScalar;
+		Mixer::convertFunction = &_convertScalar;
+		Mixer::kernelName = "scalar";
+		// simple deterministic LCG, the noise only has to be white and not random
+		unsigned int seed = 22222;
+		float first = 0.0f;
+		float second = 0.0f;
+		for_iter (i, 0, MIXER_DITHER_SIZE)
+		{
+			seed = seed * 1664525 + 1013904223;
+			first = (seed >> 8) / 16777216.0f;
+			seed = seed * 1664525 + 1013904223;
+			second = (seed >> 8) / 16777216.0f;
+			Mixer::ditherNoise[i] = first - second;
+		}
+#ifdef _MIXER_SSE2
+		// SSE2 is part of the x86-64 baseline and the build targets it on x86 so no runtime check is needed
+		Mixer::mixFunction = &_mixSse2;
+		Mixer::mixFloatFunction = &_mixFloatSse2;
+		Mixer::convertFunction = &_convertSse2;
+		Mixer::kernelName = "SSE2";
+#ifdef _MIXER_AVX2
+		if (_isAvx2Supported())
+		{
+			Mixer::mixFunction = &_mixAvx2;
+			Mixer::mixFloatFunction = &_mixFloatAvx2;
+			Mixer::convertFunction = &_convertAvx2;
+			Mixer::kernelName = "AVX2";
+		}
+#endif
+#elif defined(_MIXER_NEON)
+		// NEON is part of the ARMv8 baseline and the build has to enable it on ARMv7 so no runtime check is needed
+		Mixer::mixFunction = &_mixNeon;
+		Mixer::mixFloatFunction = &_mixFloatNeon;
+		Mixer::convertFunction = &_convertNeon;
+		Mixer::kernelName = "NEON";
+#endif
+		hlog::write(logTag, "Using mixing kernel: " + Mixer::kernelName);
+		Mixer::initialized = true;
+	}
+
+	hstr Mixer::getKernelName()
+	{
+		hmutex::ScopeLock lock(&Mixer::mutex);
+		return Mixer::kernelName;
+	}
+
+}
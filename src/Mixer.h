@@ -0,0 +1,97 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Provides vectorized kernels for software mixing.
+
+#ifndef XAL_MIXER_H
+#define XAL_MIXER_H
+
+#include <hltypes/hmutex.h>
+#include <hltypes/hstring.h>
+
+#include "xalExport.h"
+
+#define MIXER_DITHER_SIZE 4096 // must be a multiple of 16
+
+namespace xal
+{
+	/// @brief Provides software mixing kernels with SSE2, AVX2 and NEON implementations and a scalar fallback.
+	/// @note The best available implementation is selected at runtime in initialize().
+	class Mixer
+	{
+	public:
+		/// @brief Selects the best kernels that the CPU supports.
+		/// @note Calling this more than once has no effect. It is thread-safe, but the kernels must not be used before it returns.
+		static void initialize();
+		/// @brief Gets the name of the selected kernel implementation.
+		/// @return Name of the selected kernel implementation.
+		static hstr getKernelName();
+		/// @brief Adds 16 bit samples to a float accumulator while linearly ramping the gain.
+		/// @param[in,out] accumulator The float accumulator.
+		/// @param[in] data The 16 bit samples.
+		/// @param[in] count Number of samples.
+		/// @param[in] channels Number of interleaved channels.
+		/// @param[in] gain Gain applied to the first frame.
+		/// @param[in] gainStep Gain change from one frame to the next.
+		/// @note The accumulator uses the same scale as the samples, the gain does not get normalized.
+		static inline void mix(float* accumulator, const short* data, int count, int channels, float gain, float gainStep)
+		{
+			(*Mixer::mixFunction)(accumulator, data, count, channels, gain, gainStep);
+		}
+		/// @brief Adds float samples to a float accumulator while linearly ramping the gain.
+		/// @param[in,out] accumulator The float accumulator.
+		/// @param[in] data The float samples.
+		/// @param[in] count Number of samples.
+		/// @param[in] channels Number of interleaved channels.
+		/// @param[in] gain Gain applied to the first frame.
+		/// @param[in] gainStep Gain change from one frame to the next.
+		/// @note Float samples usually range from -1 to 1 so the gain has to include the scale of the accumulator.
+		static inline void mixFloat(float* accumulator, const float* data, int count, int channels, float gain, float gainStep)
+		{
+			(*Mixer::mixFloatFunction)(accumulator, data, count, channels, gain, gainStep);
+		}
+		/// @brief Converts the float accumulator to 16 bit samples with saturation and rounding half away from zero.
+		/// @param[out] output The 16 bit output samples.
+		/// @param[in] accumulator The float accumulator.
+		/// @param[in] count Number of samples.
+		/// @param[in] noise Dither noise added to each sample before rounding. Can be NULL to disable dithering.
+		static inline void convert(short* output, const float* accumulator, int count, const float* noise)
+		{
+			(*Mixer::convertFunction)(output, accumulator, count, noise);
+		}
+		/// @brief Gets the precalculated triangular dither noise table.
+		/// @return The dither noise table with MIXER_DITHER_SIZE values.
+		static inline const float* getDitherNoise() { return Mixer::ditherNoise; }
+
+	protected:
+		/// @brief Selected mixing kernel.
+		static void (*mixFunction)(float*, const short*, int, int, float, float);
+		/// @brief Selected mixing kernel for float samples.
+		static void (*mixFloatFunction)(float*, const float*, int, int, float, float);
+		/// @brief Selected conversion kernel.
+		static void (*convertFunction)(short*, const float*, int, const float*);
+		/// @brief Triangular probability density dither noise with an amplitude of 1 LSB.
+		static float ditherNoise[];
+		/// @brief Name of the selected kernel implementation.
+		static hstr kernelName;
+		/// @brief Whether initialize() has already selected the kernels.
+		static bool initialized;
+		/// @brief Mutex for the initialization.
+		static hmutex mutex;
+
+	private: // prevents inheritance and instantiation
+		Mixer() { }
+		~Mixer() { }
+
+	};
+
+}
+
+#endif
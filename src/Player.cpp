@@ -6,12 +6,15 @@
 /// This program is free software; you can redistribute it and/or modify it under
 /// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
 
+#include <math.h>
+
 #include <hltypes/hlog.h>
 #include <hltypes/hltypesUtil.h>
 
 #include "Source.h"
 #include "Buffer.h"
 #include "Category.h"
+#include "CommandQueue.h"
 #include "Player.h"
 #include "Sound.h"
 #include "xal.h"
@@ -19,13 +22,22 @@
 namespace xal
 {
 	Player::Player(Sound* sound) : gain(1.0f), pitch(1.0f), paused(false), looping(false), fadeSpeed(0.0f),
-		fadeTime(0.0f), offset(0.0f), bufferIndex(0), processedByteCount(0), idleTime(0.0f), asyncPlayQueued(false)
+		fadeTime(0.0f), offset(0.0f), bufferIndex(0), processedByteCount(0), idleTime(0.0f), asyncPlayQueued(false),
+		virtualized(false), virtualTime(0.0f), playOrder(0), playerIndex(-1), managedIndex(-1)
 	{
+		this->publishedState = new PlayerState();
 		this->sound = sound;
+		Category* category = sound->getCategory();
+		this->streamBufferCount = (category->getStreamBufferCount() > 0 ? category->getStreamBufferCount() : xal::manager->getStreamBufferCount());
+		this->streamBufferSize = (category->getStreamBufferSize() > 0 ? category->getStreamBufferSize() : xal::manager->getStreamBufferSize());
 		this->buffer = sound->getBuffer();
 		if (this->buffer->isStreamed()) // streamed buffers cannot be shared
 		{
 			this->buffer = xal::manager->_createBuffer(this->sound);
+			if (category->isStreamShared()) // but their decoded data can be
+			{
+				this->buffer->_setSharedStream(this->sound->_getSharedStream());
+			}
 		}
 	}
 
@@ -37,10 +49,15 @@ namespace xal
 		{
 			xal::manager->_destroyBuffer(this->buffer);
 		}
+		delete this->publishedState;
 	}
 
 	float Player::getGain()
 	{
+		if (xal::manager->_isCommandQueueActive())
+		{
+			return this->publishedState->gain;
+		}
 		hmutex::ScopeLock lock(&xal::manager->mutex);
 		return this->_getGain();
 	}
@@ -52,7 +69,13 @@ namespace xal
 
 	void Player::setGain(float value)
 	{
+		if (xal::manager->_queueCommand(Command(Command::PLAYER_SET_GAIN, this, "", 0.0f, false, value)))
+		{
+			this->publishedState->gain = hclamp(value, 0.0f, 1.0f);
+			return;
+		}
 		hmutex::ScopeLock lock(&xal::manager->mutex);
+		xal::manager->_processCommands();
 		this->_setGain(value);
 	}
 
@@ -64,6 +87,10 @@ namespace xal
 
 	float Player::getPitch()
 	{
+		if (xal::manager->_isCommandQueueActive())
+		{
+			return this->publishedState->pitch;
+		}
 		hmutex::ScopeLock lock(&xal::manager->mutex);
 		return this->_getPitch();
 	}
@@ -75,7 +102,13 @@ namespace xal
 
 	void Player::setPitch(float value)
 	{
+		if (xal::manager->_queueCommand(Command(Command::PLAYER_SET_PITCH, this, "", 0.0f, false, value)))
+		{
+			this->publishedState->pitch = hclamp(value, 0.01f, 100.0f);
+			return;
+		}
 		hmutex::ScopeLock lock(&xal::manager->mutex);
+		xal::manager->_processCommands();
 		this->_setPitch(value);
 	}
 
@@ -92,12 +125,21 @@ namespace xal
 
 	unsigned int Player::getSamplePosition()
 	{
+		if (xal::manager->_isCommandQueueActive())
+		{
+			return this->publishedState->samplePosition;
+		}
 		hmutex::ScopeLock lock(&xal::manager->mutex);
+		return this->_getSamplePosition();
+	}
+
+	unsigned int Player::_getSamplePosition()
+	{
 		unsigned int position = this->_systemGetBufferPosition();
 		if (this->sound->isStreamed() && this->_systemNeedsStreamedBufferPositionCorrection())
 		{
 			// corrects position by using number of processed bytes (circular)
-			position = (position + (STREAM_BUFFER_COUNT - this->bufferIndex) * STREAM_BUFFER_SIZE) % STREAM_BUFFER;
+			position = (position + (this->streamBufferCount - this->bufferIndex) * this->streamBufferSize) % this->_getStreamBufferBytes();
 			// adds streamed processed byte count
 			position += this->processedByteCount;
 		}
@@ -129,7 +171,7 @@ namespace xal
 	{
 		if (this->buffer->isStreamed())
 		{
-			return (int)this->buffer->getStream().size();
+			return this->buffer->getDataSize();
 		}
 		else
 		{
@@ -144,6 +186,10 @@ namespace xal
 
 	bool Player::isPlaying()
 	{
+		if (xal::manager->_isCommandQueueActive())
+		{
+			return this->publishedState->playing;
+		}
 		hmutex::ScopeLock lock(&xal::manager->mutex);
 		return (!this->isFadingOut() && this->_isPlaying());
 	}
@@ -185,7 +231,7 @@ namespace xal
 
 	bool Player::_isAsyncPlayQueued()
 	{
-		if (!this->buffer->isLoaded())
+		if (!this->buffer->isPlayable())
 		{
 			return false;
 		}
@@ -195,6 +241,12 @@ namespace xal
 
 	void Player::_update(float timeDelta)
 	{
+		if (this->virtualized)
+		{
+			this->virtualTime += timeDelta * this->pitch;
+			this->_publishState();
+			return;
+		}
 		if (this->_isPlaying())
 		{
 			this->buffer->keepLoaded();
@@ -227,6 +279,7 @@ namespace xal
 				if (!this->paused)
 				{
 					this->_stop();
+					this->_publishState();
 					return;
 				}
 				this->_pause();
@@ -236,29 +289,56 @@ namespace xal
 				this->_systemUpdateGain();
 			}
 		}
+		this->_publishState();
 	}
 
 	void Player::play(float fadeTime, bool looping)
 	{
+		if (xal::manager->_queueCommand(Command(Command::PLAYER_PLAY, this, "", fadeTime, looping)))
+		{
+			this->publishedState->playing = true;
+			return;
+		}
 		hmutex::ScopeLock lock(&xal::manager->mutex);
+		xal::manager->_processCommands();
+		xal::manager->_assignPlayOrder(this);
 		this->_play(fadeTime, looping);
 	}
 
 	void Player::playAsync(float fadeTime, bool looping)
 	{
+		if (xal::manager->_queueCommand(Command(Command::PLAYER_PLAY_ASYNC, this, "", fadeTime, looping)))
+		{
+			this->publishedState->playing = true;
+			return;
+		}
 		hmutex::ScopeLock lock(&xal::manager->mutex);
+		xal::manager->_processCommands();
+		xal::manager->_assignPlayOrder(this);
 		this->_playAsync(fadeTime, looping);
 	}
 
 	void Player::stop(float fadeTime)
 	{
+		if (xal::manager->_queueCommand(Command(Command::PLAYER_STOP, this, "", fadeTime)))
+		{
+			this->publishedState->playing = false;
+			return;
+		}
 		hmutex::ScopeLock lock(&xal::manager->mutex);
+		xal::manager->_processCommands();
 		this->_stop(fadeTime);
 	}
 
 	void Player::pause(float fadeTime)
 	{
+		if (xal::manager->_queueCommand(Command(Command::PLAYER_PAUSE, this, "", fadeTime)))
+		{
+			this->publishedState->playing = false;
+			return;
+		}
 		hmutex::ScopeLock lock(&xal::manager->mutex);
+		xal::manager->_processCommands();
 		this->_pause(fadeTime);
 	}
 	
@@ -291,7 +371,7 @@ namespace xal
 		bool alreadyFading = this->isFading();
 		if (!alreadyFading && !this->_systemIsPlaying())
 		{
-			this->buffer->prepare();
+			this->buffer->_prepare(true);
 			this->_systemPrepareBuffer();
 			if (this->paused)
 			{
@@ -350,6 +430,7 @@ namespace xal
 			xal::manager->suspendedPlayers -= this;
 		}
 		this->paused = false;
+		this->virtualized = false;
 		this->_stopSound(fadeTime);
 		this->offset = 0.0f;
 		this->processedByteCount = 0;
@@ -366,6 +447,85 @@ namespace xal
 		this->_stopSound(fadeTime);
 	}
 
+	void Player::_reset()
+	{
+		this->gain = 1.0f;
+		this->pitch = 1.0f;
+		this->paused = false;
+		this->looping = false;
+		this->fadeSpeed = 0.0f;
+		this->fadeTime = 0.0f;
+		this->offset = 0.0f;
+		this->bufferIndex = 0;
+		this->processedByteCount = 0;
+		this->idleTime = 0.0f;
+		this->virtualized = false;
+		this->virtualTime = 0.0f;
+		this->playOrder = 0;
+		hmutex::ScopeLock lock(&this->asyncPlayMutex);
+		this->asyncPlayQueued = false;
+		lock.release();
+		this->publishedState->gain = 1.0f;
+		this->publishedState->pitch = 1.0f;
+		this->publishedState->playing = false;
+		this->publishedState->samplePosition = 0;
+		this->publishedState->paused = false;
+		this->_systemReset();
+	}
+
+	void Player::_virtualize()
+	{
+		if (this->isFadingOut() && !this->paused) // it's going away anyway
+		{
+			this->_stop();
+			return;
+		}
+		if (this->_isPlaying())
+		{
+			this->virtualTime = (float)this->_getSamplePosition() / this->buffer->getSamplingRate();
+			this->paused = true;
+			this->_stopSound();
+		}
+		else // was never started, _play() uses the looping flag only when not paused
+		{
+			this->virtualTime = 0.0f;
+			this->paused = true;
+		}
+		this->virtualized = true;
+	}
+
+	bool Player::_realize()
+	{
+		if (!this->sound->isStreamed())
+		{
+			float duration = this->buffer->getDuration();
+			if (this->looping && duration > 0.0f)
+			{
+				this->virtualTime = fmod(this->virtualTime, duration);
+			}
+			this->offset = this->_systemTimeToOffset(this->virtualTime);
+		}
+		this->virtualized = false;
+		this->_play(0.0f, this->looping);
+		if (!this->_isPlaying()) // the audio-system could not provide a voice
+		{
+			this->virtualized = true;
+			return false;
+		}
+		this->virtualTime = 0.0f;
+		return true;
+	}
+
+	bool Player::_isVirtualFinished()
+	{
+		return (this->virtualized && !this->looping && this->virtualTime >= this->buffer->getDuration());
+	}
+
+	float Player::_systemTimeToOffset(float time)
+	{
+		return (time * this->buffer->getSamplingRate());
+	}
+
 	float Player::_calcGain()
 	{
 		float result = this->gain * this->sound->getCategory()->getGain() * xal::manager->getGlobalGain();
@@ -376,6 +536,25 @@ namespace xal
 		return hclamp(result, 0.0f, 1.0f);
 	}
 
+	void Player::_publishState()
+	{
+		// while the caller's Commands are still queued, the caller's own published values are more recent
+		if (!xal::manager->_isCommandQueueActive() || this->publishedState->pendingCommands > 0)
+		{
+			return;
+		}
+		bool playing = (!this->isFadingOut() && this->_isPlaying());
+		// querying the position from the audio-system is only needed if it can have changed
+		if (playing || playing != this->publishedState->playing || this->paused != this->publishedState->paused)
+		{
+			this->publishedState->samplePosition = this->_getSamplePosition();
+		}
+		this->publishedState->gain = this->gain;
+		this->publishedState->pitch = this->pitch;
+		this->publishedState->playing = playing;
+		this->publishedState->paused = this->paused;
+	}
+
 	void Player::_stopSound(float fadeTime)
 	{
 		hmutex::ScopeLock lock(&this->asyncPlayMutex);
@@ -0,0 +1,249 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#include <string.h>
+
+#include <hltypes/harray.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hmutex.h>
+
+#include "AudioManager.h"
+#include "Category.h"
+#include "SharedStream.h"
+#include "Sound.h"
+#include "Source.h"
+#include "xal.h"
+
+namespace xal
+{
+	SharedStream::SharedStream(Sound* sound) : data(NULL), capacity(0), start(0), end(0), empty(false), readers(0)
+	{
+		Category* category = sound->getCategory();
+		this->source = xal::manager->_createSource(sound->getFilename(), category->getSourceMode(), category->getBufferMode(), sound->getFormat(), category->getVorbisDecoder());
+		if (category->getBufferMode() == COMPRESSED)
+		{
+			this->source->_setResidentFile(sound->_getResidentFile());
+		}
+		// has to provide the same format as the Buffers' own Sources
+		this->source->_setFloatOutput(xal::manager->_isFloatMixSupported());
+	}
+
+	SharedStream::~SharedStream()
+	{
+		if (this->source->isOpen())
+		{
+			this->source->close();
+		}
+		delete this->source;
+		if (this->data != NULL)
+		{
+			delete[] this->data;
+		}
+	}
+
+	bool SharedStream::attach(int64_t* position, int64_t* loopStart)
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		if (this->readers == 0)
+		{
+			// nobody depends on the window so it can simply start over
+			if (!this->_restart())
+			{
+				return false;
+			}
+			(*position) = 0;
+			(*loopStart) = 0;
+		}
+		else if (!this->_join(position, loopStart))
+		{
+			return false;
+		}
+		++this->readers;
+		return true;
+	}
+
+	bool SharedStream::rewind(int64_t* position, int64_t* loopStart)
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		if (this->readers == 1)
+		{
+			if (this->_restart())
+			{
+				(*position) = 0;
+				(*loopStart) = 0;
+				return true;
+			}
+		}
+		else if (this->_join(position, loopStart))
+		{
+			return true;
+		}
+		lock.release();
+		this->detach();
+		return false;
+	}
+
+	void SharedStream::detach()
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		if (this->readers > 0)
+		{
+			--this->readers;
+			if (this->readers == 0)
+			{
+				this->source->close();
+			}
+		}
+	}
+
+	int SharedStream::read(int64_t* position, int64_t* loopStart, unsigned char* output, int size, bool looping, bool* ended)
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		*ended = false;
+		if ((*position) < this->start || (*position) > this->end)
+		{
+			return -1;
+		}
+		int result = 0;
+		int64_t loopEnd = 0;
+		int count = 0;
+		int index = 0;
+		int first = 0;
+		while (result < size)
+		{
+			loopEnd = -1;
+			foreach (int64_t, it, this->loopStarts)
+			{
+				if ((*it) > (*loopStart))
+				{
+					loopEnd = (*it);
+					break;
+				}
+			}
+			if ((*position) == loopEnd)
+			{
+				if (!looping)
+				{
+					*ended = true;
+					break;
+				}
+				(*loopStart) = loopEnd;
+				continue;
+			}
+			if ((*position) == this->end)
+			{
+				// this reader is ahead of everybody else so it has to decode
+				if (this->_decode(size - result) == 0)
+				{
+					*ended = true;
+					break;
+				}
+				continue;
+			}
+			count = (int)hmin((int64_t)(size - result), (loopEnd >= 0 ? hmin(loopEnd, this->end) : this->end) - (*position));
+			index = (int)((*position) % this->capacity);
+			first = hmin(count, this->capacity - index);
+			memcpy(&output[result], &this->data[index], first * sizeof(unsigned char));
+			if (count > first)
+			{
+				memcpy(&output[result + first], this->data, (count - first) * sizeof(unsigned char));
+			}
+			(*position) += count;
+			result += count;
+		}
+		return result;
+	}
+
+	bool SharedStream::_restart()
+	{
+		if (!this->source->isOpen())
+		{
+			if (!this->source->open())
+			{
+				return false;
+			}
+		}
+		else
+		{
+			this->source->rewind();
+		}
+		if (this->data == NULL)
+		{
+			int bytes = hround(SHARED_STREAM_WINDOW_TIME * this->source->getSamplingRate() * this->source->getChannels() * this->source->getBitsPerSample() * 0.125f);
+			this->capacity = hmax(bytes, STREAM_BUFFER);
+			this->data = new unsigned char[this->capacity];
+			xal::manager->_countStreamAllocations(1);
+		}
+		this->start = 0;
+		this->end = 0;
+		this->loopStarts.clear();
+		this->loopStarts += (int64_t)0;
+		this->empty = false;
+		return true;
+	}
+
+	bool SharedStream::_join(int64_t* position, int64_t* loopStart)
+	{
+		// the most recent pass keeps the reader as far away from the oldest data as possible
+		for (int i = this->loopStarts.size() - 1; i >= 0; --i)
+		{
+			if (this->loopStarts[i] >= this->start)
+			{
+				(*position) = this->loopStarts[i];
+				(*loopStart) = this->loopStarts[i];
+				return true;
+			}
+		}
+		return false;
+	}
+
+	int SharedStream::_decode(int size)
+	{
+		if (this->empty)
+		{
+			return 0;
+		}
+		// the decoding reader's own data must not be dropped before it was read
+		size = hmin(size, this->capacity / 2);
+		int result = 0;
+		int read = 0;
+		int index = 0;
+		bool rewound = false;
+		while (result < size)
+		{
+			index = (int)(this->end % this->capacity);
+			read = this->source->loadChunkRaw(&this->data[index], hmin(size - result, this->capacity - index));
+			if (read > 0)
+			{
+				this->end += read;
+				result += read;
+				rewound = false;
+			}
+			else if (!rewound)
+			{
+				// always continues with the next pass, any reader can still decide whether it's looping or not
+				this->source->rewind();
+				this->loopStarts |= this->end;
+				rewound = true;
+			}
+			else // a Source that is empty right after a rewind would cause an infinite loop
+			{
+				this->empty = true;
+				break;
+			}
+		}
+		xal::manager->_countStreamAllocations(this->source->_takeAllocations());
+		this->start = hmax(this->start, this->end - this->capacity);
+		while (this->loopStarts.size() > 1 && this->loopStarts[1] <= this->start)
+		{
+			this->loopStarts.removeAt(0);
+		}
+		return result;
+	}
+
+}
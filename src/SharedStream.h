@@ -0,0 +1,108 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Defines a decoder of streamed audio data that is shared by multiple Players of the same Sound.
+
+#ifndef XAL_SHARED_STREAM_H
+#define XAL_SHARED_STREAM_H
+
+#include <stdint.h>
+
+#include <hltypes/harray.h>
+#include <hltypes/hmutex.h>
+
+#include "xalExport.h"
+
+#define SHARED_STREAM_WINDOW_TIME 2.0f // in seconds, how far Players can be apart and still share the decoded data
+
+namespace xal
+{
+	class Sound;
+	class Source;
+
+	/// @brief Decodes a streamed Sound once into a window of PCM data from which multiple readers consume at their own pace.
+	/// @note Readers that fall behind the window cannot use it anymore and have to decode on their own.
+	class SharedStream
+	{
+	public:
+		/// @brief Constructor.
+		/// @param[in] sound The Sound.
+		SharedStream(Sound* sound);
+		/// @brief Destructor.
+		~SharedStream();
+
+		/// @brief Places a reader at the beginning of the audio data.
+		/// @param[out] position Absolute byte-position of the reader.
+		/// @param[out] loopStart Absolute byte-position where the reader's pass through the audio data started.
+		/// @return True if the reader can use the shared data.
+		/// @note A reader can only join if the beginning of the audio data is still inside the window.
+		bool attach(int64_t* position, int64_t* loopStart);
+		/// @brief Moves an attached reader back to the beginning of the audio data.
+		/// @param[in,out] position Absolute byte-position of the reader.
+		/// @param[in,out] loopStart Absolute byte-position where the reader's pass through the audio data started.
+		/// @return True if the reader can still use the shared data. Otherwise the reader is detached.
+		bool rewind(int64_t* position, int64_t* loopStart);
+		/// @brief Removes a reader.
+		/// @note Once no readers are left, the Source is closed.
+		void detach();
+		/// @brief Reads data at a reader's position and decodes more if the reader is ahead of everybody else.
+		/// @param[in,out] position Absolute byte-position of the reader.
+		/// @param[in,out] loopStart Absolute byte-position where the reader's pass through the audio data started.
+		/// @param[out] output Memory where the data will be stored.
+		/// @param[in] size The maximum number of bytes to read.
+		/// @param[in] looping Whether the reader continues at the beginning when the end is reached.
+		/// @param[out] ended Whether the end of the audio data was reached.
+		/// @return The number of bytes read or -1 if the reader's position is not inside the window anymore.
+		int read(int64_t* position, int64_t* loopStart, unsigned char* output, int size, bool looping, bool* ended);
+
+	protected:
+		/// @brief The Source that is decoded.
+		Source* source;
+		/// @brief Decoded data, used as a ring.
+		unsigned char* data;
+		/// @brief Byte-size of data.
+		int capacity;
+		/// @brief Absolute byte-position of the oldest data in the window.
+		int64_t start;
+		/// @brief Absolute byte-position after the newest data in the window.
+		int64_t end;
+		/// @brief Absolute byte-positions at which a pass through the audio data starts.
+		/// @note The Source is rewound at its end so a looping reader can continue seamlessly.
+		harray<int64_t> loopStarts;
+		/// @brief Whether the Source was found to be empty right after a rewind.
+		bool empty;
+		/// @brief Number of attached readers.
+		int readers;
+		/// @brief Mutex for access from the update thread and the streaming service.
+		hmutex mutex;
+
+		/// @brief Discards the window and starts decoding from the beginning of the audio data again.
+		/// @return True if the Source could be opened.
+		/// @note This may only be used while no other reader depends on the window.
+		bool _restart();
+		/// @brief Places a reader at the most recent beginning of the audio data that is still inside the window.
+		/// @param[out] position Absolute byte-position of the reader.
+		/// @param[out] loopStart Absolute byte-position where the reader's pass through the audio data started.
+		/// @return True if the beginning of the audio data was found inside the window.
+		bool _join(int64_t* position, int64_t* loopStart);
+		/// @brief Decodes more data at the end of the window, dropping the oldest data if needed.
+		/// @param[in] size The maximum number of bytes to decode.
+		/// @return The number of bytes decoded.
+		int _decode(int size);
+
+	private:
+		SharedStream(const SharedStream& other);
+		SharedStream& operator=(const SharedStream& other);
+
+	};
+
+}
+
+#endif
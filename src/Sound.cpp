@@ -14,13 +14,15 @@
 #include "AudioManager.h"
 #include "Buffer.h"
 #include "Category.h"
+#include "MappedFile.h"
+#include "SharedStream.h"
 #include "Sound.h"
 #include "Source.h"
 #include "xal.h"
 
 namespace xal
 {
-	Sound::Sound(chstr filename, Category* category, chstr prefix)
+	Sound::Sound(chstr filename, Category* category, chstr prefix) : maxInstances(0), sharedStream(NULL), residentFile(NULL)
 	{
 		this->filename = filename;
 		this->category = category;
@@ -32,6 +34,14 @@ namespace xal
 	Sound::~Sound()
 	{
 		xal::manager->_destroyBuffer(this->buffer);
+		if (this->sharedStream != NULL)
+		{
+			delete this->sharedStream;
+		}
+		if (this->residentFile != NULL)
+		{
+			delete this->residentFile;
+		}
 	}
 	
 	int Sound::getSize()
@@ -41,6 +51,10 @@ namespace xal
 
 	int Sound::getSourceSize()
 	{
+		if (this->residentFile != NULL)
+		{
+			return this->residentFile->getSize();
+		}
 		return this->buffer->getSource()->getRamSize();
 	}
 
@@ -84,4 +98,22 @@ namespace xal
 		Buffer(this).readPcmData(output);
 	}
 
+	SharedStream* Sound::_getSharedStream()
+	{
+		if (this->sharedStream == NULL)
+		{
+			this->sharedStream = new SharedStream(this);
+		}
+		return this->sharedStream;
+	}
+
+	MappedFile* Sound::_getResidentFile()
+	{
+		if (this->residentFile == NULL)
+		{
+			this->residentFile = new MappedFile(this->filename, true);
+		}
+		return this->residentFile;
+	}
+
 }
@@ -6,19 +6,24 @@
 /// This program is free software; you can redistribute it and/or modify it under
 /// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
 
+#include <string.h>
+
 #include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
 #include <hltypes/hstream.h>
 #include <hltypes/hstring.h>
 #include <hltypes/hresource.h>
 
 #include "AudioManager.h"
+#include "MappedFile.h"
 #include "Source.h"
 #include "xal.h"
 
 namespace xal
 {
 	Source::Source(chstr filename, SourceMode sourceMode, BufferMode bufferMode) : streamOpen(false),
-		size(0), channels(2), samplingRate(44100), bitsPerSample(16), duration(0.0f), stream(NULL)
+		size(0), channels(2), samplingRate(44100), bitsPerSample(16), duration(0.0f), floatOutput(false), stream(NULL),
+		mappedFile(NULL), mappedPosition(0), residentFile(NULL), allocations(0)
 	{
 		this->filename = filename;
 		this->sourceMode = sourceMode;
@@ -31,11 +36,15 @@ namespace xal
 		{
 			delete this->stream;
 		}
+		if (this->mappedFile != NULL && this->mappedFile != this->residentFile)
+		{
+			delete this->mappedFile;
+		}
 	}
 
 	int Source::getRamSize()
 	{
-		if (this->sourceMode == RAM && this->stream != NULL)
+		if ((this->sourceMode == RAM || this->sourceMode == MMAP) && this->stream != NULL) // a mapped file is not counted, the OS can page it out any time
 		{
 			return (int)this->stream->size();
 		}
@@ -44,17 +53,45 @@ namespace xal
 
 	bool Source::open()
 	{
+		// the resident file was already read by its owner so opening is free and doesn't have to access the file system
+		if (this->residentFile != NULL && this->residentFile->isMapped())
+		{
+			this->mappedFile = this->residentFile;
+			this->mappedPosition = 0;
+			this->streamOpen = true;
+			return this->streamOpen;
+		}
 		if (!hresource::exists(this->filename))
 		{
 			hlog::error(logTag, "Unable to open: " + this->filename);
 			this->close();
 			return this->streamOpen;
 		}
+		if (this->sourceMode == MMAP)
+		{
+			if (this->mappedFile == NULL && this->stream == NULL)
+			{
+				this->mappedFile = new MappedFile(this->filename);
+				// the mapping bypasses hresource so it's only used if it found the same file that hresource resolves to
+				if (!this->mappedFile->isMapped() || this->mappedFile->getSize() != hresource::hinfo(this->filename).size)
+				{
+					hlog::warn(logTag, "Unable to memory-map, falling back to RAM: " + this->filename);
+					delete this->mappedFile;
+					this->mappedFile = NULL;
+				}
+			}
+			if (this->mappedFile != NULL)
+			{
+				this->mappedPosition = 0;
+				this->streamOpen = true;
+				return this->streamOpen;
+			}
+		}
 		if (this->stream == NULL)
 		{
 			hresource* resource = new hresource;
 			resource->open(this->filename);
-			if (this->sourceMode == RAM || this->bufferMode == ASYNC)
+			if (this->sourceMode == RAM || this->sourceMode == MMAP || this->bufferMode == ASYNC)
 			{
 				this->stream = new hstream();
 				this->stream->writeRaw(*resource);
@@ -91,10 +128,15 @@ namespace xal
 	{
 		if (this->streamOpen)
 		{
-			this->stream->rewind();
+			this->_seek(0, hsbase::START);
 		}
 	}
 	
+	bool Source::seek(int64_t sample)
+	{
+		return false;
+	}
+
 	bool Source::load(hstream& output)
 	{
 		hlog::write(logTag, "Loading file: " + this->filename);
@@ -115,5 +157,121 @@ namespace xal
 		}
 		return 1; // means that "something" was read
 	}
+
+	int Source::loadChunkRaw(unsigned char* output, int size)
+	{
+		// unlike loadChunk(), callers keep reading until 0 is returned so nothing must be reported as read here
+		this->_checkStreamOpen();
+		return 0;
+	}
+
+	int Source::loadChunkPlanar(float** output, int frames)
+	{
+		if (!this->streamOpen)
+		{
+			hlog::error(logTag, "File not open: " + this->filename);
+			return 0;
+		}
+		return (this->_isFloatOutputSupported() ? 1 : 0); // means that "something" was read if it's supported at all
+	}
+
+	int Source::_readRaw(void* data, int size)
+	{
+		if (this->mappedFile == NULL)
+		{
+			return this->stream->readRaw(data, size);
+		}
+		int available = 0;
+		const unsigned char* view = this->_readView(size, &available);
+		if (available > 0)
+		{
+			memcpy(data, view, available);
+		}
+		return available;
+	}
+
+	const unsigned char* Source::_readView(int size, int* available)
+	{
+		*available = 0;
+		if (this->mappedFile == NULL)
+		{
+			return NULL;
+		}
+		const unsigned char* view = this->mappedFile->getData() + this->mappedPosition;
+		*available = hclamp(size, 0, this->mappedFile->getSize() - this->mappedPosition);
+		this->mappedPosition += *available;
+		return view;
+	}
+
+	void Source::_seek(int64_t offset, hsbase::SeekMode seekMode)
+	{
+		if (this->mappedFile == NULL)
+		{
+			this->stream->seek(offset, seekMode);
+			return;
+		}
+		int64_t position = this->mappedPosition;
+		switch (seekMode)
+		{
+		case hsbase::CURRENT:
+			position += offset;
+			break;
+		case hsbase::START:
+			position = offset;
+			break;
+		case hsbase::END:
+			position = this->mappedFile->getSize() + offset;
+			break;
+		}
+		this->mappedPosition = (int)hclamp(position, (int64_t)0, (int64_t)this->mappedFile->getSize());
+	}
+
+	int64_t Source::_position()
+	{
+		return (this->mappedFile != NULL ? this->mappedPosition : this->stream->position());
+	}
+
+	bool Source::_checkStreamOpen()
+	{
+		if (!this->streamOpen)
+		{
+			hlog::error(logTag, "File not open: " + this->filename);
+			return false;
+		}
+		return true;
+	}
+
+	bool Source::_eof()
+	{
+		return (this->mappedFile != NULL ? this->mappedPosition >= this->mappedFile->getSize() : this->stream->eof());
+	}
+
+	const unsigned char* Source::_getDataView(int* size)
+	{
+		*size = 0;
+		return NULL;
+	}
+
+	bool Source::_isFloatOutputSupported()
+	{
+		return false;
+	}
+
+	int Source::_takeAllocations()
+	{
+		int result = this->allocations;
+		this->allocations = 0;
+		return result;
+	}
+
+	void Source::_setFloatOutput(bool value)
+	{
+		this->floatOutput = (value && this->_isFloatOutputSupported());
+	}
+
+	void Source::_setResidentFile(MappedFile* residentFile)
+	{
+		this->residentFile = residentFile;
+	}
 	
 }
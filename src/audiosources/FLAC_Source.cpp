@@ -7,12 +7,156 @@
 /// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
 
 #ifdef _FORMAT_FLAC
+#include <string.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hstream.h>
+
+#include "AudioManager.h"
 #include "FLAC_Source.h"
 #include "xal.h"
 
+#define FLAC_INPUT_PADDING 8 // the bit reader always loads 8 bytes at once
+#define FLAC_FRAME_OVERHEAD 32 // maximum byte-size of frame header and footer
+#define FLAC_SUBFRAME_OVERHEAD 32 // maximum byte-size of a subframe's header, warm-up samples and coefficients outside of the samples themselves
+
 namespace xal
 {
-	FLAC_Source::FLAC_Source(chstr filename, SourceMode sourceMode, BufferMode bufferMode) : Source(filename, sourceMode, bufferMode)
+	static inline uint64_t _load64(const unsigned char* data)
+	{
+		return (((uint64_t)data[0] << 56) | ((uint64_t)data[1] << 48) | ((uint64_t)data[2] << 40) | ((uint64_t)data[3] << 32) |
+			((uint64_t)data[4] << 24) | ((uint64_t)data[5] << 16) | ((uint64_t)data[6] << 8) | (uint64_t)data[7]);
+	}
+
+	// value may not be 0
+	static inline int _countLeadingZeros(uint64_t value)
+	{
+#ifdef _MSC_VER
+#ifdef _WIN64
+		unsigned long index = 0;
+		_BitScanReverse64(&index, value);
+		return (63 - (int)index);
+#else
+		unsigned long index = 0;
+		if ((value >> 32) != 0)
+		{
+			_BitScanReverse(&index, (unsigned long)(value >> 32));
+			return (31 - (int)index);
+		}
+		_BitScanReverse(&index, (unsigned long)value);
+		return (63 - (int)index);
+#endif
+#else
+		return __builtin_clzll(value);
+#endif
+	}
+
+	static unsigned char _crc8(const unsigned char* data, int size)
+	{
+		unsigned char crc = 0;
+		for_iter (i, 0, size)
+		{
+			crc ^= data[i];
+			for_iter (j, 0, 8)
+			{
+				crc = (unsigned char)((crc & 0x80) != 0 ? (crc << 1) ^ 0x07 : crc << 1);
+			}
+		}
+		return crc;
+	}
+
+	// CRC-16 covers the whole frame so it's calculated with a table
+	static struct Crc16Table
+	{
+		unsigned short values[256];
+
+		Crc16Table()
+		{
+			unsigned short crc = 0;
+			for_iter (i, 0, 256)
+			{
+				crc = (unsigned short)(i << 8);
+				for_iter (j, 0, 8)
+				{
+					crc = (unsigned short)((crc & 0x8000) != 0 ? (crc << 1) ^ 0x8005 : crc << 1);
+				}
+				this->values[i] = crc;
+			}
+		}
+
+	} _crc16Table;
+
+	static unsigned short _crc16(const unsigned char* data, int size)
+	{
+		unsigned short crc = 0;
+		for_iter (i, 0, size)
+		{
+			crc = (unsigned short)((crc << 8) ^ _crc16Table.values[(crc >> 8) ^ data[i]]);
+		}
+		return crc;
+	}
+
+	// recursion with a constant order fully unrolls the prediction so it doesn't depend on the compiler's loop heuristics,
+	// all restoration uses unsigned arithmetic because corrupted data can overflow before the frame's CRC-16 is checked
+	template <int ORDER>
+	static inline unsigned int _predictLpc32(const int* coefficients, const int* data)
+	{
+		return ((unsigned int)coefficients[ORDER - 1] * (unsigned int)data[-ORDER] + _predictLpc32<ORDER - 1>(coefficients, data));
+	}
+
+	template <>
+	inline unsigned int _predictLpc32<0>(const int* coefficients, const int* data)
+	{
+		return 0;
+	}
+
+	// not vectorized: every sample depends on the ones restored right before it so only the dot product over the order could use SIMD,
+	// that needs 32 bit multiplies (SSE4.1 or NEON) and a horizontal sum for every sample so the unrolled scalar version is used everywhere
+	template <int ORDER>
+	static void _restoreLpc32(int* data, int count, const int* coefficients, int shift)
+	{
+		for_iter (i, ORDER, count)
+		{
+			data[i] = (int)((unsigned int)data[i] + (unsigned int)((int)_predictLpc32<ORDER>(coefficients, &data[i]) >> shift));
+		}
+	}
+
+	static void _restoreLpc32(int* data, int count, const int* coefficients, int order, int shift)
+	{
+		unsigned int sum = 0;
+		for_iter (i, order, count)
+		{
+			sum = 0;
+			for_iter (j, 0, order)
+			{
+				sum += (unsigned int)coefficients[j] * (unsigned int)data[i - 1 - j];
+			}
+			data[i] = (int)((unsigned int)data[i] + (unsigned int)((int)sum >> shift));
+		}
+	}
+
+	static void _restoreLpc64(int* data, int count, const int* coefficients, int order, int shift)
+	{
+		int64_t sum = 0;
+		for_iter (i, order, count)
+		{
+			sum = 0;
+			for_iter (j, 0, order)
+			{
+				sum += (int64_t)coefficients[j] * data[i - 1 - j];
+			}
+			data[i] = (int)((unsigned int)data[i] + (unsigned int)(sum >> shift));
+		}
+	}
+
+	FLAC_Source::FLAC_Source(chstr filename, SourceMode sourceMode, BufferMode bufferMode) : Source(filename, sourceMode, bufferMode),
+		sourceBitsPerSample(16), maxBlockSize(0), totalSamples(0), remainingSamples(0), firstFrameOffset(0), seekPointsScanned(false), input(NULL),
+		inputCapacity(0), inputSize(0), inputPosition(0), inputEnded(false), bitPosition(0), bitLimit(0), samples(NULL), blockSize(0), blockPosition(0),
+		blockBitsPerSample(16)
 	{
 	}
 
@@ -28,16 +172,116 @@ namespace xal
 		{
 			return false;
 		}
-		// TODO - implement
+		// data will be reloaded, clearing it here
+		this->channels = 0;
+		this->samplingRate = 0;
+		this->size = 0;
+		this->duration = 0.0f;
+		this->maxBlockSize = 0;
+		this->totalSamples = 0;
+		this->seekSamples.clear();
+		this->seekOffsets.clear();
+		this->seekPointsScanned = false;
+		unsigned char buffer[34] = {0};
+		if (this->_readRaw(buffer, 4) != 4 || memcmp(buffer, "fLaC", 4) != 0)
+		{
+			hlog::error(logTag, "FLAC: not a FLAC file: " + this->filename);
+			this->close();
+			return false;
+		}
+		// metadata blocks, only STREAMINFO and SEEKTABLE are needed
+		bool last = false;
+		int type = 0;
+		int size = 0;
+		while (!last)
+		{
+			if (this->_readRaw(buffer, 4) != 4)
+			{
+				break;
+			}
+			last = ((buffer[0] & 0x80) != 0);
+			type = (buffer[0] & 0x7F);
+			size = ((int)buffer[1] << 16) | ((int)buffer[2] << 8) | (int)buffer[3];
+			if (type == 0 && size >= 34)
+			{
+				this->_readRaw(buffer, 34);
+				this->maxBlockSize = ((int)buffer[2] << 8) | (int)buffer[3];
+				this->samplingRate = ((int)buffer[10] << 12) | ((int)buffer[11] << 4) | ((int)buffer[12] >> 4);
+				this->channels = ((buffer[12] >> 1) & 0x07) + 1;
+				this->sourceBitsPerSample = (((buffer[12] & 0x01) << 4) | (buffer[13] >> 4)) + 1;
+				this->totalSamples = ((int64_t)(buffer[13] & 0x0F) << 32) | ((int64_t)buffer[14] << 24) | ((int64_t)buffer[15] << 16) |
+					((int64_t)buffer[16] << 8) | (int64_t)buffer[17];
+				size -= 34;
+			}
+			else if (type == 3)
+			{
+				while (size >= 18)
+				{
+					this->_readRaw(buffer, 18);
+					size -= 18;
+					// placeholder points are filled with 0xFF
+					if (buffer[0] != 0xFF || buffer[1] != 0xFF)
+					{
+						this->seekSamples += (int64_t)_load64(buffer);
+						this->seekOffsets += (int64_t)_load64(&buffer[8]);
+					}
+				}
+			}
+			if (size > 0)
+			{
+				this->_seek(size);
+			}
+		}
+		this->firstFrameOffset = this->_position();
+		if (this->channels == 0 || this->samplingRate == 0 || this->maxBlockSize < 16)
+		{
+			hlog::error(logTag, "FLAC: missing or invalid stream info: " + this->filename);
+			this->close();
+			return false;
+		}
+		if (this->channels > 2) // the audio-systems only handle mono and stereo
+		{
+			hlog::error(logTag, "FLAC: more than 2 channels not supported: " + this->filename);
+			this->close();
+			return false;
+		}
+		if (this->sourceBitsPerSample > 24)
+		{
+			hlog::error(logTag, "FLAC: more than 24 bits per sample not supported: " + this->filename);
+			this->close();
+			return false;
+		}
+		if (this->totalSamples <= 0 || this->totalSamples * this->channels * 2 > 0x7FFFFFFF)
+		{
+			hlog::error(logTag, "FLAC: unknown or unsupported length: " + this->filename);
+			this->close();
+			return false;
+		}
+		this->bitsPerSample = 16; // always 16 bit data
+		this->size = (int)(this->totalSamples * this->channels * this->bitsPerSample / 8);
+		this->duration = (float)this->totalSamples / this->samplingRate;
+		// room for two worst-case frames so the file is read in large blocks, the side channel of stereo frames has 1 additional bit
+		int frameSize = this->maxBlockSize * this->channels * (this->sourceBitsPerSample + 1) / 8 + this->channels * FLAC_SUBFRAME_OVERHEAD + FLAC_FRAME_OVERHEAD;
+		this->inputCapacity = frameSize * 2;
+		this->input = new unsigned char[this->inputCapacity + FLAC_INPUT_PADDING];
+		memset(this->input, 0, (this->inputCapacity + FLAC_INPUT_PADDING) * sizeof(unsigned char));
+		this->samples = new int[this->channels * this->maxBlockSize];
+		this->rewind();
 		return this->streamOpen;
 	}
 
 	void FLAC_Source::close()
 	{
-		if (this->streamOpen)
+		if (this->input != NULL)
 		{
-			this->streamOpen = false;
-			// TODO - implement
+			delete[] this->input;
+			this->input = NULL;
+		}
+		this->inputCapacity = 0;
+		if (this->samples != NULL)
+		{
+			delete[] this->samples;
+			this->samples = NULL;
 		}
 		Source::close();
 	}
@@ -46,7 +290,96 @@ namespace xal
 	{
 		if (this->streamOpen)
 		{
-			// TODO - implement
+			// no headers have to be parsed again, decoding simply starts over at the first frame
+			this->_seek(this->firstFrameOffset, hsbase::START);
+			this->inputSize = 0;
+			this->inputPosition = 0;
+			this->inputEnded = false;
+			this->blockSize = 0;
+			this->blockPosition = 0;
+			this->remainingSamples = this->totalSamples;
+		}
+	}
+
+	bool FLAC_Source::seek(int64_t sample)
+	{
+		if (!this->streamOpen || sample < 0 || sample > this->totalSamples)
+		{
+			return false;
+		}
+		if (this->seekSamples.size() == 0 && !this->seekPointsScanned)
+		{
+			this->_scanSeekPoints();
+		}
+		if (this->seekSamples.size() == 0)
+		{
+			return false;
+		}
+		int64_t start = 0;
+		int64_t offset = 0;
+		for_iter (i, 0, this->seekSamples.size())
+		{
+			if (this->seekSamples[i] <= sample && this->seekSamples[i] >= start)
+			{
+				start = this->seekSamples[i];
+				offset = this->seekOffsets[i];
+			}
+		}
+		this->_seek(this->firstFrameOffset + offset, hsbase::START);
+		this->inputSize = 0;
+		this->inputPosition = 0;
+		this->inputEnded = false;
+		this->blockSize = 0;
+		this->blockPosition = 0;
+		this->remainingSamples = this->totalSamples - start;
+		// the frames between the seek point and the sample are decoded and skipped
+		int64_t skip = sample - start;
+		while (skip > 0 && this->_decodeFrame())
+		{
+			this->blockPosition = (int)hmin(skip, (int64_t)this->blockSize);
+			skip -= this->blockPosition;
+		}
+		return (skip == 0);
+	}
+
+	void FLAC_Source::_scanSeekPoints()
+	{
+		this->seekPointsScanned = true;
+		this->rewind();
+		int64_t expected = 0;
+		int64_t nextPoint = 0;
+		int64_t sample = 0;
+		int channelAssignment = 0;
+		while (expected < this->totalSamples)
+		{
+			this->_fillInput(false);
+			if (this->inputSize - this->inputPosition < 2)
+			{
+				break;
+			}
+			if (this->input[this->inputPosition] == 0xFF && (this->input[this->inputPosition + 1] & 0xFE) == 0xF8)
+			{
+				this->bitPosition = this->inputPosition * 8;
+				this->bitLimit = this->inputSize * 8;
+				// a sync code within the audio data can pass the CRC-8, but it won't continue the frame numbering
+				if (this->_decodeFrameHeader(&channelAssignment, &sample) && sample == expected)
+				{
+					if (sample >= nextPoint)
+					{
+						this->seekSamples += sample;
+						this->seekOffsets += this->_position() - this->inputSize + this->inputPosition - this->firstFrameOffset;
+						nextPoint = sample + this->samplingRate;
+					}
+					expected = sample + this->blockSize;
+					this->inputPosition = this->bitPosition / 8;
+					continue;
+				}
+			}
+			++this->inputPosition;
+		}
+		if (this->seekSamples.size() == 0)
+		{
+			hlog::warn(logTag, "FLAC: no frames found for seeking: " + this->filename);
 		}
 	}
 
@@ -56,7 +389,13 @@ namespace xal
 		{
 			return false;
 		}
-		// TODO - implement
+		output.prepareManualWriteRaw(this->size);
+		unsigned char* buffer = (unsigned char*)output;
+		int read = this->loadChunkRaw(buffer, this->size);
+		if (read < this->size)
+		{
+			memset(&buffer[read], 0, (this->size - read) * sizeof(unsigned char));
+		}
 		return true;
 	}
 
@@ -66,8 +405,551 @@ namespace xal
 		{
 			return 0;
 		}
-		// TODO - implement
-		return 0;
+		output.prepareManualWriteRaw(size);
+		int result = this->loadChunkRaw((unsigned char*)output, size);
+		output.truncate((int64_t)result); // if there wasn't enough data to fill the entire ouput buffer
+		return result;
+	}
+
+	int FLAC_Source::loadChunkRaw(unsigned char* output, int size)
+	{
+		if (!this->_checkStreamOpen())
+		{
+			return 0;
+		}
+		int frameSize = this->channels * this->bitsPerSample / 8;
+		int written = 0;
+		int count = 0;
+		while (size - written >= frameSize)
+		{
+			if (this->blockPosition >= this->blockSize && !this->_decodeFrame())
+			{
+				break;
+			}
+			count = hmin(this->blockSize - this->blockPosition, (size - written) / frameSize);
+			this->_writeSamples(&output[written], count);
+			written += count * frameSize;
+		}
+		return written;
+	}
+
+	void FLAC_Source::_fillInput(bool force)
+	{
+		int remaining = this->inputSize - this->inputPosition;
+		if (this->inputEnded || (!force && remaining >= this->inputCapacity / 2))
+		{
+			return;
+		}
+		if (remaining > 0 && this->inputPosition > 0)
+		{
+			memmove(this->input, &this->input[this->inputPosition], remaining * sizeof(unsigned char));
+		}
+		this->inputSize = remaining;
+		this->inputPosition = 0;
+		int read = 0;
+		while (this->inputSize < this->inputCapacity)
+		{
+			read = this->_readRaw(&this->input[this->inputSize], this->inputCapacity - this->inputSize);
+			if (read <= 0)
+			{
+				this->inputEnded = true;
+				break;
+			}
+			this->inputSize += read;
+		}
+		// the bit reader may look at the padding when it runs out of data, it must not find a valid value there
+		memset(&this->input[this->inputSize], 0, FLAC_INPUT_PADDING * sizeof(unsigned char));
+	}
+
+	bool FLAC_Source::_decodeFrame()
+	{
+		if (this->remainingSamples <= 0)
+		{
+			this->blockSize = 0;
+			this->blockPosition = 0;
+			return false;
+		}
+		while (true)
+		{
+			this->_fillInput(false);
+			if (this->inputSize - this->inputPosition < 2)
+			{
+				// a failed attempt may have changed the block size
+				this->blockSize = 0;
+				this->blockPosition = 0;
+				return false;
+			}
+			// frame sync code
+			if (this->input[this->inputPosition] == 0xFF && (this->input[this->inputPosition + 1] & 0xFE) == 0xF8)
+			{
+				this->bitPosition = this->inputPosition * 8;
+				this->bitLimit = this->inputSize * 8;
+				if (this->_decodeFrameAt())
+				{
+					this->inputPosition = this->bitPosition / 8;
+					this->blockPosition = 0;
+					if (this->blockSize > this->remainingSamples)
+					{
+						this->blockSize = (int)this->remainingSamples;
+					}
+					this->remainingSamples -= this->blockSize;
+					return true;
+				}
+				if (this->bitPosition > this->bitLimit && !this->inputEnded)
+				{
+					// the frame didn't fit, it's decoded again when there is more data
+					if (this->inputPosition == 0 && this->inputSize == this->inputCapacity)
+					{
+						unsigned char* newInput = new unsigned char[this->inputCapacity * 2 + FLAC_INPUT_PADDING];
+						memcpy(newInput, this->input, this->inputSize * sizeof(unsigned char));
+						delete[] this->input;
+						this->input = newInput;
+						this->inputCapacity *= 2;
+						++this->allocations;
+					}
+					this->_fillInput(true);
+					continue;
+				}
+			}
+			// not a frame or a corrupted one, searching for the next frame
+			++this->inputPosition;
+		}
+	}
+
+	bool FLAC_Source::_decodeFrameHeader(int* channelAssignment, int64_t* sample)
+	{
+		int start = this->bitPosition / 8;
+		this->_readBits(15); // sync code, already checked
+		bool variableBlocking = (this->_readBits(1) != 0);
+		int blockSizeCode = this->_readBits(4);
+		int samplingRateCode = this->_readBits(4);
+		*channelAssignment = this->_readBits(4);
+		int bitsPerSampleCode = this->_readBits(3);
+		if (this->_readBits(1) != 0)
+		{
+			return false;
+		}
+		// frame or sample number, UTF-8 coded
+		unsigned int value = this->_readBits(8);
+		int length = 0;
+		while ((value & (0x80 >> length)) != 0)
+		{
+			++length;
+		}
+		if (length == 1 || length > 7)
+		{
+			return false;
+		}
+		int64_t number = (int64_t)(value & (0x7F >> length));
+		for_iter (i, 1, length)
+		{
+			value = this->_readBits(8);
+			if ((value & 0xC0) != 0x80)
+			{
+				return false;
+			}
+			number = (number << 6) | (int64_t)(value & 0x3F);
+		}
+		// fixed-blocking streams count frames that all have the block size of the stream info, except for the last one
+		*sample = (variableBlocking ? number : number * this->maxBlockSize);
+		if (blockSizeCode == 0)
+		{
+			return false;
+		}
+		if (blockSizeCode == 1)
+		{
+			this->blockSize = 192;
+		}
+		else if (blockSizeCode <= 5)
+		{
+			this->blockSize = 576 << (blockSizeCode - 2);
+		}
+		else if (blockSizeCode == 6)
+		{
+			this->blockSize = this->_readBits(8) + 1;
+		}
+		else if (blockSizeCode == 7)
+		{
+			this->blockSize = this->_readBits(16) + 1;
+		}
+		else
+		{
+			this->blockSize = 256 << (blockSizeCode - 8);
+		}
+		// the sampling rate of the stream info is used anyway
+		if (samplingRateCode == 12)
+		{
+			this->_readBits(8);
+		}
+		else if (samplingRateCode == 13 || samplingRateCode == 14)
+		{
+			this->_readBits(16);
+		}
+		else if (samplingRateCode == 15)
+		{
+			return false;
+		}
+		int channels = (*channelAssignment < 8 ? *channelAssignment + 1 : 2);
+		if (*channelAssignment > 10 || channels != this->channels)
+		{
+			return false;
+		}
+		static const int bitsPerSampleValues[8] = {0, 8, 12, 0, 16, 20, 24, 0};
+		this->blockBitsPerSample = (bitsPerSampleCode == 0 ? this->sourceBitsPerSample : bitsPerSampleValues[bitsPerSampleCode]);
+		if (this->blockBitsPerSample == 0 || this->blockBitsPerSample > 24)
+		{
+			return false;
+		}
+		int end = this->bitPosition / 8;
+		if (this->bitPosition > this->bitLimit || this->_readBits(8) != _crc8(&this->input[start], end - start))
+		{
+			return false;
+		}
+		if (this->blockSize > this->maxBlockSize)
+		{
+			return false;
+		}
+		return true;
+	}
+
+	bool FLAC_Source::_decodeFrameAt()
+	{
+		int start = this->bitPosition / 8;
+		int channelAssignment = 0;
+		int64_t sample = 0;
+		if (!this->_decodeFrameHeader(&channelAssignment, &sample))
+		{
+			return false;
+		}
+		int* left = this->samples;
+		int* right = &this->samples[this->maxBlockSize];
+		bool sideChannel = false;
+		for_iter (i, 0, this->channels)
+		{
+			// the side channel needs 1 more bit
+			sideChannel = (((channelAssignment == 8 || channelAssignment == 10) && i == 1) || (channelAssignment == 9 && i == 0));
+			if (!this->_decodeSubframe(&this->samples[i * this->maxBlockSize], this->blockSize, this->blockBitsPerSample + (sideChannel ? 1 : 0)))
+			{
+				return false;
+			}
+		}
+		// byte alignment and CRC-16, corrupted frames are skipped instead of being played as noise
+		int end = (this->bitPosition + 7) / 8;
+		this->bitPosition = end * 8 + 16;
+		if (this->bitPosition > this->bitLimit || (((int)this->input[end] << 8) | (int)this->input[end + 1]) != _crc16(&this->input[start], end - start))
+		{
+			return false;
+		}
+		unsigned int mid = 0;
+		int side = 0;
+		switch (channelAssignment)
+		{
+		case 8: // left/side
+			for_iter (i, 0, this->blockSize)
+			{
+				right[i] = (int)((unsigned int)left[i] - right[i]);
+			}
+			break;
+		case 9: // side/right
+			for_iter (i, 0, this->blockSize)
+			{
+				left[i] = (int)((unsigned int)left[i] + right[i]);
+			}
+			break;
+		case 10: // mid/side
+			for_iter (i, 0, this->blockSize)
+			{
+				side = right[i];
+				mid = (((unsigned int)left[i] << 1) | (side & 1));
+				left[i] = (int)(mid + side) >> 1;
+				right[i] = (int)(mid - side) >> 1;
+			}
+			break;
+		}
+		return true;
+	}
+
+	bool FLAC_Source::_decodeSubframe(int* output, int count, int bitsPerSample)
+	{
+		if (this->_readBits(1) != 0)
+		{
+			return false;
+		}
+		int type = this->_readBits(6);
+		int wastedBits = 0;
+		if (this->_readBits(1) != 0)
+		{
+			wastedBits = this->_readUnary() + 1;
+			bitsPerSample -= wastedBits;
+			if (bitsPerSample <= 0)
+			{
+				return false;
+			}
+		}
+		if (type == 0) // constant
+		{
+			int value = this->_readSignedBits(bitsPerSample);
+			for_iter (i, 0, count)
+			{
+				output[i] = value;
+			}
+		}
+		else if (type == 1) // verbatim
+		{
+			for_iter (i, 0, count)
+			{
+				output[i] = this->_readSignedBits(bitsPerSample);
+			}
+		}
+		else if (type >= 8 && type <= 12) // fixed predictor
+		{
+			int order = type - 8;
+			if (order > count)
+			{
+				return false;
+			}
+			for_iter (i, 0, order)
+			{
+				output[i] = this->_readSignedBits(bitsPerSample);
+			}
+			if (!this->_decodeResidual(output, count, order))
+			{
+				return false;
+			}
+			switch (order)
+			{
+			case 1:
+				for_iter (i, 1, count)
+				{
+					output[i] = (int)((unsigned int)output[i] + output[i - 1]);
+				}
+				break;
+			case 2:
+				for_iter (i, 2, count)
+				{
+					output[i] = (int)((unsigned int)output[i] + 2u * output[i - 1] - output[i - 2]);
+				}
+				break;
+			case 3:
+				for_iter (i, 3, count)
+				{
+					output[i] = (int)((unsigned int)output[i] + 3u * ((unsigned int)output[i - 1] - output[i - 2]) + output[i - 3]);
+				}
+				break;
+			case 4:
+				for_iter (i, 4, count)
+				{
+					output[i] = (int)((unsigned int)output[i] + 4u * ((unsigned int)output[i - 1] + output[i - 3]) - 6u * output[i - 2] - output[i - 4]);
+				}
+				break;
+			}
+		}
+		else if (type >= 32) // linear predictor
+		{
+			int order = (type & 0x1F) + 1;
+			if (order > count)
+			{
+				return false;
+			}
+			for_iter (i, 0, order)
+			{
+				output[i] = this->_readSignedBits(bitsPerSample);
+			}
+			int precision = this->_readBits(4) + 1;
+			int shift = this->_readSignedBits(5);
+			if (precision > 15 || shift < 0)
+			{
+				return false;
+			}
+			int coefficients[FLAC_MAX_LPC_ORDER];
+			for_iter (i, 0, order)
+			{
+				coefficients[i] = this->_readSignedBits(precision);
+			}
+			if (!this->_decodeResidual(output, count, order))
+			{
+				return false;
+			}
+			// the sum of the products fits into 32 bits for up to 16 bit data with typical precisions
+			int orderBits = 0;
+			while ((1 << orderBits) < order)
+			{
+				++orderBits;
+			}
+			if (bitsPerSample + precision + orderBits > 32)
+			{
+				_restoreLpc64(output, count, coefficients, order, shift);
+			}
+			else
+			{
+				// the orders allowed by the streamable subset of the format
+				switch (order)
+				{
+				case 1:		_restoreLpc32<1>(output, count, coefficients, shift);		break;
+				case 2:		_restoreLpc32<2>(output, count, coefficients, shift);		break;
+				case 3:		_restoreLpc32<3>(output, count, coefficients, shift);		break;
+				case 4:		_restoreLpc32<4>(output, count, coefficients, shift);		break;
+				case 5:		_restoreLpc32<5>(output, count, coefficients, shift);		break;
+				case 6:		_restoreLpc32<6>(output, count, coefficients, shift);		break;
+				case 7:		_restoreLpc32<7>(output, count, coefficients, shift);		break;
+				case 8:		_restoreLpc32<8>(output, count, coefficients, shift);		break;
+				case 9:		_restoreLpc32<9>(output, count, coefficients, shift);		break;
+				case 10:	_restoreLpc32<10>(output, count, coefficients, shift);		break;
+				case 11:	_restoreLpc32<11>(output, count, coefficients, shift);		break;
+				case 12:	_restoreLpc32<12>(output, count, coefficients, shift);		break;
+				default:	_restoreLpc32(output, count, coefficients, order, shift);	break;
+				}
+			}
+		}
+		else
+		{
+			return false;
+		}
+		if (wastedBits > 0)
+		{
+			for_iter (i, 0, count)
+			{
+				output[i] = (int)((unsigned int)output[i] << wastedBits);
+			}
+		}
+		return (this->bitPosition <= this->bitLimit);
+	}
+
+	bool FLAC_Source::_decodeResidual(int* output, int count, int order)
+	{
+		int method = this->_readBits(2);
+		if (method > 1)
+		{
+			return false;
+		}
+		int parameterBits = (method == 0 ? 4 : 5);
+		int escapeParameter = (method == 0 ? 15 : 31);
+		int partitionOrder = this->_readBits(4);
+		int partitionSize = count >> partitionOrder;
+		if ((partitionSize << partitionOrder) != count || partitionSize < order)
+		{
+			return false;
+		}
+		const unsigned char* input = this->input;
+		int limit = this->bitLimit;
+		int position = 0;
+		int parameter = 0;
+		int bits = 0;
+		int size = 0;
+		uint64_t cache = 0;
+		int available = 0;
+		int zeros = 0;
+		unsigned int value = 0;
+		output += order;
+		for_iter (i, 0, 1 << partitionOrder)
+		{
+			size = (i == 0 ? partitionSize - order : partitionSize);
+			parameter = this->_readBits(parameterBits);
+			if (parameter == escapeParameter)
+			{
+				bits = this->_readBits(5);
+				for_iter (j, 0, size)
+				{
+					output[j] = (bits > 0 ? this->_readSignedBits(bits) : 0);
+				}
+				output += size;
+				continue;
+			}
+			// the hot loop of the decoder, works on a 64 bit cache that is only reloaded when it runs low
+			position = this->bitPosition;
+			available = 0;
+			for_iter (j, 0, size)
+			{
+				if (available < 32)
+				{
+					if (position > limit)
+					{
+						this->bitPosition = position;
+						return false;
+					}
+					cache = _load64(&input[position >> 3]) << (position & 7);
+					available = 64 - (position & 7);
+				}
+				if (cache != 0 && (zeros = _countLeadingZeros(cache)) + 1 + parameter < available)
+				{
+					cache <<= zeros + 1;
+					// shifting in two steps avoids an undefined shift by 64 when the parameter is 0
+					value = ((unsigned int)zeros << parameter) | (unsigned int)((cache >> 1) >> (63 - parameter));
+					cache <<= parameter;
+					available -= zeros + 1 + parameter;
+					position += zeros + 1 + parameter;
+				}
+				else
+				{
+					this->bitPosition = position;
+					value = ((unsigned int)this->_readUnary() << parameter);
+					value |= this->_readBits(parameter);
+					position = this->bitPosition;
+					available = 0;
+				}
+				output[j] = (int)(value >> 1) ^ -(int)(value & 1);
+			}
+			this->bitPosition = position;
+			output += size;
+		}
+		return (this->bitPosition <= this->bitLimit);
+	}
+
+	unsigned int FLAC_Source::_readBits(int count)
+	{
+		if (count == 0 || this->bitPosition > this->bitLimit)
+		{
+			return 0;
+		}
+		uint64_t window = _load64(&this->input[this->bitPosition >> 3]) << (this->bitPosition & 7);
+		this->bitPosition += count;
+		return (unsigned int)(window >> (64 - count));
+	}
+
+	int FLAC_Source::_readSignedBits(int count)
+	{
+		if (count == 0)
+		{
+			return 0;
+		}
+		unsigned int value = this->_readBits(count);
+		return (int)(value << (32 - count)) >> (32 - count);
+	}
+
+	int FLAC_Source::_readUnary()
+	{
+		int result = 0;
+		while (this->bitPosition <= this->bitLimit && this->_readBits(1) == 0)
+		{
+			++result;
+		}
+		return result;
+	}
+
+	void FLAC_Source::_writeSamples(unsigned char* output, int count)
+	{
+		short* data = (short*)output;
+		int shift = this->blockBitsPerSample - 16;
+		const int* plane = NULL;
+		for_iter (i, 0, this->channels)
+		{
+			plane = &this->samples[i * this->maxBlockSize + this->blockPosition];
+			if (shift > 0)
+			{
+				for_iter (j, 0, count)
+				{
+					data[j * this->channels + i] = (short)(plane[j] >> shift);
+				}
+			}
+			else
+			{
+				for_iter (j, 0, count)
+				{
+					data[j * this->channels + i] = (short)((unsigned int)plane[j] << -shift);
+				}
+			}
+		}
+		this->blockPosition += count;
 	}
 
 }
@@ -14,13 +14,22 @@
 #ifndef XAL_FLAC_SOURCE_H
 #define XAL_FLAC_SOURCE_H
 
+#include <stdint.h>
+
+#include <hltypes/harray.h>
 #include <hltypes/hstring.h>
 
+#include "AudioManager.h"
 #include "Source.h"
 #include "xalExport.h"
 
+#define FLAC_MAX_LPC_ORDER 32
+
 namespace xal
 {
+	/// @brief Decodes native FLAC files frame by frame.
+	/// @note The data is always provided as 16 bit, sources with more bits per sample are truncated.
+	/// @note Only mono and stereo files are supported, because the audio-systems cannot play more channels.
 	class xalExport FLAC_Source : public Source
 	{
 	public:
@@ -30,8 +39,97 @@ namespace xal
 		bool open();
 		void close();
 		void rewind();
+		/// @note Decoding starts at the closest seek point before the sample. Files without a seek table have their frame headers scanned once on the first seek.
+		bool seek(int64_t sample);
 		bool load(hstream& output);
 		int loadChunk(hstream& output, int size = STREAM_BUFFER_SIZE);
+		int loadChunkRaw(unsigned char* output, int size);
+
+	protected:
+		/// @brief Number of bits per sample in the file.
+		int sourceBitsPerSample;
+		/// @brief Maximum number of samples per channel in a frame.
+		int maxBlockSize;
+		/// @brief Number of samples per channel in the file.
+		int64_t totalSamples;
+		/// @brief Number of samples per channel that haven't been decoded yet.
+		int64_t remainingSamples;
+		/// @brief Position of the first frame within the file.
+		int64_t firstFrameOffset;
+		/// @brief First sample of each frame listed in the file's seek table.
+		harray<int64_t> seekSamples;
+		/// @brief Byte-offset of each frame listed in the file's seek table, relative to firstFrameOffset.
+		harray<int64_t> seekOffsets;
+		/// @brief Whether the frame headers have already been scanned for seek points, because the file has no seek table.
+		bool seekPointsScanned;
+		/// @brief Raw file data, followed by a few zeroed bytes so the bit reader never has to check for the end of a word.
+		unsigned char* input;
+		/// @brief Byte-size of input without the padding.
+		int inputCapacity;
+		/// @brief Number of valid bytes in input.
+		int inputSize;
+		/// @brief Byte-position of the next frame in input.
+		int inputPosition;
+		/// @brief Whether the whole file has been read into input.
+		bool inputEnded;
+		/// @brief Bit-position of the bit reader in input.
+		int bitPosition;
+		/// @brief Bit-position in input after which the bit reader has run out of valid data.
+		int bitLimit;
+		/// @brief Decoded samples of the current frame, one plane of maxBlockSize samples per channel.
+		int* samples;
+		/// @brief Number of samples per channel in the current frame.
+		int blockSize;
+		/// @brief Number of samples per channel in the current frame that have already been provided.
+		int blockPosition;
+		/// @brief Number of bits per sample in the current frame.
+		int blockBitsPerSample;
+
+		/// @brief Reads more file data into input if the next frame might not be complete.
+		/// @param[in] force Whether to read even if there seems to be enough data.
+		void _fillInput(bool force);
+		/// @brief Decodes the next frame into samples.
+		/// @return True if a frame was decoded.
+		/// @note Corrupted data is skipped until the next valid frame header.
+		bool _decodeFrame();
+		/// @brief Scans all frame headers in the file and adds a seek point for about every second of audio.
+		/// @note This is only used if the file has no seek table.
+		void _scanSeekPoints();
+		/// @brief Decodes the frame at the current bit-position.
+		/// @return True if the frame is valid.
+		bool _decodeFrameAt();
+		/// @brief Decodes the header of the frame at the current bit-position.
+		/// @param[out] channelAssignment The frame's channel assignment.
+		/// @param[out] sample The frame's first sample.
+		/// @return True if the header is valid.
+		bool _decodeFrameHeader(int* channelAssignment, int64_t* sample);
+		/// @brief Decodes a subframe.
+		/// @param[out] output Memory where the samples will be stored.
+		/// @param[in] count Number of samples.
+		/// @param[in] bitsPerSample Number of bits per sample in the subframe.
+		/// @return True if the subframe is valid.
+		bool _decodeSubframe(int* output, int count, int bitsPerSample);
+		/// @brief Decodes the Rice-coded residual of a predicted subframe.
+		/// @param[out] output Memory where the residual will be stored, after the warm-up samples.
+		/// @param[in] count Number of samples in the subframe.
+		/// @param[in] order Predictor order, i.e. number of warm-up samples.
+		/// @return True if the residual is valid.
+		bool _decodeResidual(int* output, int count, int order);
+		/// @brief Reads unsigned bits from input.
+		/// @param[in] count Number of bits, at most 32.
+		/// @return The value.
+		unsigned int _readBits(int count);
+		/// @brief Reads a two's complement value from input.
+		/// @param[in] count Number of bits, at most 32.
+		/// @return The value.
+		int _readSignedBits(int count);
+		/// @brief Reads a unary coded value from input.
+		/// @return Number of 0-bits before the next 1-bit.
+		int _readUnary();
+		/// @brief Writes decoded samples as interleaved 16 bit data.
+		/// @param[out] output Memory where the data will be stored.
+		/// @param[in] count Number of samples per channel.
+		void _writeSamples(unsigned char* output, int count);
 
 	};
 
@@ -8,6 +8,7 @@
 
 #ifdef _FORMAT_OGG
 #include <stdio.h>
+#include <string.h>
 #include <ogg/ogg.h>
 #include <vorbis/codec.h>
 #include <vorbis/vorbisfile.h>
@@ -28,8 +29,7 @@ namespace xal
 
 	static size_t _dataRead(void* data, size_t size, size_t count, void* dataSource)
 	{
-		hsbase* stream = (hsbase*)dataSource;
-		return stream->readRaw(data, (int)(size * count));
+		return ((Source*)dataSource)->_readRaw(data, (int)(size * count));
 	}
 
 	static int _dataSeek(void* dataSource, ogg_int64_t offset, int whence)
@@ -47,7 +47,7 @@ namespace xal
 			mode = hsbase::END;
 			break;
 		}
-		((hsbase*)dataSource)->seek((long)offset, mode);
+		((Source*)dataSource)->_seek((int64_t)offset, mode);
 		return 0;
 	}
 
@@ -58,7 +58,7 @@ namespace xal
 
 	static long _dataTell(void* dataSource)
 	{
-		return (long)((hsbase*)dataSource)->position();
+		return (long)((Source*)dataSource)->_position();
 	}
 
 	OGG_Source::OGG_Source(chstr filename, SourceMode sourceMode, BufferMode bufferMode) : Source(filename, sourceMode, bufferMode)
@@ -83,12 +83,12 @@ namespace xal
 		callbacks.seek_func = &_dataSeek;
 		callbacks.close_func = &_dataClose; // may not be NULL because it may crash on Android otherwise
 		callbacks.tell_func = &_dataTell;
-		if (ov_open_callbacks((void*)this->stream, &this->oggStream, NULL, 0, callbacks) == 0)
+		if (ov_open_callbacks((void*)this, &this->oggStream, NULL, 0, callbacks) == 0)
 		{
 			vorbis_info* info = ov_info(&this->oggStream, -1);
 			this->channels = (int)info->channels;
 			this->samplingRate = (int)info->rate;
-			this->bitsPerSample = 16; // always 16 bit data
+			this->bitsPerSample = (this->floatOutput ? 32 : 16);
 			int logicalSamples = (int)ov_pcm_total(&this->oggStream, -1);
 			this->size = logicalSamples * this->channels * this->bitsPerSample / 8;
 			this->duration = (float)logicalSamples / this->samplingRate;
@@ -119,53 +119,128 @@ namespace xal
 		}
 	}
 
+	bool OGG_Source::seek(int64_t sample)
+	{
+		return (this->streamOpen && ov_pcm_seek(&this->oggStream, sample) == 0);
+	}
+
 	bool OGG_Source::load(hstream& output)
 	{
 		if (!Source::load(output))
 		{
 			return false;
 		}
-		unsigned long remaining = this->size;
-		output.prepareManualWriteRaw((int)remaining);
+		output.prepareManualWriteRaw(this->size);
+		unsigned char* buffer = (unsigned char*)output;
+		int read = this->loadChunkRaw(buffer, this->size);
+		if (read < this->size)
+		{
+			memset(&buffer[read], 0, (this->size - read) * sizeof(unsigned char));
+		}
+		return true;
+	}
+
+	int OGG_Source::loadChunk(hstream& output, int size)
+	{
+		if (Source::loadChunk(output, size) == 0)
+		{
+			return 0;
+		}
+		output.prepareManualWriteRaw(size);
+		int result = this->loadChunkRaw((unsigned char*)output, size);
+		output.truncate((int64_t)result); // if there wasn't enough data to fill the entire ouput buffer
+		return result;
+	}
+
+	int OGG_Source::loadChunkRaw(unsigned char* output, int size)
+	{
+		if (!this->_checkStreamOpen())
+		{
+			return 0;
+		}
+		if (this->floatOutput)
+		{
+			int frameSize = this->channels * sizeof(float);
+			return (this->_readFloat((float*)output, size / frameSize) * frameSize);
+		}
+		int remaining = size;
 		char* buffer = (char*)output;
 		int read = 0;
 		while (remaining > 0)
 		{
-			read = (int)ov_read(&this->oggStream, buffer, (int)remaining, 0, 2, 1, &_section);
+			read = (int)ov_read(&this->oggStream, buffer, remaining, 0, 2, 1, &_section);
 			if (read == 0)
 			{
-				memset(buffer, 0, remaining);
 				break;
 			}
 			remaining -= read;
 			buffer += read;
 		}
-		return true;
+		return (size - remaining);
 	}
 
-	int OGG_Source::loadChunk(hstream& output, int size)
+	int OGG_Source::loadChunkPlanar(float** output, int frames)
 	{
-		if (Source::loadChunk(output, size) == 0)
+		if (Source::loadChunkPlanar(output, frames) == 0)
 		{
 			return 0;
 		}
-		int remaining = size;
-		output.prepareManualWriteRaw(remaining);
-		char* buffer = (char*)output;
+		float** pcm = NULL;
+		int remaining = frames;
 		int read = 0;
 		while (remaining > 0)
 		{
-			read = (int)ov_read(&this->oggStream, buffer, remaining, 0, 2, 1, &_section);
-			if (read == 0)
+			read = (int)ov_read_float(&this->oggStream, &pcm, remaining, &_section);
+			if (read == OV_HOLE) // a gap in the data, decoding can continue after it
+			{
+				continue;
+			}
+			if (read <= 0)
 			{
 				break;
 			}
+			for_iter (i, 0, this->channels)
+			{
+				memcpy(&output[i][frames - remaining], pcm[i], read * sizeof(float));
+			}
 			remaining -= read;
-			buffer += read;
 		}
-		int result = (size - remaining);
-		output.truncate((int64_t)result); // if there wasn't enough data to fill the entire ouput buffer
-		return result;
+		return (frames - remaining);
+	}
+
+	bool OGG_Source::_isFloatOutputSupported()
+	{
+		return true;
+	}
+
+	int OGG_Source::_readFloat(float* output, int frames)
+	{
+		float** pcm = NULL;
+		int remaining = frames;
+		int read = 0;
+		while (remaining > 0)
+		{
+			// libvorbis decodes to float internally so its output is only interleaved and not quantized
+			read = (int)ov_read_float(&this->oggStream, &pcm, remaining, &_section);
+			if (read == OV_HOLE) // a gap in the data, decoding can continue after it
+			{
+				continue;
+			}
+			if (read <= 0)
+			{
+				break;
+			}
+			for_iter (i, 0, read)
+			{
+				for_iter (j, 0, this->channels)
+				{
+					*output = pcm[j][i];
+					++output;
+				}
+			}
+			remaining -= read;
+		}
+		return (frames - remaining);
 	}
 
 }
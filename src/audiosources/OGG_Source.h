@@ -33,12 +33,23 @@ namespace xal
 		bool open();
 		void close();
 		void rewind();
+		bool seek(int64_t sample);
 		bool load(hstream& output);
 		int loadChunk(hstream& output, int size = STREAM_BUFFER_SIZE);
+		int loadChunkRaw(unsigned char* output, int size);
+		int loadChunkPlanar(float** output, int frames);
+
+		bool _isFloatOutputSupported();
 
 	protected:
 		OggVorbis_File oggStream;
 
+		/// @brief Decodes interleaved float samples.
+		/// @param[out] output Memory where the samples will be stored. Has to be large enough for frames sample frames.
+		/// @param[in] frames Maximum number of sample frames to decode.
+		/// @return Number of sample frames decoded.
+		int _readFloat(float* output, int frames);
+
 	};
 
 }
@@ -0,0 +1,189 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+
+#ifdef _FORMAT_OGG_TREMOR
+#include <stdio.h>
+#include <string.h>
+#ifdef _FORMAT_OGG // the symbols are renamed so they don't collide with libvorbis
+#include "tremor_prefix.h"
+#endif
+#include <ogg/ogg.h>
+#include <ivorbiscodec.h>
+#include <ivorbisfile.h>
+
+#include <hltypes/hlog.h>
+#include <hltypes/hltypesUtil.h>
+#include <hltypes/hstream.h>
+
+#include "AudioManager.h"
+#include "OGG_Tremor_Source.h"
+#include "xal.h"
+
+#define OGG_FILE ((OggVorbis_File*)this->oggStream)
+
+namespace xal
+{
+	// small optimization, it's not thread-safe, but since it's not used anywhere, it doesn't matter
+	static int _section = 0;
+
+	static size_t _dataRead(void* data, size_t size, size_t count, void* dataSource)
+	{
+		return ((Source*)dataSource)->_readRaw(data, (int)(size * count));
+	}
+
+	static int _dataSeek(void* dataSource, ogg_int64_t offset, int whence)
+	{
+		hsbase::SeekMode mode = hsbase::CURRENT;
+		switch (whence)
+		{
+		case SEEK_CUR:
+			mode = hsbase::CURRENT;
+			break;
+		case SEEK_SET:
+			mode = hsbase::START;
+			break;
+		case SEEK_END:
+			mode = hsbase::END;
+			break;
+		}
+		((Source*)dataSource)->_seek((int64_t)offset, mode);
+		return 0;
+	}
+
+	static int _dataClose(void* dataSource) // an empty function is required on Android as it may crash otherwise
+	{
+		return 0;
+	}
+
+	static long _dataTell(void* dataSource)
+	{
+		return (long)((Source*)dataSource)->_position();
+	}
+
+	OGG_Tremor_Source::OGG_Tremor_Source(chstr filename, SourceMode sourceMode, BufferMode bufferMode) : Source(filename, sourceMode, bufferMode)
+	{
+		this->oggStream = new OggVorbis_File();
+	}
+
+	OGG_Tremor_Source::~OGG_Tremor_Source()
+	{
+		this->close();
+		delete OGG_FILE;
+	}
+
+	bool OGG_Tremor_Source::open()
+	{
+		Source::open();
+		if (!this->streamOpen)
+		{
+			return false;
+		}
+		// setting the special callbacks
+		ov_callbacks callbacks;
+		callbacks.read_func = &_dataRead;
+		callbacks.seek_func = &_dataSeek;
+		callbacks.close_func = &_dataClose; // may not be NULL because it may crash on Android otherwise
+		callbacks.tell_func = &_dataTell;
+		if (ov_open_callbacks((void*)this, OGG_FILE, NULL, 0, callbacks) == 0)
+		{
+			vorbis_info* info = ov_info(OGG_FILE, -1);
+			this->channels = (int)info->channels;
+			this->samplingRate = (int)info->rate;
+			this->bitsPerSample = 16; // always 16 bit data
+			int logicalSamples = (int)ov_pcm_total(OGG_FILE, -1);
+			this->size = logicalSamples * this->channels * this->bitsPerSample / 8;
+			this->duration = (float)logicalSamples / this->samplingRate;
+			ov_pcm_seek(OGG_FILE, 0); // make sure the PCM stream is at the beginning to avoid nasty surprises
+		}
+		else
+		{
+			hlog::error(logTag, "OGG: error reading data!");
+			this->close();
+		}
+		return this->streamOpen;
+	}
+
+	void OGG_Tremor_Source::close()
+	{
+		if (this->streamOpen)
+		{
+			ov_clear(OGG_FILE);
+		}
+		Source::close();
+	}
+
+	void OGG_Tremor_Source::rewind()
+	{
+		if (this->streamOpen)
+		{
+			ov_pcm_seek(OGG_FILE, 0);
+		}
+	}
+
+	bool OGG_Tremor_Source::seek(int64_t sample)
+	{
+		return (this->streamOpen && ov_pcm_seek(OGG_FILE, sample) == 0);
+	}
+
+	bool OGG_Tremor_Source::load(hstream& output)
+	{
+		if (!Source::load(output))
+		{
+			return false;
+		}
+		output.prepareManualWriteRaw(this->size);
+		unsigned char* buffer = (unsigned char*)output;
+		int read = this->loadChunkRaw(buffer, this->size);
+		if (read < this->size)
+		{
+			memset(&buffer[read], 0, (this->size - read) * sizeof(unsigned char));
+		}
+		return true;
+	}
+
+	int OGG_Tremor_Source::loadChunk(hstream& output, int size)
+	{
+		if (Source::loadChunk(output, size) == 0)
+		{
+			return 0;
+		}
+		output.prepareManualWriteRaw(size);
+		int result = this->loadChunkRaw((unsigned char*)output, size);
+		output.truncate((int64_t)result); // if there wasn't enough data to fill the entire ouput buffer
+		return result;
+	}
+
+	int OGG_Tremor_Source::loadChunkRaw(unsigned char* output, int size)
+	{
+		if (!this->_checkStreamOpen())
+		{
+			return 0;
+		}
+		int remaining = size;
+		char* buffer = (char*)output;
+		int read = 0;
+		while (remaining > 0)
+		{
+			// Tremor always decodes to signed 16 bit data in native byte order
+			read = (int)ov_read(OGG_FILE, buffer, remaining, &_section);
+			if (read == OV_HOLE) // a gap in the data, decoding can continue after it
+			{
+				continue;
+			}
+			if (read <= 0)
+			{
+				break;
+			}
+			remaining -= read;
+			buffer += read;
+		}
+		return (size - remaining);
+	}
+
+}
+#endif
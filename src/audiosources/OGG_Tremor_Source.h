@@ -0,0 +1,51 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Provides a source for OGG format that decodes with Tremor.
+
+#ifdef _FORMAT_OGG_TREMOR
+#ifndef XAL_OGG_TREMOR_SOURCE_H
+#define XAL_OGG_TREMOR_SOURCE_H
+
+#include <hltypes/hstring.h>
+
+#include "AudioManager.h"
+#include "Source.h"
+#include "xalExport.h"
+
+namespace xal
+{
+	/// @brief Decodes Ogg Vorbis files with Tremor's fixed-point decoder.
+	/// @note If _FORMAT_OGG is used as well, Tremor has to be compiled with tremor_prefix.h so it can be linked together with libvorbis.
+	class xalExport OGG_Tremor_Source : public Source
+	{
+	public:
+		OGG_Tremor_Source(chstr filename, SourceMode sourceMode, BufferMode bufferMode);
+		~OGG_Tremor_Source();
+
+		bool open();
+		void close();
+		void rewind();
+		bool seek(int64_t sample);
+		bool load(hstream& output);
+		int loadChunk(hstream& output, int size = STREAM_BUFFER_SIZE);
+		int loadChunkRaw(unsigned char* output, int size);
+
+	protected:
+		/// @brief Tremor's file state.
+		/// @note Tremor's headers define the same type names as libvorbis' headers so they can't be used here.
+		void* oggStream;
+
+	};
+
+}
+
+#endif
+#endif
@@ -7,25 +7,181 @@
 /// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
 
 #ifdef _FORMAT_SPX
+#include <string.h>
+#include <ogg/ogg.h>
 #include <speex/speex.h>
+#include <speex/speex_callbacks.h>
+#include <speex/speex_header.h>
+#include <speex/speex_stereo.h>
 
+#include <hltypes/hlog.h>
 #include <hltypes/hltypesUtil.h>
+#include <hltypes/hstream.h>
 #include <hltypes/hstring.h>
 
+#include "AudioManager.h"
 #include "SPX_Source.h"
 #include "xal.h"
 
-#define FRAME_SIZE 640
+#define SPX_READ_SIZE 4096 // how much file data is passed to the Ogg layer at once
+#define SPX_TAIL_SIZE 131072 // how much of the file's end is searched for the last page, more than the maximum Ogg page size
 
 namespace xal
 {
-	SPX_Source::SPX_Source(chstr filename, SourceMode sourceMode, BufferMode bufferMode) : Source(filename, sourceMode, bufferMode)
+	SPX_Source::SPX_Source(chstr filename, SourceMode sourceMode, BufferMode bufferMode) : Source(filename, sourceMode, bufferMode), oggOpen(false),
+		decoder(NULL), decoderModeId(-1), stereo(NULL), frameSize(0), framesPerPacket(1), headerPackets(2), lookahead(0), encoderDelay(0), totalSamples(0),
+		remainingSamples(0), skipSamples(0), packetCount(0), packetFrames(0), frame(NULL), frameLength(0), framePosition(0)
 	{
+		speex_bits_init(&this->bits);
 	}
 
 	SPX_Source::~SPX_Source()
 	{
 		this->close();
+		if (this->decoder != NULL)
+		{
+			speex_decoder_destroy(this->decoder);
+		}
+		if (this->stereo != NULL)
+		{
+			speex_stereo_state_destroy(this->stereo);
+		}
+		speex_bits_destroy(&this->bits);
+		if (this->frame != NULL)
+		{
+			delete[] this->frame;
+		}
+	}
+
+	bool SPX_Source::open()
+	{
+		Source::open();
+		if (!this->streamOpen)
+		{
+			return false;
+		}
+		// data will be reloaded, clearing it here
+		this->channels = 0;
+		this->samplingRate = 0;
+		this->size = 0;
+		this->duration = 0.0f;
+		ogg_sync_init(&this->oggSync);
+		ogg_stream_init(&this->oggStream, 0);
+		this->oggOpen = true;
+		ogg_page page;
+		ogg_packet packet;
+		int serial = 0;
+		SpeexHeader* header = NULL;
+		if (this->_readPage(&page))
+		{
+			serial = ogg_page_serialno(&page);
+			ogg_stream_reset_serialno(&this->oggStream, serial);
+			ogg_stream_pagein(&this->oggStream, &page);
+			if (this->_readPacket(&packet))
+			{
+				header = speex_packet_to_header((char*)packet.packet, (int)packet.bytes);
+			}
+		}
+		if (header == NULL)
+		{
+			hlog::error(logTag, "SPX: error reading header: " + this->filename);
+			this->close();
+			return false;
+		}
+		int modeId = header->mode;
+		this->channels = header->nb_channels;
+		this->samplingRate = header->rate;
+		this->framesPerPacket = hmax(header->frames_per_packet, 1);
+		this->headerPackets = 2 + header->extra_headers; // the header itself, comments and extra headers
+		speex_header_free(header);
+		if (modeId < 0 || modeId >= SPEEX_NB_MODES || this->channels < 1 || this->channels > 2 || this->samplingRate <= 0)
+		{
+			hlog::error(logTag, "SPX: unsupported format: " + this->filename);
+			this->close();
+			return false;
+		}
+		this->decoderModeId = modeId;
+		this->_createDecoder(); // the frame size is needed to find the encoder's delay
+		this->bitsPerSample = 16; // always 16 bit data
+		this->encoderDelay = this->_findEncoderDelay(&page);
+		this->totalSamples = this->_findTotalSamples(serial);
+		if (this->totalSamples <= 0 || this->totalSamples * this->channels * 2 > 0x7FFFFFFF)
+		{
+			hlog::error(logTag, "SPX: unknown or unsupported length: " + this->filename);
+			this->close();
+			return false;
+		}
+		this->size = (int)(this->totalSamples * this->channels * this->bitsPerSample / 8);
+		this->duration = (float)this->totalSamples / this->samplingRate;
+		this->rewind();
+		return this->streamOpen;
+	}
+
+	void SPX_Source::close()
+	{
+		if (this->oggOpen)
+		{
+			ogg_stream_clear(&this->oggStream);
+			ogg_sync_clear(&this->oggSync);
+			this->oggOpen = false;
+		}
+		Source::close();
+	}
+
+	void SPX_Source::rewind()
+	{
+		if (this->streamOpen)
+		{
+			this->_seek(0, hsbase::START);
+			ogg_sync_reset(&this->oggSync);
+			ogg_stream_reset(&this->oggStream);
+			// SPEEX_RESET_STATE doesn't reset everything in libspeex so the first frames would differ from the previous pass
+			this->_createDecoder();
+			this->packetCount = 0;
+			this->packetFrames = 0;
+			this->frameLength = 0;
+			this->framePosition = 0;
+			this->skipSamples = this->lookahead + this->encoderDelay;
+			this->remainingSamples = this->totalSamples;
+		}
+	}
+
+	void SPX_Source::_createDecoder()
+	{
+		if (this->decoder != NULL)
+		{
+			speex_decoder_destroy(this->decoder);
+		}
+		this->decoder = speex_decoder_init(speex_lib_get_mode(this->decoderModeId));
+		int enhancement = 1;
+		speex_decoder_ctl(this->decoder, SPEEX_SET_ENH, &enhancement);
+		if (this->stereo == NULL)
+		{
+			this->stereo = speex_stereo_state_init();
+		}
+		else
+		{
+			speex_stereo_state_reset(this->stereo);
+		}
+		// stereo data is sent in-band and handled by the stereo state
+		SpeexCallback callback;
+		callback.callback_id = SPEEX_INBAND_STEREO;
+		callback.func = speex_std_stereo_request_handler;
+		callback.data = this->stereo;
+		speex_decoder_ctl(this->decoder, SPEEX_SET_HANDLER, &callback);
+		speex_decoder_ctl(this->decoder, SPEEX_SET_SAMPLING_RATE, &this->samplingRate);
+		int frameSize = 0;
+		speex_decoder_ctl(this->decoder, SPEEX_GET_FRAME_SIZE, &frameSize);
+		speex_decoder_ctl(this->decoder, SPEEX_GET_LOOKAHEAD, &this->lookahead);
+		if (this->frame == NULL || frameSize != this->frameSize)
+		{
+			if (this->frame != NULL)
+			{
+				delete[] this->frame;
+			}
+			this->frame = new short[frameSize * 2]; // stereo is decoded in-place
+			this->frameSize = frameSize;
+		}
 	}
 
 	bool SPX_Source::load(hstream& output)
@@ -34,62 +190,189 @@ namespace xal
 		{
 			return false;
 		}
-		/*
-		float output2[FRAME_SIZE];
-		char cbits[200];
-		unsigned short nbBytes;
-		void* state;
-		SpeexBits bits;
-		int i, tmp;
-		state = speex_decoder_init(&speex_uwb_mode);
-		tmp = 1;
-		speex_decoder_ctl(state, SPEEX_SET_ENH, &tmp);
-
-		int size;
-		unsigned char* stream = output;
-
-		//fin = fopen(this->fileName.cStr(), "rb");
-		int offset = 0;
-		memcpy(&size, &output[offset], sizeof(int));
-		offset += sizeof(int);
-		short* buffer = (short*)malloc((FRAME_SIZE + size) * 2 * sizeof(short));
-		short* bufferPtr = buffer;
-
-		speex_bits_init(&bits);
-		int nFrames = 0;
-		while (true)
+		output.prepareManualWriteRaw(this->size);
+		unsigned char* buffer = (unsigned char*)output;
+		int read = this->loadChunkRaw(buffer, this->size);
+		if (read < this->size)
+		{
+			memset(&buffer[read], 0, (this->size - read) * sizeof(unsigned char));
+		}
+		return true;
+	}
+
+	int SPX_Source::loadChunk(hstream& output, int size)
+	{
+		if (Source::loadChunk(output, size) == 0)
+		{
+			return 0;
+		}
+		output.prepareManualWriteRaw(size);
+		int result = this->loadChunkRaw((unsigned char*)output, size);
+		output.truncate((int64_t)result); // if there wasn't enough data to fill the entire ouput buffer
+		return result;
+	}
+
+	int SPX_Source::loadChunkRaw(unsigned char* output, int size)
+	{
+		if (!this->_checkStreamOpen())
+		{
+			return 0;
+		}
+		int sampleSize = this->channels * this->bitsPerSample / 8;
+		int written = 0;
+		int count = 0;
+		while (size - written >= sampleSize)
 		{
-			memcpy(&nbBytes, &output[offset], sizeof(unsigned short));
-			offset += sizeof(unsigned short);
-			//fread(&nbBytes, sizeof(unsigned short), 1, fin);
-			//  fprintf (stderr, "nbBytes: %d\n", nbBytes);
-			if (offset >= this->size)
+			if (this->framePosition >= this->frameLength && !this->_decodeFrame())
 			{
 				break;
 			}
+			count = hmin(this->frameLength - this->framePosition, (size - written) / sampleSize);
+			memcpy(&output[written], &this->frame[this->framePosition * this->channels], count * sampleSize);
+			this->framePosition += count;
+			written += count * sampleSize;
+		}
+		return written;
+	}
 
-			memcpy(cbits, &output[offset], nbBytes);
-			offset += nbBytes;
-			speex_bits_read_from(&bits, cbits, nbBytes);
+	bool SPX_Source::_readPage(ogg_page* page)
+	{
+		char* buffer = NULL;
+		int read = 0;
+		while (ogg_sync_pageout(&this->oggSync, page) != 1)
+		{
+			// libogg keeps reusing its buffer once it's large enough
+			buffer = ogg_sync_buffer(&this->oggSync, SPX_READ_SIZE);
+			read = this->_readRaw(buffer, SPX_READ_SIZE);
+			if (read <= 0)
+			{
+				return false;
+			}
+			ogg_sync_wrote(&this->oggSync, read);
+		}
+		return true;
+	}
+
+	bool SPX_Source::_readPacket(ogg_packet* packet)
+	{
+		ogg_page page;
+		int result = 0;
+		while (true)
+		{
+			result = ogg_stream_packetout(&this->oggStream, packet);
+			if (result == 1)
+			{
+				return true;
+			}
+			// a result of -1 means that data was lost and the next packet can simply be used
+			if (result == 0)
+			{
+				if (!this->_readPage(&page))
+				{
+					return false;
+				}
+				ogg_stream_pagein(&this->oggStream, &page); // pages of other logical streams are rejected
+			}
+		}
+	}
 
-			speex_decode(state, &bits, output2);
+	int64_t SPX_Source::_findTotalSamples(int serial)
+	{
+		this->_seek(0, hsbase::END);
+		int64_t fileSize = this->_position();
+		int64_t offset = hmax(fileSize - SPX_TAIL_SIZE, (int64_t)0);
+		this->_seek(offset, hsbase::START);
+		ogg_sync_state sync;
+		ogg_sync_init(&sync);
+		char* buffer = ogg_sync_buffer(&sync, (long)(fileSize - offset));
+		ogg_sync_wrote(&sync, this->_readRaw(buffer, (int)(fileSize - offset)));
+		ogg_page page;
+		int64_t result = 0;
+		int status = 0;
+		// the granule position of the last page is the number of samples, -1 means that no packet ends on that page
+		while ((status = ogg_sync_pageout(&sync, &page)) != 0)
+		{
+			if (status == 1 && ogg_page_serialno(&page) == serial && ogg_page_granulepos(&page) >= 0)
+			{
+				result = (int64_t)ogg_page_granulepos(&page);
+			}
+		}
+		ogg_sync_clear(&sync);
+		return result;
+	}
 
-			for_iterx (i, 0, FRAME_SIZE)
+	int SPX_Source::_findEncoderDelay(ogg_page* page)
+	{
+		int serial = ogg_page_serialno(page);
+		int packets = ogg_page_packets(page);
+		// the granule position is -1 on pages where no packet ends
+		while (packets <= this->headerPackets || ogg_page_granulepos(page) < 0 || ogg_page_serialno(page) != serial)
+		{
+			if (!this->_readPage(page))
+			{
+				return 0;
+			}
+			if (ogg_page_serialno(page) == serial)
 			{
-				bufferPtr[i] = (short)output2[i];
+				packets += ogg_page_packets(page);
 			}
-			++nFrames;
 		}
+		// the granule position doesn't include the samples that only make up for the encoder's delay
+		int64_t decoded = (int64_t)(packets - this->headerPackets) * this->framesPerPacket * this->frameSize;
+		return (int)hclamp(decoded - (int64_t)ogg_page_granulepos(page), (int64_t)0, decoded);
+	}
 
-		//printf("read %d speex frames\n",nFrames);
-		speex_decoder_destroy(state);
-		speex_bits_destroy(&bits);
-		//alBufferData(this->buffer, AL_FORMAT_MONO16, buffer, size * 2, 44100);
-		this->duration = (float)size / 44100;
-		free(buffer);
-		// REFACTOR TO HERE
-		//*/
-		return true;
+	bool SPX_Source::_decodeFrame()
+	{
+		ogg_packet packet;
+		int result = 0;
+		while (this->remainingSamples > 0)
+		{
+			if (this->packetFrames == 0)
+			{
+				if (!this->_readPacket(&packet))
+				{
+					return false;
+				}
+				++this->packetCount;
+				if (this->packetCount <= this->headerPackets)
+				{
+					continue;
+				}
+				speex_bits_read_from(&this->bits, (char*)packet.packet, (int)packet.bytes);
+				this->packetFrames = this->framesPerPacket;
+			}
+			--this->packetFrames;
+			result = speex_decode_int(this->decoder, &this->bits, this->frame);
+			// the end of the stream or corrupted data, the rest of the packet is skipped
+			if (result < 0 || speex_bits_remaining(&this->bits) < 0)
+			{
+				this->packetFrames = 0;
+				continue;
+			}
+			if (this->channels == 2)
+			{
+				speex_decode_stereo_int(this->frame, this->frameSize, this->stereo);
+			}
+			this->frameLength = this->frameSize;
+			this->framePosition = 0;
+			// the first decoded samples are only the decoder's delay
+			if (this->skipSamples > 0)
+			{
+				this->framePosition = hmin(this->skipSamples, this->frameLength);
+				this->skipSamples -= this->framePosition;
+			}
+			if (this->frameLength - this->framePosition > this->remainingSamples)
+			{
+				this->frameLength = this->framePosition + (int)this->remainingSamples;
+			}
+			this->remainingSamples -= this->frameLength - this->framePosition;
+			if (this->framePosition < this->frameLength)
+			{
+				return true;
+			}
+		}
+		return false;
 	}
 
 }
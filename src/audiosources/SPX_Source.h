@@ -8,26 +8,103 @@
 /// 
 /// @section DESCRIPTION
 /// 
-/// Provides a source for OGG format.
+/// Provides a source for Ogg Speex format.
 
 #ifdef _FORMAT_SPX
 #ifndef XAL_SPX_SOURCE_H
 #define XAL_SPX_SOURCE_H
 
+#include <stdint.h>
+#include <ogg/ogg.h>
+#include <speex/speex.h>
+#include <speex/speex_stereo.h>
+
 #include <hltypes/hstring.h>
 
+#include "AudioManager.h"
 #include "Source.h"
 #include "xalExport.h"
 
 namespace xal
 {
+	/// @brief Decodes Ogg-encapsulated Speex files frame by frame.
+	/// @note The decoder is created again whenever the Source is rewound so every pass decodes exactly the same data.
 	class xalExport SPX_Source : public Source
 	{
 	public:
 		SPX_Source(chstr filename, SourceMode sourceMode, BufferMode bufferMode);
 		~SPX_Source();
 
+		bool open();
+		void close();
+		void rewind();
 		bool load(hstream& output);
+		int loadChunk(hstream& output, int size = STREAM_BUFFER_SIZE);
+		int loadChunkRaw(unsigned char* output, int size);
+
+	protected:
+		/// @brief Ogg page synchronization.
+		ogg_sync_state oggSync;
+		/// @brief Ogg logical stream of the Speex data.
+		ogg_stream_state oggStream;
+		/// @brief Whether oggSync and oggStream are initialized.
+		bool oggOpen;
+		/// @brief Speex decoder.
+		void* decoder;
+		/// @brief ID of the Speex mode of the file.
+		int decoderModeId;
+		/// @brief Bit-stream of the current packet.
+		SpeexBits bits;
+		/// @brief Stereo state for decoding intensity stereo.
+		SpeexStereoState* stereo;
+		/// @brief Number of samples per channel in a Speex frame.
+		int frameSize;
+		/// @brief Number of Speex frames in an Ogg packet.
+		int framesPerPacket;
+		/// @brief Number of Ogg packets with headers before the audio data.
+		int headerPackets;
+		/// @brief Number of samples per channel by which the decoder's output is delayed.
+		int lookahead;
+		/// @brief Number of samples per channel that are decoded before the first granule position due to the encoder's delay.
+		int encoderDelay;
+		/// @brief Number of samples per channel in the file.
+		int64_t totalSamples;
+		/// @brief Number of samples per channel that haven't been provided yet.
+		int64_t remainingSamples;
+		/// @brief Number of decoded samples per channel that still have to be skipped due to the encoder's and the decoder's delay.
+		int skipSamples;
+		/// @brief Number of Ogg packets read since the beginning.
+		int packetCount;
+		/// @brief Number of Speex frames in the current packet that haven't been decoded yet.
+		int packetFrames;
+		/// @brief Decoded interleaved samples of the current Speex frame.
+		short* frame;
+		/// @brief Number of samples per channel in frame.
+		int frameLength;
+		/// @brief Number of samples per channel in frame that have already been provided.
+		int framePosition;
+
+		/// @brief Reads the next Ogg page from the file.
+		/// @param[out] page The page.
+		/// @return True if a page was read.
+		bool _readPage(ogg_page* page);
+		/// @brief Reads the next Ogg packet of the Speex stream.
+		/// @param[out] packet The packet.
+		/// @return True if a packet was read.
+		bool _readPacket(ogg_packet* packet);
+		/// @brief Finds the number of samples from the granule position of the last Ogg page.
+		/// @param[in] serial Serial number of the Speex stream.
+		/// @return Number of samples per channel or 0 if it couldn't be found.
+		int64_t _findTotalSamples(int serial);
+		/// @brief Finds the encoder's delay from the granule position of the first Ogg page with audio data.
+		/// @param[in] page The first Ogg page of the Speex stream.
+		/// @return Number of samples per channel.
+		int _findEncoderDelay(ogg_page* page);
+		/// @brief Destroys the current Speex decoder and creates a new one for decoderModeId, resetting the stereo state as well.
+		void _createDecoder();
+		/// @brief Decodes the next Speex frame into frame.
+		/// @return True if a frame was decoded.
+		bool _decodeFrame();
 
 	};
 
@@ -9,15 +9,18 @@
 #ifdef _FORMAT_WAV
 #include <string.h>
 
+#include <hltypes/hltypesUtil.h>
 #include <hltypes/hresource.h>
+#include <hltypes/hstream.h>
 
 #include "AudioManager.h"
+#include "MappedFile.h"
 #include "WAV_Source.h"
 #include "xal.h"
 
 namespace xal
 {
-	WAV_Source::WAV_Source(chstr filename, SourceMode sourceMode, BufferMode bufferMode) : Source(filename, sourceMode, bufferMode)
+	WAV_Source::WAV_Source(chstr filename, SourceMode sourceMode, BufferMode bufferMode) : Source(filename, sourceMode, bufferMode), dataOffset(0)
 	{
 	}
 
@@ -41,40 +44,40 @@ namespace xal
 		this->duration = 0.0f;
 		// data loading
 		unsigned char buffer[5] = {0};
-		this->stream->readRaw(buffer, 4); // RIFF
-		this->stream->readRaw(buffer, 4); // file size
-		this->stream->readRaw(buffer, 4); // WAVE
+		this->_readRaw(buffer, 4); // RIFF
+		this->_readRaw(buffer, 4); // file size
+		this->_readRaw(buffer, 4); // WAVE
 		hstr tag;
 		int size = 0;
 		short value16;
 		int value32;
-		while (!this->stream->eof())
+		while (!this->_eof())
 		{
-			this->stream->readRaw(buffer, 4); // next tag
+			this->_readRaw(buffer, 4); // next tag
 			tag = (char*)buffer;
-			this->stream->readRaw(buffer, 4); // size of the chunk
+			this->_readRaw(buffer, 4); // size of the chunk
 			memcpy(&size, buffer, 4);
 			if (tag == "fmt ")
 			{
 				// format
-				this->stream->readRaw(buffer, 2);
+				this->_readRaw(buffer, 2);
 				memcpy(&value16, buffer, 2);
 				if (size == 16 && value16 == 1)
 				{
 					// channels
-					this->stream->readRaw(buffer, 2);
+					this->_readRaw(buffer, 2);
 					memcpy(&value16, buffer, 2);
 					this->channels = value16;
 					// sampling rate
-					this->stream->readRaw(buffer, 4);
+					this->_readRaw(buffer, 4);
 					memcpy(&value32, buffer, 4);
 					this->samplingRate = value32;
 					// bytes rate
-					this->stream->readRaw(buffer, 4);
+					this->_readRaw(buffer, 4);
 					// blockalign
-					this->stream->readRaw(buffer, 2);
+					this->_readRaw(buffer, 2);
 					// bits per sample
-					this->stream->readRaw(buffer, 2);
+					this->_readRaw(buffer, 2);
 					memcpy(&value16, buffer, 2);
 					this->bitsPerSample = value16;
 					size = 0;
@@ -92,7 +95,7 @@ namespace xal
 			}
 			if (size > 0)
 			{
-				this->stream->seek(size);
+				this->_seek(size);
 			}
 		}
 		this->duration = (float)this->size / (this->samplingRate * this->channels * this->bitsPerSample / 8);
@@ -108,28 +111,40 @@ namespace xal
 		}
 	}
 
+	bool WAV_Source::seek(int64_t sample)
+	{
+		int64_t offset = sample * (this->channels * this->bitsPerSample / 8);
+		if (!this->streamOpen || sample < 0 || offset > this->size)
+		{
+			return false;
+		}
+		this->_seek(this->dataOffset + offset, hsbase::START);
+		return true;
+	}
+
 	void WAV_Source::_findData()
 	{
-		this->stream->rewind();
+		this->_seek(0, hsbase::START);
 		unsigned char buffer[5] = {0};
-		this->stream->readRaw(buffer, 4); // RIFF
-		this->stream->readRaw(buffer, 4); // file size
-		this->stream->readRaw(buffer, 4); // WAVE
+		this->_readRaw(buffer, 4); // RIFF
+		this->_readRaw(buffer, 4); // file size
+		this->_readRaw(buffer, 4); // WAVE
 		hstr tag;
 		int size = 0;
-		while (!this->stream->eof())
+		while (!this->_eof())
 		{
-			this->stream->readRaw(buffer, 4); // next tag
+			this->_readRaw(buffer, 4); // next tag
 			tag = (char*)buffer;
-			this->stream->readRaw(buffer, 4); // size of the chunk
+			this->_readRaw(buffer, 4); // size of the chunk
 			memcpy(&size, buffer, 4);
 			if (tag == "data")
 			{
+				this->dataOffset = (int)this->_position();
 				break;
 			}
 			if (size > 0)
 			{
-				this->stream->seek(size);
+				this->_seek(size);
 			}
 		}
 	}
@@ -140,7 +155,17 @@ namespace xal
 		{
 			return false;
 		}
-		int written = output.writeRaw(*this->stream, this->size);
+		int written = 0;
+		int available = 0;
+		const unsigned char* data = this->_readView(this->size, &available);
+		if (data != NULL)
+		{
+			written = output.writeRaw(data, available);
+		}
+		else
+		{
+			written = output.writeRaw(*this->stream, this->size);
+		}
 		if (written > 0)
 		{
 			output.seek(-written);
@@ -155,7 +180,17 @@ namespace xal
 		{
 			return 0;
 		}
-		int written = output.writeRaw(this->stream, size);
+		int written = 0;
+		int available = 0;
+		const unsigned char* data = this->_readView(size, &available);
+		if (data != NULL)
+		{
+			written = output.writeRaw(data, available);
+		}
+		else
+		{
+			written = output.writeRaw(this->stream, size);
+		}
 		if (written > 0)
 		{
 			output.seek(-written);
@@ -163,5 +198,36 @@ namespace xal
 		return written;
 	}
 
+	int WAV_Source::loadChunkRaw(unsigned char* output, int size)
+	{
+		if (!this->_checkStreamOpen())
+		{
+			return 0;
+		}
+		return this->_readRaw(output, size);
+	}
+
+	const unsigned char* WAV_Source::_getDataView(int* size)
+	{
+		*size = 0;
+		if (!this->streamOpen || this->size == 0)
+		{
+			return NULL;
+		}
+		// only storage that is kept after closing can be shared, DISK mode streams are destroyed in close()
+		if (this->mappedFile != NULL)
+		{
+			*size = hclamp(this->size, 0, this->mappedFile->getSize() - this->dataOffset);
+			return (this->mappedFile->getData() + this->dataOffset);
+		}
+		if (this->sourceMode == RAM || this->sourceMode == MMAP) // MMAP falls back to RAM when the file couldn't be mapped
+		{
+			hstream* ramStream = (hstream*)this->stream;
+			*size = hclamp(this->size, 0, (int)ramStream->size() - this->dataOffset);
+			return ((unsigned char*)(*ramStream) + this->dataOffset);
+		}
+		return NULL;
+	}
+
 }
 #endif
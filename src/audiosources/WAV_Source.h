@@ -31,10 +31,16 @@ namespace xal
 
 		bool open();
 		void rewind();
+		bool seek(int64_t sample);
 		bool load(hstream& output);
 		int loadChunk(hstream& output, int size = STREAM_BUFFER_SIZE);
+		int loadChunkRaw(unsigned char* output, int size);
+
+		const unsigned char* _getDataView(int* size);
 
 	protected:
+		int dataOffset;
+
 		void _findData();
 
 	};
@@ -0,0 +1,113 @@
+/// @file
+/// @version 3.4
+/// 
+/// @section LICENSE
+/// 
+/// This program is free software; you can redistribute it and/or modify it under
+/// the terms of the BSD license: http://opensource.org/licenses/BSD-3-Clause
+/// 
+/// @section DESCRIPTION
+/// 
+/// Renames all of Tremor's global symbols and public types so Tremor can be linked into the same binary as libvorbis. When both
+/// _FORMAT_OGG and _FORMAT_OGG_TREMOR are used, Tremor itself has to be compiled with this file as a forced include (e.g.
+/// "-include tremor_prefix.h" or "/FI tremor_prefix.h"). A Tremor-only build doesn't need it.
+
+#ifndef XAL_TREMOR_PREFIX_H
+#define XAL_TREMOR_PREFIX_H
+
+// functions and data
+#define _book_maptype1_quantvals tremor_book_maptype1_quantvals
+#define _book_unquantize tremor_book_unquantize
+#define _floor_P tremor_floor_P
+#define _ilog tremor_ilog
+#define _make_words tremor_make_words
+#define _mapping_P tremor_mapping_P
+#define _residue_P tremor_residue_P
+#define _vorbis_apply_window tremor_vorbis_apply_window
+#define _vorbis_block_alloc tremor_vorbis_block_alloc
+#define _vorbis_block_ripcord tremor_vorbis_block_ripcord
+#define _vorbis_window tremor_vorbis_window
+#define floor0_exportbundle tremor_floor0_exportbundle
+#define floor1_exportbundle tremor_floor1_exportbundle
+#define mapping0_exportbundle tremor_mapping0_exportbundle
+#define mdct_backward tremor_mdct_backward
+#define ov_bitrate tremor_ov_bitrate
+#define ov_bitrate_instant tremor_ov_bitrate_instant
+#define ov_clear tremor_ov_clear
+#define ov_comment tremor_ov_comment
+#define ov_fopen tremor_ov_fopen
+#define ov_info tremor_ov_info
+#define ov_open tremor_ov_open
+#define ov_open_callbacks tremor_ov_open_callbacks
+#define ov_pcm_seek tremor_ov_pcm_seek
+#define ov_pcm_seek_page tremor_ov_pcm_seek_page
+#define ov_pcm_tell tremor_ov_pcm_tell
+#define ov_pcm_total tremor_ov_pcm_total
+#define ov_raw_seek tremor_ov_raw_seek
+#define ov_raw_tell tremor_ov_raw_tell
+#define ov_raw_total tremor_ov_raw_total
+#define ov_read tremor_ov_read
+#define ov_seekable tremor_ov_seekable
+#define ov_serialnumber tremor_ov_serialnumber
+#define ov_streams tremor_ov_streams
+#define ov_test tremor_ov_test
+#define ov_test_callbacks tremor_ov_test_callbacks
+#define ov_test_open tremor_ov_test_open
+#define ov_time_seek tremor_ov_time_seek
+#define ov_time_seek_page tremor_ov_time_seek_page
+#define ov_time_tell tremor_ov_time_tell
+#define ov_time_total tremor_ov_time_total
+#define res0_free_info tremor_res0_free_info
+#define res0_free_look tremor_res0_free_look
+#define res0_inverse tremor_res0_inverse
+#define res0_look tremor_res0_look
+#define res0_unpack tremor_res0_unpack
+#define res1_inverse tremor_res1_inverse
+#define res2_inverse tremor_res2_inverse
+#define rescale64 tremor_rescale64
+#define residue0_exportbundle tremor_residue0_exportbundle
+#define residue1_exportbundle tremor_residue1_exportbundle
+#define residue2_exportbundle tremor_residue2_exportbundle
+#define vorbis_block_clear tremor_vorbis_block_clear
+#define vorbis_block_init tremor_vorbis_block_init
+#define vorbis_book_clear tremor_vorbis_book_clear
+#define vorbis_book_decode tremor_vorbis_book_decode
+#define vorbis_book_decodev_add tremor_vorbis_book_decodev_add
+#define vorbis_book_decodev_set tremor_vorbis_book_decodev_set
+#define vorbis_book_decodevs_add tremor_vorbis_book_decodevs_add
+#define vorbis_book_decodevv_add tremor_vorbis_book_decodevv_add
+#define vorbis_book_init_decode tremor_vorbis_book_init_decode
+#define vorbis_comment_clear tremor_vorbis_comment_clear
+#define vorbis_comment_init tremor_vorbis_comment_init
+#define vorbis_comment_query tremor_vorbis_comment_query
+#define vorbis_comment_query_count tremor_vorbis_comment_query_count
+#define vorbis_dsp_clear tremor_vorbis_dsp_clear
+#define vorbis_granule_time tremor_vorbis_granule_time
+#define vorbis_info_blocksize tremor_vorbis_info_blocksize
+#define vorbis_info_clear tremor_vorbis_info_clear
+#define vorbis_info_init tremor_vorbis_info_init
+#define vorbis_lsp_to_curve tremor_vorbis_lsp_to_curve
+#define vorbis_packet_blocksize tremor_vorbis_packet_blocksize
+#define vorbis_staticbook_destroy tremor_vorbis_staticbook_destroy
+#define vorbis_staticbook_unpack tremor_vorbis_staticbook_unpack
+#define vorbis_synthesis tremor_vorbis_synthesis
+#define vorbis_synthesis_blockin tremor_vorbis_synthesis_blockin
+#define vorbis_synthesis_headerin tremor_vorbis_synthesis_headerin
+#define vorbis_synthesis_idheader tremor_vorbis_synthesis_idheader
+#define vorbis_synthesis_init tremor_vorbis_synthesis_init
+#define vorbis_synthesis_pcmout tremor_vorbis_synthesis_pcmout
+#define vorbis_synthesis_read tremor_vorbis_synthesis_read
+#define vorbis_synthesis_restart tremor_vorbis_synthesis_restart
+#define vorbis_synthesis_trackonly tremor_vorbis_synthesis_trackonly
+#define vorbis_version_string tremor_vorbis_version_string
+
+// types
+#define OggVorbis_File tremor_OggVorbis_File
+#define alloc_chain tremor_alloc_chain
+#define ov_callbacks tremor_ov_callbacks
+#define vorbis_block tremor_vorbis_block
+#define vorbis_comment tremor_vorbis_comment
+#define vorbis_dsp_state tremor_vorbis_dsp_state
+#define vorbis_info tremor_vorbis_info
+
+#endif
@@ -39,6 +39,7 @@ namespace xal
 		unsigned int _systemGetBufferPosition();
 		float _systemGetOffset();
 		void _systemSetOffset(float value);
+		float _systemTimeToOffset(float time);
 		bool _systemPreparePlay();
 		void _systemPrepareBuffer();
 		void _systemUpdateGain();
@@ -49,7 +50,7 @@ namespace xal
 
 		int _getProcessedBuffersCount();
 		int _fillBuffers(int index, int count);
-		void _copyBuffer(hstream& stream, int size, int count = 1);
+		void _copyBuffer(const unsigned char* data, int size, int count = 1);
 		void _copySilence(int size, int count = 1);
 
 	};
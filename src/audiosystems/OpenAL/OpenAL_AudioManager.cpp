@@ -49,6 +49,9 @@ bool hasiOSAudioSessionRestoreFailed();
 static bool gAudioSuspended = false; // iOS specific hack as well
 #endif
 
+#define OPENAL_DEFAULT_SOURCE_COUNT 32 // used when the device doesn't report its limits
+#define OPENAL_MAX_SOURCE_COUNT 256
+
 #define _CASE_STRING(x) case x: return #x;
 
 static hstr alGetErrorString(ALenum error)
@@ -92,12 +95,14 @@ namespace xal
 		__openal__JNI_OnLoad(backendId);
 #endif
 		this->numActiveSources = 0;
+		this->sourceExhaustionCount = 0;
 		this->initOpenAL();
 	}
 
 	OpenAL_AudioManager::~OpenAL_AudioManager()
 	{
 		hlog::write(logTag, "Destroying OpenAL.");
+		this->_destroySharedBuffers();
 		destroyOpenAL();
 	}
 	
@@ -136,6 +141,7 @@ namespace xal
 		this->device = currentDevice;
 		this->context = currentContext;
 		this->enabled = true;
+		this->_createSourcePool();
 #ifdef _IOS
 		this->pendingResume = false;
 		OpenAL_iOS_init();
@@ -147,6 +153,7 @@ namespace xal
 #ifdef _IOS // you can't touch this, there may be dragons
 		OpenAL_iOS_destroy();
 #endif
+		this->_destroySourcePool();
 		if (this->device != NULL)
 		{
 			alcMakeContextCurrent(NULL);
@@ -158,9 +165,11 @@ namespace xal
 	void OpenAL_AudioManager::resetOpenAL()
 	{
 		hlog::write(logTag, "Restarting OpenAL.");
+		this->_destroySharedBuffers();
 		foreach (Player*, it, this->players)
 		{
 			((OpenAL_Player*)*it)->destroyOpenALBuffers();
+			((OpenAL_Player*)*it)->setSourceId(0); // sources are destroyed together with the context
 		}
 		destroyOpenAL();
 		initOpenAL();
@@ -175,21 +184,40 @@ namespace xal
 		return new OpenAL_Player(sound);
 	}
 	
+	int OpenAL_AudioManager::getSourcePoolSize()
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		return this->sourcePool.size();
+	}
+
+	int OpenAL_AudioManager::getFreeSourceCount()
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		return this->freeSources.size();
+	}
+
+	int OpenAL_AudioManager::getSourceExhaustionCount()
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		return this->sourceExhaustionCount;
+	}
+
+	void OpenAL_AudioManager::resetSourceExhaustionCount()
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		this->sourceExhaustionCount = 0;
+	}
+
 	unsigned int OpenAL_AudioManager::_allocateSourceId()
 	{
-		unsigned int id = 0;
-		alGenSources(1, &id);
-		ALenum error = alGetError();
-		if (error != AL_NO_ERROR)
+		if (this->freeSources.size() == 0)
 		{
-			hlog::warn(logTag, hsprintf("Unable to allocate audio source! error = %s, numActiveSources = %d",alGetErrorString(error).cStr(), this->numActiveSources));
+			++this->sourceExhaustionCount;
+			hlog::warn(logTag, hsprintf("Unable to allocate audio source, pool exhausted! numActiveSources = %d", this->numActiveSources));
 			return 0;
 		}
 		++this->numActiveSources;
-#ifdef _DEBUG
-//		hlog::write(logTag, hsprintf("Allocated source: %d, currently active sources: %d", id, this->numActiveSources));
-#endif
-		return id;
+		return this->freeSources.removeLast();
 	}
 
 	void OpenAL_AudioManager::_releaseSourceId(unsigned int sourceId)
@@ -197,13 +225,168 @@ namespace xal
 		if (sourceId != 0)
 		{
 			--this->numActiveSources;
-			alDeleteSources(1, &sourceId);
+			// the next Player has to get the source in a clean state
+			alSourceStop(sourceId);
+			alSourcei(sourceId, AL_BUFFER, AL_NONE);
+			alSourcei(sourceId, AL_LOOPING, AL_FALSE);
+			alSourcef(sourceId, AL_GAIN, 1.0f);
+			alSourcef(sourceId, AL_PITCH, 1.0f);
+			this->freeSources += sourceId;
 		}
-#ifdef _DEBUG
-//		hlog::write(logTag, hsprintf("Released source: %d, currently active sources: %d", sourceId, this->numActiveSources));
-#endif
+	}
+
+	void OpenAL_AudioManager::_createSourcePool()
+	{
+		ALCint monoSources = 0;
+		ALCint stereoSources = 0;
+		alcGetIntegerv(this->device, ALC_MONO_SOURCES, 1, &monoSources);
+		alcGetIntegerv(this->device, ALC_STEREO_SOURCES, 1, &stereoSources);
+		int count = monoSources + stereoSources;
+		if (count <= 0) // not every implementation reports its limits
+		{
+			count = OPENAL_DEFAULT_SOURCE_COUNT;
+		}
+		count = hmin(count, OPENAL_MAX_SOURCE_COUNT);
+		unsigned int id = 0;
+		alGetError(); // clears previous errors
+		for_iter (i, 0, count)
+		{
+			alGenSources(1, &id);
+			ALenum error = alGetError();
+			if (error != AL_NO_ERROR) // the reported limits are not always reliable
+			{
+				break;
+			}
+			this->sourcePool += id;
+		}
+		this->freeSources = this->sourcePool;
+		this->numActiveSources = 0;
+		hlog::writef(logTag, "Created pool with %d audio sources.", this->sourcePool.size());
+	}
+
+	void OpenAL_AudioManager::_destroySourcePool()
+	{
+		unsigned int id = 0;
+		foreach (unsigned int, it, this->sourcePool)
+		{
+			id = (*it);
+			alSourceStop(id);
+			alSourcei(id, AL_BUFFER, AL_NONE);
+			alDeleteSources(1, &id);
+		}
+		this->sourcePool.clear();
+		this->freeSources.clear();
+		this->numActiveSources = 0;
 	}
 	
+	unsigned int OpenAL_AudioManager::_acquireSharedBuffer(Buffer* buffer)
+	{
+		if (!this->sharedBuffers.hasKey(buffer))
+		{
+			SharedBuffer shared;
+			alGenBuffers(1, &shared.id);
+			ALenum error = alGetError();
+			if (error != AL_NO_ERROR)
+			{
+				hlog::warn(logTag, "Unable to create shared buffer! error = " + alGetErrorString(error));
+				return 0;
+			}
+			ALenum format = OpenAL_AudioManager::_getFormat(buffer->getChannels(), buffer->getBitsPerSample());
+			if (format == AL_NONE)
+			{
+				hlog::errorf(logTag, "Unsupported format, %d channels with %d bits: %s", buffer->getChannels(), buffer->getBitsPerSample(), buffer->getFilename().cStr());
+				alDeleteBuffers(1, &shared.id);
+				return 0;
+			}
+			// the data is uploaded only once and used by all Players of this Buffer until it's cleared
+			alBufferData(shared.id, format, buffer->getData(), buffer->getDataSize(), buffer->getSamplingRate());
+			this->sharedBuffers[buffer] = shared;
+		}
+		SharedBuffer& shared = this->sharedBuffers[buffer];
+		++shared.references;
+		return shared.id;
+	}
+
+	void OpenAL_AudioManager::_releaseSharedBuffer(Buffer* buffer)
+	{
+		if (this->sharedBuffers.hasKey(buffer))
+		{
+			SharedBuffer& shared = this->sharedBuffers[buffer];
+			--shared.references;
+			if (shared.references <= 0 && shared.released)
+			{
+				alDeleteBuffers(1, &shared.id);
+				this->sharedBuffers.erase(buffer);
+			}
+		}
+	}
+
+	void OpenAL_AudioManager::_destroySharedBuffers()
+	{
+		foreach_m (SharedBuffer, it, this->sharedBuffers)
+		{
+			alDeleteBuffers(1, &it->second.id);
+		}
+		this->sharedBuffers.clear();
+	}
+
+	void OpenAL_AudioManager::_onBufferCleared(Buffer* buffer)
+	{
+		if (this->sharedBuffers.hasKey(buffer))
+		{
+			SharedBuffer& shared = this->sharedBuffers[buffer];
+			if (shared.references > 0) // an AL buffer cannot be deleted while it's attached to a source
+			{
+				shared.released = true;
+				return;
+			}
+			alDeleteBuffers(1, &shared.id);
+			this->sharedBuffers.erase(buffer);
+		}
+	}
+
+	void OpenAL_AudioManager::_onBufferDestroyed(Buffer* buffer)
+	{
+		// the entry has to go, a new Buffer at the same address would get the old data otherwise
+		if (this->sharedBuffers.hasKey(buffer))
+		{
+			SharedBuffer& shared = this->sharedBuffers[buffer];
+			if (shared.references > 0)
+			{
+				hlog::warn(logTag, "Shared buffer is still attached while its Buffer is destroyed: " + buffer->getFilename());
+			}
+			alDeleteBuffers(1, &shared.id);
+			this->sharedBuffers.erase(buffer);
+		}
+	}
+
+	ALenum OpenAL_AudioManager::_getFormat(int channels, int bitsPerSample)
+	{
+		if (channels == 1)
+		{
+			if (bitsPerSample == 8)
+			{
+				return AL_FORMAT_MONO8;
+			}
+			if (bitsPerSample == 16)
+			{
+				return AL_FORMAT_MONO16;
+			}
+		}
+		else if (channels == 2)
+		{
+			if (bitsPerSample == 8)
+			{
+				return AL_FORMAT_STEREO8;
+			}
+			if (bitsPerSample == 16)
+			{
+				return AL_FORMAT_STEREO16;
+			}
+		}
+		return AL_NONE;
+	}
+
 #ifdef _IOS
 	void OpenAL_AudioManager::_resumeAudio()
 	{
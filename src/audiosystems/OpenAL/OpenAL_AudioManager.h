@@ -23,6 +23,8 @@
 #include <TargetConditionals.h>
 #endif
 
+#include <hltypes/harray.h>
+#include <hltypes/hmap.h>
 #include <hltypes/hstring.h>
 
 #include "AudioManager.h"
@@ -45,14 +47,61 @@ namespace xal
 
 		void suspendOpenALContext();
 		bool resumeOpenALContext();
+
+		/// @return Number of AL sources that were preallocated for the source pool.
+		int getSourcePoolSize();
+		/// @return Number of AL sources in the pool that are currently not used by any Player.
+		int getFreeSourceCount();
+		/// @return Number of times a Player could not get an AL source because the pool was exhausted.
+		int getSourceExhaustionCount();
+		/// @brief Resets the counter of failed AL source allocations.
+		void resetSourceExhaustionCount();
+
 	protected:
+		/// @brief An AL buffer holding the complete data of a non-streamed Buffer, shared by all of its Players.
+		struct SharedBuffer
+		{
+			unsigned int id;
+			/// @brief Number of Players that have the AL buffer attached to their source.
+			int references;
+			/// @brief Whether the Buffer's data was cleared while the AL buffer was still attached.
+			bool released;
+
+			SharedBuffer() : id(0), references(0), released(false) { }
+		};
+
 		ALCdevice* device;
 		ALCcontext* context;
 		int numActiveSources;
+		/// @brief All AL sources that were created for the pool.
+		harray<unsigned int> sourcePool;
+		/// @brief AL sources from the pool that are currently not used.
+		harray<unsigned int> freeSources;
+		/// @brief Number of failed AL source allocations.
+		int sourceExhaustionCount;
+		hmap<Buffer*, SharedBuffer> sharedBuffers;
 
 		Player* _createSystemPlayer(Sound* sound);
 		unsigned int _allocateSourceId();
 		void _releaseSourceId(unsigned int sourceId);
+		/// @brief Creates as many AL sources as the device supports.
+		void _createSourcePool();
+		void _destroySourcePool();
+		/// @brief Gets the shared AL buffer of a Buffer and uploads the Buffer's data first if necessary.
+		/// @param[in] buffer The Buffer.
+		/// @return The AL buffer ID or 0 if it could not be created.
+		unsigned int _acquireSharedBuffer(Buffer* buffer);
+		/// @brief Releases a reference to the shared AL buffer of a Buffer.
+		/// @param[in] buffer The Buffer.
+		void _releaseSharedBuffer(Buffer* buffer);
+		void _destroySharedBuffers();
+		void _onBufferCleared(Buffer* buffer);
+		void _onBufferDestroyed(Buffer* buffer);
+		/// @brief Gets the AL format for PCM data.
+		/// @param[in] channels Number of channels.
+		/// @param[in] bitsPerSample Bits per sample.
+		/// @return The AL format or AL_NONE if OpenAL cannot play such data.
+		static ALenum _getFormat(int channels, int bitsPerSample);
 #ifdef _IOS
 		void _resumeAudio();
 		void _suspendAudio();
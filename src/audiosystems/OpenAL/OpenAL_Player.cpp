@@ -17,6 +17,8 @@
 #include <OpenAL/al.h>
 #endif
 
+#include <hltypes/hlog.h>
+
 #include "AudioManager.h"
 #include "Buffer.h"
 #include "Category.h"
@@ -27,9 +29,10 @@
 
 namespace xal
 {
-	OpenAL_Player::OpenAL_Player(Sound* sound) : Player(sound), sourceId(0)
+	OpenAL_Player::OpenAL_Player(Sound* sound) : Player(sound), sourceId(0), sharedBufferId(0)
 	{
 		this->pendingPitchUpdate = false;
+		this->bufferIds = new unsigned int[this->streamBufferCount];
 		this->createOpenALBuffers();
 #ifdef _MAC
 		this->macSampleOffset = -1;
@@ -40,17 +43,29 @@ namespace xal
 	{
 		// AudioManager calls _stop before destruction
 		this->destroyOpenALBuffers();
+		delete[] this->bufferIds;
 	}
 	
 	void OpenAL_Player::createOpenALBuffers()
 	{
-		memset(this->bufferIds, 0, STREAM_BUFFER_COUNT * sizeof(unsigned int));
-		alGenBuffers((!this->sound->isStreamed() ? 1 : STREAM_BUFFER_COUNT), this->bufferIds);
+		memset(this->bufferIds, 0, this->streamBufferCount * sizeof(unsigned int));
+		if (this->sound->isStreamed())
+		{
+			alGenBuffers(this->streamBufferCount, this->bufferIds);
+		}
 	}
 
 	void OpenAL_Player::destroyOpenALBuffers()
 	{
-		alDeleteBuffers((!this->sound->isStreamed() ? 1 : STREAM_BUFFER_COUNT), this->bufferIds);
+		if (this->sound->isStreamed())
+		{
+			alDeleteBuffers(this->streamBufferCount, this->bufferIds);
+		}
+		if (this->sharedBufferId != 0) // owned by the AudioManager
+		{
+			((OpenAL_AudioManager*)xal::manager)->_releaseSharedBuffer(this->buffer);
+			this->sharedBufferId = 0;
+		}
 	}
 	
 	void OpenAL_Player::_update(float timeDelta)
@@ -88,7 +103,7 @@ namespace xal
 		{
 			return bytes;
 		}
-		return ((bytes + this->bufferIndex * STREAM_BUFFER_SIZE) % STREAM_BUFFER);
+		return ((bytes + this->bufferIndex * this->streamBufferSize) % this->_getStreamBufferBytes());
 	}
 	
 	float OpenAL_Player::_systemGetOffset()
@@ -143,22 +158,26 @@ namespace xal
 		// making sure all buffer data is loaded before accessing anything
 		if (!this->sound->isStreamed())
 		{
-			this->_fillBuffers(0, 1);
-			alSourcei(this->sourceId, AL_BUFFER, this->bufferIds[0]);
+			if (this->sharedBufferId == 0)
+			{
+				this->buffer->keepLoaded();
+				this->sharedBufferId = ((OpenAL_AudioManager*)xal::manager)->_acquireSharedBuffer(this->buffer);
+			}
+			alSourcei(this->sourceId, AL_BUFFER, this->sharedBufferId);
 			alSourcei(this->sourceId, AL_LOOPING, this->looping);
 		}
 		else
 		{
 			alSourcei(this->sourceId, AL_BUFFER, AL_NONE);
 			alSourcei(this->sourceId, AL_LOOPING, false);
-			int count = STREAM_BUFFER_COUNT - this->_getQueuedBuffersCount();
+			int count = this->streamBufferCount - this->_getQueuedBuffersCount();
 			if (count > 0)
 			{
 				count = this->_fillBuffers(this->bufferIndex, count);
 				if (count > 0)
 				{
 					this->_queueBuffers(this->bufferIndex, count);
-					this->bufferIndex = (this->bufferIndex + count) % STREAM_BUFFER_COUNT;
+					this->bufferIndex = (this->bufferIndex + count) % this->streamBufferCount;
 				}
 			}
 		}
@@ -213,6 +232,11 @@ namespace xal
 			{
 				alSourceStop(this->sourceId);
 				alSourcei(this->sourceId, AL_BUFFER, AL_NONE); // necessary to avoid a memory leak in OpenAL
+				if (this->sharedBufferId != 0)
+				{
+					((OpenAL_AudioManager*)xal::manager)->_releaseSharedBuffer(this->buffer);
+					this->sharedBufferId = 0;
+				}
 			}
 			else
 			{
@@ -224,8 +248,8 @@ namespace xal
 				alSourcei(this->sourceId, AL_BUFFER, AL_NONE); // necessary to avoid a memory leak in OpenAL
 				if (this->paused)
 				{
-					this->bufferIndex = (this->bufferIndex + processed) % STREAM_BUFFER_COUNT;
-					result = processed * STREAM_BUFFER_SIZE;
+					this->bufferIndex = (this->bufferIndex + processed) % this->streamBufferCount;
+					result = processed * this->streamBufferSize;
 				}
 				else
 				{
@@ -252,13 +276,13 @@ namespace xal
 		{
 			return 0;
 		}
-		this->_unqueueBuffers((this->bufferIndex + STREAM_BUFFER_COUNT - queued) % STREAM_BUFFER_COUNT, processed);
+		this->_unqueueBuffers((this->bufferIndex + this->streamBufferCount - queued) % this->streamBufferCount, processed);
 		int count = this->_fillBuffers(this->bufferIndex, processed);
 		if (count > 0)
 		{
 			this->_queueBuffers(this->bufferIndex, count);
-			this->bufferIndex = (this->bufferIndex + count) % STREAM_BUFFER_COUNT;
-			bool playing = (processed < STREAM_BUFFER_COUNT);
+			this->bufferIndex = (this->bufferIndex + count) % this->streamBufferCount;
+			bool playing = (processed < this->streamBufferCount);
 			if (playing)
 			{
 				int state;
@@ -283,9 +307,22 @@ namespace xal
 			this->_stop();
 			processed = 0;
 		}
-		return (processed * STREAM_BUFFER_SIZE);
+		return (processed * this->streamBufferSize);
 	}
 	
+	void OpenAL_Player::_systemReset()
+	{
+		if (this->sharedBufferId != 0)
+		{
+			((OpenAL_AudioManager*)xal::manager)->_releaseSharedBuffer(this->buffer);
+			this->sharedBufferId = 0;
+		}
+		this->pendingPitchUpdate = false;
+#ifdef _MAC
+		this->macSampleOffset = -1;
+#endif
+	}
+
 	int OpenAL_Player::_getQueuedBuffersCount()
 	{
 		int queued = 0;
@@ -308,45 +345,44 @@ namespace xal
 	
 	int OpenAL_Player::_fillBuffers(int index, int count)
 	{
-		int size = this->buffer->load(this->looping, count * STREAM_BUFFER_SIZE);
-		hstream& stream = this->buffer->getStream();
-		if (!this->sound->isStreamed())
+		ALenum format = OpenAL_AudioManager::_getFormat(this->buffer->getChannels(), this->buffer->getBitsPerSample());
+		if (format == AL_NONE)
 		{
-			alBufferData(this->bufferIds[index], (this->buffer->getChannels() == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16),
-				(unsigned char*)stream, size, this->buffer->getSamplingRate());
-			return 1;
+			hlog::errorf(logTag, "Unsupported format, %d channels with %d bits: %s", this->buffer->getChannels(), this->buffer->getBitsPerSample(), this->buffer->getFilename().cStr());
+			return 0;
 		}
-		int filled = (size + STREAM_BUFFER_SIZE - 1) / STREAM_BUFFER_SIZE;
-		unsigned int format = (this->buffer->getChannels() == 1 ? AL_FORMAT_MONO16 : AL_FORMAT_STEREO16);
+		int size = this->buffer->load(this->looping, count * this->streamBufferSize);
+		const unsigned char* data = this->buffer->getData();
+		int filled = (size + this->streamBufferSize - 1) / this->streamBufferSize;
 		int samplingRate = this->buffer->getSamplingRate();
 		for_iter (i, 0, filled)
 		{
-			alBufferData(this->bufferIds[(index + i) % STREAM_BUFFER_COUNT], format,
-				&stream[i * STREAM_BUFFER_SIZE], hmin(size, STREAM_BUFFER_SIZE), samplingRate);
-			size -= STREAM_BUFFER_SIZE;
+			alBufferData(this->bufferIds[(index + i) % this->streamBufferCount], format,
+				&data[i * this->streamBufferSize], hmin(size, this->streamBufferSize), samplingRate);
+			size -= this->streamBufferSize;
 		}
 		return filled;
 	}
 	
 	void OpenAL_Player::_queueBuffers(int index, int count)
 	{
-		if (index + count <= STREAM_BUFFER_COUNT)
+		if (index + count <= this->streamBufferCount)
 		{
 			alSourceQueueBuffers(this->sourceId, count, &this->bufferIds[index]);
 		}
 		else
 		{
-			alSourceQueueBuffers(this->sourceId, STREAM_BUFFER_COUNT - index, &this->bufferIds[index]);
-			alSourceQueueBuffers(this->sourceId, count + index - STREAM_BUFFER_COUNT, this->bufferIds);
+			alSourceQueueBuffers(this->sourceId, this->streamBufferCount - index, &this->bufferIds[index]);
+			alSourceQueueBuffers(this->sourceId, count + index - this->streamBufferCount, this->bufferIds);
 		}
 	}
  	
 	void OpenAL_Player::_queueBuffers()
 	{
 		int queued = this->_getQueuedBuffersCount();
-		if (queued < STREAM_BUFFER_COUNT)
+		if (queued < this->streamBufferCount)
 		{
-			this->_queueBuffers(this->bufferIndex, STREAM_BUFFER_COUNT - queued);
+			this->_queueBuffers(this->bufferIndex, this->streamBufferCount - queued);
 		}
 	}
  	
@@ -356,7 +392,7 @@ namespace xal
 		int n = this->_getQueuedBuffersCount();
 		int safeWait = 50;
 #endif
-		if (index + count <= STREAM_BUFFER_COUNT)
+		if (index + count <= this->streamBufferCount)
 		{
 			alSourceUnqueueBuffers(this->sourceId, count, &this->bufferIds[index]);
 #ifdef __APPLE__
@@ -375,9 +411,9 @@ namespace xal
 		}
 		else
 		{
-			alSourceUnqueueBuffers(this->sourceId, STREAM_BUFFER_COUNT - index, &this->bufferIds[index]);
+			alSourceUnqueueBuffers(this->sourceId, this->streamBufferCount - index, &this->bufferIds[index]);
 #ifdef __APPLE__
-			while (n - this->_getQueuedBuffersCount() != STREAM_BUFFER_COUNT - index && safeWait > 0)
+			while (n - this->_getQueuedBuffersCount() != this->streamBufferCount - index && safeWait > 0)
 			{
 				hthread::sleep(1);
 				--safeWait;
@@ -389,12 +425,12 @@ namespace xal
 				alSourcei(this->sourceId, AL_BUFFER, AL_NONE);
 				return;
 			}
-			n -= STREAM_BUFFER_COUNT - index;
+			n -= this->streamBufferCount - index;
 #endif
-			alSourceUnqueueBuffers(this->sourceId, count + index - STREAM_BUFFER_COUNT, this->bufferIds);
+			alSourceUnqueueBuffers(this->sourceId, count + index - this->streamBufferCount, this->bufferIds);
 #ifdef __APPLE__
 			safeWait = 50;
-			while (n - this->_getQueuedBuffersCount() != count + index - STREAM_BUFFER_COUNT && safeWait > 0)
+			while (n - this->_getQueuedBuffersCount() != count + index - this->streamBufferCount && safeWait > 0)
 			{
 				hthread::sleep(1);
 				--safeWait;
@@ -414,7 +450,7 @@ namespace xal
 		int queued = this->_getQueuedBuffersCount();
 		if (queued > 0)
 		{
-			this->_unqueueBuffers((this->bufferIndex + STREAM_BUFFER_COUNT - queued) % STREAM_BUFFER_COUNT, queued);
+			this->_unqueueBuffers((this->bufferIndex + this->streamBufferCount - queued) % this->streamBufferCount, queued);
 		}
 	}
 	
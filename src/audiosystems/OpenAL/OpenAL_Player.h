@@ -38,7 +38,10 @@ namespace xal
 		void destroyOpenALBuffers();
 	protected:
 		unsigned int sourceId;
-		unsigned int bufferIds[STREAM_BUFFER_COUNT];
+		/// @note Only used by streamed Sounds, the others use the shared AL buffer of their Buffer.
+		unsigned int* bufferIds;
+		/// @brief The shared AL buffer that is currently attached to the source.
+		unsigned int sharedBufferId;
 
 		void _update(float timeDelta);
 
@@ -53,6 +56,7 @@ namespace xal
 		void _systemPlay();
 		int _systemStop();
 		int _systemUpdateStream();
+		void _systemReset();
 
 		int _getQueuedBuffersCount();
 		int _getProcessedBuffersCount();
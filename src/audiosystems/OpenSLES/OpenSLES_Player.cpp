@@ -66,15 +66,16 @@ namespace xal
 	OpenSLES_Player::OpenSLES_Player(Sound* sound) : Player(sound), playing(false), active(false), stillPlaying(false),
 		playerObject(NULL), player(NULL), playerVolume(NULL), playerBufferQueue(NULL)
 	{
-		for_iter (i, 0, STREAM_BUFFER_COUNT)
+		this->streamBuffers = new unsigned char*[this->streamBufferCount];
+		for_iter (i, 0, this->streamBufferCount)
 		{
 			this->streamBuffers[i] = NULL;
 		}
 		if (this->sound->isStreamed())
 		{
-			for_iter (i, 0, STREAM_BUFFER_COUNT)
+			for_iter (i, 0, this->streamBufferCount)
 			{
-				this->streamBuffers[i] = new unsigned char[STREAM_BUFFER_SIZE];
+				this->streamBuffers[i] = new unsigned char[this->streamBufferSize];
 			}
 		}
 	}
@@ -85,7 +86,7 @@ namespace xal
 		{
 			__CPP_WRAP(this->playerObject, Destroy);
 		}
-		for_iter (i, 0, STREAM_BUFFER_COUNT)
+		for_iter (i, 0, this->streamBufferCount)
 		{
 			if (this->streamBuffers[i] != NULL)
 			{
@@ -93,6 +94,7 @@ namespace xal
 				this->streamBuffers[i] = NULL;
 			}
 		}
+		delete[] this->streamBuffers;
 	}
 	
 	void OpenSLES_Player::_update(float timeDelta)
@@ -141,7 +143,7 @@ namespace xal
 		// input / source
 		SLDataLocator_AndroidSimpleBufferQueue inLocator;
 		inLocator.locatorType = SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE;
-		inLocator.numBuffers = (!this->sound->isStreamed() ? NORMAL_BUFFER_COUNT : STREAM_BUFFER_COUNT);
+		inLocator.numBuffers = (!this->sound->isStreamed() ? NORMAL_BUFFER_COUNT : this->streamBufferCount);
 		SLDataFormat_PCM format;
 		format.formatType = SL_DATAFORMAT_PCM;
 		format.numChannels = this->buffer->getChannels();
@@ -222,7 +224,7 @@ namespace xal
 			{
 				if (!this->paused)
 				{
-					this->_submitBuffer(this->buffer->getStream());
+					this->_submitBuffer(this->buffer->getData(), this->buffer->getDataSize());
 				}
 				return;
 			}
@@ -237,11 +239,11 @@ namespace xal
 			}
 			for_iter (i, 0, count)
 			{
-				this->_submitBuffer(this->buffer->getStream());
+				this->_submitBuffer(this->buffer->getData(), this->buffer->getDataSize());
 			}
 			return;
 		}
-		int count = STREAM_BUFFER_COUNT;
+		int count = this->streamBufferCount;
 		if (this->paused)
 		{
 			count -= this->buffersSubmitted;
@@ -365,7 +367,7 @@ namespace xal
 			this->buffersSubmitted -= processed;
 			for_iter (i, 0, processed)
 			{
-				this->_submitBuffer(this->buffer->getStream());
+				this->_submitBuffer(this->buffer->getData(), this->buffer->getDataSize());
 			}
 			this->stillPlaying = true; // in case underrun happened, sound is regarded as stopped so let's just bitch-slap it and get this over with
 			if (this->buffersSubmitted == 0)
@@ -397,9 +399,9 @@ namespace xal
 		return 0;
 	}
 
-	void OpenSLES_Player::_submitBuffer(hstream& stream)
+	void OpenSLES_Player::_submitBuffer(const unsigned char* data, int size)
 	{
-		SLresult result = __CPP_WRAP_ARGS(this->playerBufferQueue, Enqueue, (unsigned char*)stream, (int)stream.size());
+		SLresult result = __CPP_WRAP_ARGS(this->playerBufferQueue, Enqueue, data, size);
 		if (result == SL_RESULT_SUCCESS)
 		{
 			++this->buffersSubmitted;
@@ -412,20 +414,20 @@ namespace xal
 
 	int OpenSLES_Player::_fillStreamBuffers(int count)
 	{
-		int size = this->buffer->load(this->looping, count * STREAM_BUFFER_SIZE);
-		int filled = (size + STREAM_BUFFER_SIZE - 1) / STREAM_BUFFER_SIZE;
-		hstream& stream = this->buffer->getStream();
+		int size = this->buffer->load(this->looping, count * this->streamBufferSize);
+		int filled = (size + this->streamBufferSize - 1) / this->streamBufferSize;
+		const unsigned char* data = this->buffer->getData();
 		int currentSize = 0;
 		for_iter (i, 0, filled)
 		{
-			currentSize = hmin(size, STREAM_BUFFER_SIZE);
-			memcpy(this->streamBuffers[this->bufferIndex], &stream[i * STREAM_BUFFER_SIZE], currentSize);
-			if (currentSize < STREAM_BUFFER_SIZE)
+			currentSize = hmin(size, this->streamBufferSize);
+			memcpy(this->streamBuffers[this->bufferIndex], &data[i * this->streamBufferSize], currentSize);
+			if (currentSize < this->streamBufferSize)
 			{
-				memset(&this->streamBuffers[this->bufferIndex][currentSize], 0, STREAM_BUFFER_SIZE - currentSize);
+				memset(&this->streamBuffers[this->bufferIndex][currentSize], 0, this->streamBufferSize - currentSize);
 			}
-			this->bufferIndex = (this->bufferIndex + 1) % STREAM_BUFFER_COUNT;
-			size -= STREAM_BUFFER_SIZE;
+			this->bufferIndex = (this->bufferIndex + 1) % this->streamBufferCount;
+			size -= this->streamBufferSize;
 		}
 		return filled;
 	}
@@ -433,17 +435,17 @@ namespace xal
 	void OpenSLES_Player::_submitStreamBuffers(int count)
 	{
 		int queued = 0;
-		int index = (this->bufferIndex + STREAM_BUFFER_COUNT - count) % STREAM_BUFFER_COUNT;
+		int index = (this->bufferIndex + this->streamBufferCount - count) % this->streamBufferCount;
 		for_iter (i, 0, count)
 		{
-			SLresult result = __CPP_WRAP_ARGS(this->playerBufferQueue, Enqueue, this->streamBuffers[index], STREAM_BUFFER_SIZE);
+			SLresult result = __CPP_WRAP_ARGS(this->playerBufferQueue, Enqueue, this->streamBuffers[index], this->streamBufferSize);
 			if (result != SL_RESULT_SUCCESS)
 			{
 				hlog::warn(logTag, "Could not queue streamed buffer!");
 				break;
 			}
 			++queued;
-			index = (index + 1) % STREAM_BUFFER_COUNT;
+			index = (index + 1) % this->streamBufferCount;
 		}
 		this->buffersSubmitted += queued;
 	}
@@ -44,7 +44,7 @@ namespace xal
 		SLVolumeItf playerVolume;
 		SLAndroidSimpleBufferQueueItf playerBufferQueue;
 		SLAndroidSimpleBufferQueueState playerBufferQueueState;
-		unsigned char* streamBuffers[STREAM_BUFFER_COUNT]; // OpenSLES does not keep audio data alive so streamed audio has to be cached
+		unsigned char** streamBuffers; // OpenSLES does not keep audio data alive so streamed audio has to be cached
 		int buffersSubmitted;
 
 		void _update(float timeDelta);
@@ -61,7 +61,7 @@ namespace xal
 		void _systemUpdateNormal();
 		int _systemUpdateStream();
 
-		void _submitBuffer(hstream& stream);
+		void _submitBuffer(const unsigned char* data, int size);
 		int _fillStreamBuffers(int count);
 		void _submitStreamBuffers(int count);
 
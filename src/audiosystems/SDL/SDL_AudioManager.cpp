@@ -12,6 +12,7 @@
 #include <hltypes/harray.h>
 #include <hltypes/hlog.h>
 #include <hltypes/hltypesUtil.h>
+#include <hltypes/hmap.h>
 #include <hltypes/hstring.h>
 
 #include "SDL_AudioManager.h"
@@ -56,6 +57,13 @@ namespace xal
 		SDL_PauseAudio(1);
 		SDL_CloseAudio();
 		SDL_QuitSubSystem(SDL_INIT_AUDIO);
+		foreach_m (harray<unsigned char*>, it, this->ringBufferPool)
+		{
+			foreach (unsigned char*, it2, it->second)
+			{
+				delete[] (*it2);
+			}
+		}
 	}
 	
 	Player* SDL_AudioManager::_createSystemPlayer(Sound* sound)
@@ -63,86 +71,71 @@ namespace xal
 		return new SDL_Player(sound);
 	}
 
-	void SDL_AudioManager::mixAudio(void* unused, unsigned char* stream, int length)
+	unsigned char* SDL_AudioManager::_allocateRingBuffer(int size)
 	{
-		hmutex::ScopeLock lock(&this->mutex);
-		if (this->buffer.size() < length)
+		if (this->ringBufferPool.hasKey(size))
 		{
-			this->buffer.clear(length); // to make sure there is enough space available
-		}
-		this->buffer.fill(0, length);
-		bool first = true;
-		harray<SDL_Player*> players = this->players.cast<SDL_Player*>();
-		foreach (SDL_Player*, it, players)
-		{
-			if ((*it)->mixAudio(this->buffer, length, first)) // returns true if playing and first audio data has been mixed into the stream
+			harray<unsigned char*>& pool = this->ringBufferPool[size];
+			if (pool.size() > 0)
 			{
-				first = false;
+				return pool.removeLast();
 			}
 		}
-		// because stream mixing is done manually, there is no need to call SDL_MixAudio and memcpy is enough,
-		// the following line is here only for demonstration how it would look like with SDL_MixAudio
-		//SDL_MixAudio(stream, this->buffer, this->bufferSize, SDL_MIX_MAXVOLUME);
-		memcpy(stream, (unsigned char*)this->buffer, length);
+		return new unsigned char[size];
 	}
 
-	void SDL_AudioManager::_mixAudio(void* unused, unsigned char* stream, int length)
+	void SDL_AudioManager::_releaseRingBuffer(unsigned char* data, int size)
 	{
-		((SDL_AudioManager*)xal::manager)->mixAudio(unused, stream, length);
-	}
-	
-	void SDL_AudioManager::_convertStream(Source* source, hstream& stream)
-	{	
-		if (stream.size() == 0)
+		harray<unsigned char*>& pool = this->ringBufferPool[size];
+		if (pool.size() < SDL_RING_BUFFER_POOL_SIZE)
 		{
-			return;
-		}
-		SDL_AudioSpec format = this->getFormat();
-		int srcFormat = (source->getBitsPerSample() == 16 ? AUDIO_S16 : AUDIO_S8);
-		int srcChannels = source->getChannels();
-		int srcSamplingRate = source->getSamplingRate();
-		if (srcFormat == format.format && srcChannels == format.channels && srcSamplingRate == format.freq)
-		{
-			return;
+			pool += data;
 		}
-		SDL_AudioCVT cvt;
-		cvt.buf = NULL;
-		int result = SDL_BuildAudioCVT(&cvt, srcFormat, srcChannels, srcSamplingRate, format.format, format.channels, format.freq);
-		if (result <= 0)
+		else
 		{
-			hlog::error(logTag, "Could not build converter: " + source->getFilename());
-			return;
-		}
-		cvt.buf = (Uint8*)new unsigned char[(int)stream.size() * cvt.len_mult];
-		cvt.len = (int)stream.size();
-		result = stream.readRaw(cvt.buf, cvt.len);
-		if (result > 0)
-		{
-			stream.seek(-result);
+			delete[] data;
 		}
-		result = SDL_ConvertAudio(&cvt);
-		if (result != 0)
+	}
+
+	void SDL_AudioManager::mixAudio(void* unused, unsigned char* stream, int length)
+	{
+		hmutex::ScopeLock lock(&this->mutex);
+		this->mixBus.begin(length / sizeof(short), this->channels);
+		// players are only iterated and not copied since this is called very often
+		foreach (Player*, it, this->players)
 		{
-			delete[] cvt.buf;
-			cvt.buf = NULL;
-			hlog::error(logTag, "Could not convert audio: " + source->getFilename());
-			return;
+			((SDL_Player*)(*it))->mixAudio(&this->mixBus);
 		}
-		if (cvt.len_cvt > 0)
+		// because stream mixing is done manually, there is no need to call SDL_MixAudio and the bus is converted directly into the stream
+		this->mixBus.finish((short*)stream);
+	}
+
+	void SDL_AudioManager::_mixAudio(void* unused, unsigned char* stream, int length)
+	{
+		((SDL_AudioManager*)xal::manager)->mixAudio(unused, stream, length);
+	}
+	
+	bool SDL_AudioManager::_isConversionRequired(Source* source)
+	{
+		SDL_AudioSpec format = this->getFormat();
+		int srcFormat = (source->getBitsPerSample() == 16 ? AUDIO_S16 : AUDIO_S8);
+		if (source->getBitsPerSample() == 32) // float data is mixed directly
 		{
-			if (cvt.len_cvt > stream.size())
-			{
-				stream.setCapacity((int)stream.position() + cvt.len_cvt);
-			}
-			int written = stream.writeRaw(cvt.buf, cvt.len_cvt);
-			if (written > 0)
-			{
-				stream.seek(-written);
-			}
+			srcFormat = format.format;
 		}
-		delete[] cvt.buf;
-		cvt.buf = NULL;
-		return;
+		return (srcFormat != format.format || source->getChannels() != format.channels || source->getSamplingRate() != format.freq);
+	}
+
+	bool SDL_AudioManager::_isProgressiveLoadSupported()
+	{
+		// the mixer reads non-streamed data directly from the Buffer
+		return true;
+	}
+
+	bool SDL_AudioManager::_isFloatMixSupported()
+	{
+		// the mixing bus accumulates in float anyway
+		return true;
 	}
 	
 }
@@ -17,12 +17,16 @@
 #include <SDL/SDL.h>
 
 #include <hltypes/hstream.h>
+#include <hltypes/harray.h>
+#include <hltypes/hmap.h>
 #include <hltypes/hstring.h>
 
 #include "AudioManager.h"
+#include "MixBus.h"
 #include "xalExport.h"
 
 #define SDL_MAX_PLAYING 32
+#define SDL_RING_BUFFER_POOL_SIZE 16 // per ring buffer size
 
 namespace xal
 {
@@ -40,18 +44,34 @@ namespace xal
 		~SDL_AudioManager();
 
 		inline SDL_AudioSpec getFormat() { return this->format; }
+		inline MixBus* getMixBus() { return &this->mixBus; }
 
 		void mixAudio(void* unused, unsigned char* stream, int length);
 
 	protected:
 		SDL_AudioSpec format;
-		hstream buffer;
+		/// @brief Float mixing bus so rounding, clipping and dithering happen only once per block.
+		MixBus mixBus;
+		/// @brief Unused ring buffers of streamed Players grouped by their byte-size.
+		hmap<int, harray<unsigned char*> > ringBufferPool;
 
 		Player* _createSystemPlayer(Sound* sound);
 
+		/// @brief Gets a ring buffer from the pool or creates a new one.
+		/// @param[in] size Byte-size of the ring buffer.
+		/// @return The ring buffer.
+		/// @note The contents of the ring buffer are undefined.
+		unsigned char* _allocateRingBuffer(int size);
+		/// @brief Returns a ring buffer to the pool.
+		/// @param[in] data The ring buffer.
+		/// @param[in] size Byte-size of the ring buffer.
+		void _releaseRingBuffer(unsigned char* data, int size);
+
 		static void _mixAudio(void* unused, unsigned char* stream, int length);
 
-		void _convertStream(Source* source, hstream& stream);
+		bool _isConversionRequired(Source* source);
+		bool _isProgressiveLoadSupported();
+		bool _isFloatMixSupported();
 		
 	};
 
@@ -12,6 +12,7 @@
 #include <hltypes/hltypesUtil.h>
 
 #include "Buffer.h"
+#include "MixBus.h"
 #include "SDL_AudioManager.h"
 #include "SDL_Player.h"
 #include "Sound.h"
@@ -20,14 +21,24 @@
 namespace xal
 {
 	SDL_Player::SDL_Player(Sound* sound) : Player(sound), playing(false),
-		position(0), currentGain(1.0f), readPosition(0), writePosition(0)
+		position(0), currentGain(1.0f), mixGain(1.0f), sampleSize(sizeof(short)), circleBuffer(NULL), circleBufferSize(0), readPosition(0), writePosition(0)
 	{
-		memset(this->circleBuffer, 0, STREAM_BUFFER * sizeof(unsigned char));
 	}
 
 	SDL_Player::~SDL_Player()
 	{
 		// AudioManager calls _stop before destruction
+		this->_releaseCircleBuffer();
+	}
+
+	void SDL_Player::_releaseCircleBuffer()
+	{
+		if (this->circleBuffer != NULL)
+		{
+			((SDL_AudioManager*)xal::manager)->_releaseRingBuffer(this->circleBuffer, this->circleBufferSize);
+			this->circleBuffer = NULL;
+			this->circleBufferSize = 0;
+		}
 	}
 
 	void SDL_Player::_getData(int size, unsigned char** data1, int* size1, unsigned char** data2, int* size2)
@@ -43,14 +54,15 @@ namespace xal
 				*size2 = 0;
 				return;
 			}
-			hstream& stream = this->buffer->getStream();
-			*data1 = (unsigned char*)&stream[this->readPosition];
+			unsigned char* data = (unsigned char*)this->buffer->getData(); // only read from
+			*data1 = &data[this->readPosition];
 			*size1 = hmin(hmin(streamSize, streamSize - this->readPosition), size);
 			*data2 = NULL;
 			*size2 = 0;
-			if (this->looping && this->readPosition + size > streamSize)
+			// progressively loaded data can only wrap around once it's complete, until then playback waits for the decoder
+			if (this->looping && this->readPosition + size > streamSize && this->buffer->_isLoaded())
 			{
-				*data2 = (unsigned char*)stream;
+				*data2 = data;
 				*size2 = size - *size1;
 				this->readPosition = (this->readPosition + size) % streamSize;
 			}
@@ -64,13 +76,13 @@ namespace xal
 		*size1 = size;
 		*data2 = NULL;
 		*size2 = 0;
-		if (this->readPosition + size > STREAM_BUFFER)
+		if (this->readPosition + size > this->circleBufferSize)
 		{
-			*size1 = STREAM_BUFFER - this->readPosition;
+			*size1 = this->circleBufferSize - this->readPosition;
 			*data2 = this->circleBuffer;
 			*size2 = size - *size1;
 		}
-		this->readPosition = (this->readPosition + size) % STREAM_BUFFER;
+		this->readPosition = (this->readPosition + size) % this->circleBufferSize;
 	}
 
 	void SDL_Player::_update(float timeDelta)
@@ -91,7 +103,7 @@ namespace xal
 		}
 	}
 
-	bool SDL_Player::mixAudio(hstream& stream, int size, bool first)
+	bool SDL_Player::mixAudio(MixBus* mixBus)
 	{
 		if (!this->playing)
 		{
@@ -101,49 +113,35 @@ namespace xal
 		int size1 = 0;
 		unsigned char* data2 = NULL;
 		int size2 = 0;
-		this->_getData(size, &data1, &size1, &data2, &size2); // ironically this is very similar to how DirectSound does things internally
+		int count = mixBus->getSize();
+		this->_getData(count * this->sampleSize, &data1, &size1, &data2, &size2); // ironically this is very similar to how DirectSound does things internally
 		if (size1 > 0)
 		{
-			if (first && this->currentGain == 1.0f)
+			int count1 = size1 / this->sampleSize;
+			int count2 = size2 / this->sampleSize;
+			int channels = mixBus->getChannels();
+			// the gain is ramped from the last mixed block's gain to the current one across the whole block, once per frame
+			float gainStep = (this->currentGain - this->mixGain) / hmax(count / channels, 1);
+			float gain2 = this->mixGain + gainStep * (count1 / channels);
+			if (this->sampleSize == sizeof(float))
 			{
-				memcpy((unsigned char*)stream, data1, size1);
-				if (size2 > 0)
+				mixBus->add(0, (float*)data1, count1, this->mixGain, gainStep);
+				if (count2 > 0)
 				{
-					memcpy((void*)&stream[size1], data2, size2);
+					mixBus->add(count1, (float*)data2, count2, gain2, gainStep);
 				}
 			}
 			else
 			{
-				short* sStream = (short*)(unsigned char*)stream;
-				short* sData1 = (short*)data1;
-				short* sData2 = (short*)data2;
-				size1 = size1 * sizeof(unsigned char) / sizeof(short);
-				size2 = size2 * sizeof(unsigned char) / sizeof(short);
-				if (!first)
-				{
-					for_iter (i, 0, size1)
-					{
-						sStream[i] = (short)hclamp((int)(sStream[i] + this->currentGain * sData1[i]), -32768, 32767);
-					}
-					for_iter (i, 0, size2)
-					{
-						sStream[size1 + i] = (short)hclamp((int)(sStream[size1 + i] + this->currentGain * sData2[i]), -32768, 32767);
-					}
-				}
-				else
+				mixBus->add(0, (short*)data1, count1, this->mixGain, gainStep);
+				if (count2 > 0)
 				{
-					for_iter (i, 0, size1)
-					{
-						sStream[i] = (short)(sData1[i] * this->currentGain);
-					}
-					for_iter (i, 0, size2)
-					{
-						sStream[size1 + i] = (short)(sData2[i] * this->currentGain);
-					}
+					mixBus->add(count1, (short*)data2, count2, gain2, gainStep);
 				}
 			}
 			this->position += size1 + size2;
 		}
+		this->mixGain = this->currentGain;
 		return true;
 	}
 
@@ -156,7 +154,7 @@ namespace xal
 		}
 		else if (this->readPosition < this->writePosition)
 		{
-			count = (STREAM_BUFFER - this->writePosition + this->readPosition);
+			count = (this->circleBufferSize - this->writePosition + this->readPosition);
 		}
 		return this->buffer->calcInputSize(count);
 	}
@@ -178,19 +176,26 @@ namespace xal
 
 	void SDL_Player::_systemPrepareBuffer()
 	{
+		this->sampleSize = (this->buffer->isFloat() ? sizeof(float) : sizeof(short));
 		if (!this->sound->isStreamed())
 		{
 			this->buffer->load(this->looping, this->buffer->getSize());
 			return;
 		}
+		if (this->circleBuffer == NULL)
+		{
+			// only streamed Players need a ring buffer and it's only held while playing or paused
+			this->circleBufferSize = this->_getStreamBufferBytes();
+			this->circleBuffer = ((SDL_AudioManager*)xal::manager)->_allocateRingBuffer(this->circleBufferSize);
+		}
 		if (!this->paused)
 		{
 			this->readPosition = 0;
 			this->writePosition = 0;
-			int size = this->_fillBuffer(STREAM_BUFFER);
-			if (size < STREAM_BUFFER)
+			int size = this->_fillBuffer(this->circleBufferSize);
+			if (size < this->circleBufferSize)
 			{
-				memset(&this->circleBuffer[size], 0, (STREAM_BUFFER - size) * sizeof(unsigned char));
+				memset(&this->circleBuffer[size], 0, (this->circleBufferSize - size) * sizeof(unsigned char));
 			}
 		}
 	}
@@ -202,6 +207,7 @@ namespace xal
 
 	void SDL_Player::_systemPlay()
 	{
+		this->mixGain = this->currentGain; // no ramping from a stale gain when starting
 		this->playing = true;
 	}
 
@@ -214,6 +220,7 @@ namespace xal
 			this->readPosition = 0;
 			this->writePosition = 0;
 			this->buffer->rewind();
+			this->_releaseCircleBuffer();
 		}
 		return 0;
 	}
@@ -222,54 +229,69 @@ namespace xal
 	{
 		int result = 0;
 		int count = 0;
+		if (this->circleBuffer == NULL)
+		{
+			return result;
+		}
 		if (this->readPosition > this->writePosition)
 		{
-			count = (this->readPosition - this->writePosition) / STREAM_BUFFER_SIZE;
+			count = (this->readPosition - this->writePosition) / this->streamBufferSize;
 		}
 		else if (this->readPosition < this->writePosition)
 		{
-			count = (STREAM_BUFFER - this->writePosition + this->readPosition) / STREAM_BUFFER_SIZE;
+			count = (this->circleBufferSize - this->writePosition + this->readPosition) / this->streamBufferSize;
 		}
 		if (count > 0)
 		{
-			result = this->_fillBuffer(count * STREAM_BUFFER_SIZE);
+			result = this->_fillBuffer(count * this->streamBufferSize);
 			result = this->buffer->calcInputSize(result);
 		}
 		return result;
 	}
 
+	void SDL_Player::_systemReset()
+	{
+		this->playing = false;
+		this->position = 0;
+		this->readPosition = 0;
+		this->writePosition = 0;
+		this->currentGain = 1.0f;
+		this->mixGain = 1.0f;
+		this->_releaseCircleBuffer();
+	}
+
 	int SDL_Player::_fillBuffer(int size)
 	{
 		// making sure the buffer doesn't overflow since upsampling can cause that
 		size = this->buffer->calcInputSize(size);
 		// load the data from the buffer
 		int streamSize = this->buffer->load(this->looping, size);
-		hstream& stream = this->buffer->getStream();
-		if (this->writePosition + streamSize <= STREAM_BUFFER)
+		const unsigned char* data = this->buffer->getData();
+		if (this->writePosition + streamSize <= this->circleBufferSize)
 		{
-			memcpy(&this->circleBuffer[this->writePosition], (unsigned char*)stream, streamSize * sizeof(unsigned char));
+			memcpy(&this->circleBuffer[this->writePosition], data, streamSize * sizeof(unsigned char));
 		}
 		else
 		{
-			int remaining = STREAM_BUFFER - this->writePosition;
-			memcpy(&this->circleBuffer[this->writePosition], &stream[0], remaining * sizeof(unsigned char));
-			memcpy(this->circleBuffer, &stream[remaining], (streamSize - remaining) * sizeof(unsigned char));
+			int remaining = this->circleBufferSize - this->writePosition;
+			memcpy(&this->circleBuffer[this->writePosition], data, remaining * sizeof(unsigned char));
+			memcpy(this->circleBuffer, &data[remaining], (streamSize - remaining) * sizeof(unsigned char));
 		}
-		this->writePosition = (this->writePosition + streamSize) % STREAM_BUFFER;
+		this->writePosition = (this->writePosition + streamSize) % this->circleBufferSize;
 		if (!this->looping && streamSize < size) // fill with silence if source is at the end
 		{
 			streamSize = size - streamSize;
-			if (this->writePosition + streamSize <= STREAM_BUFFER)
+			if (this->writePosition + streamSize <= this->circleBufferSize)
 			{
 				memset(&this->circleBuffer[this->writePosition], 0, streamSize * sizeof(unsigned char));
 			}
 			else
 			{
-				int remaining = STREAM_BUFFER - this->writePosition;
+				int remaining = this->circleBufferSize - this->writePosition;
 				memset(&this->circleBuffer[this->writePosition], 0, remaining * sizeof(unsigned char));
 				memset(this->circleBuffer, 0, (streamSize - remaining) * sizeof(unsigned char));
 			}
-			this->writePosition = (this->writePosition + streamSize) % STREAM_BUFFER;
+			this->writePosition = (this->writePosition + streamSize) % this->circleBufferSize;
 			streamSize = size;
 		}
 		return streamSize;
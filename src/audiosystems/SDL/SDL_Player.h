@@ -20,6 +20,7 @@
 namespace xal
 {
 	class Buffer;
+	class MixBus;
 	class Sound;
 
 	class xalExport SDL_Player : public Player
@@ -28,13 +29,23 @@ namespace xal
 		SDL_Player(Sound* sound);
 		~SDL_Player();
 
-		bool mixAudio(hstream& stream, int size, bool first);
+		/// @brief Mixes the next block of audio data into the mixing bus.
+		/// @param[in] mixBus The mixing bus with an already started block.
+		/// @return True if the Player is playing.
+		/// @note Gain changes are ramped across the block to avoid clicks.
+		bool mixAudio(MixBus* mixBus);
 
 	protected:
 		bool playing;
 		int position;
 		float currentGain;
-		unsigned char circleBuffer[STREAM_BUFFER];
+		float mixGain;
+		/// @brief Byte-size of one sample in the Buffer's data, float samples are mixed without conversion.
+		int sampleSize;
+		/// @brief Ring buffer for streamed data, taken from the SDL_AudioManager's pool.
+		/// @note Non-streamed Players never allocate one.
+		unsigned char* circleBuffer;
+		int circleBufferSize;
 		int readPosition;
 		int writePosition;
 
@@ -50,7 +61,10 @@ namespace xal
 		void _systemPlay();
 		int _systemStop();
 		int _systemUpdateStream();
+		void _systemReset();
 
+		/// @brief Returns the ring buffer to the pool.
+		void _releaseCircleBuffer();
 		int _fillBuffer(int size);
 		void _getData(int size, unsigned char** data1, int* size1, unsigned char** data2, int* size2);
 
@@ -68,15 +68,16 @@ namespace xal
 	{
 		this->callbackHandler = new XAudio2_Player::CallbackHandler(&this->active);
 		memset(&this->xa2Buffer, 0, sizeof(XAUDIO2_BUFFER));
-		for_iter (i, 0, STREAM_BUFFER_COUNT)
+		this->streamBuffers = new unsigned char*[this->streamBufferCount];
+		for_iter (i, 0, this->streamBufferCount)
 		{
 			this->streamBuffers[i] = NULL;
 		}
 		if (this->sound->isStreamed())
 		{
-			for_iter (i, 0, STREAM_BUFFER_COUNT)
+			for_iter (i, 0, this->streamBufferCount)
 			{
-				this->streamBuffers[i] = new unsigned char[STREAM_BUFFER_SIZE];
+				this->streamBuffers[i] = new unsigned char[this->streamBufferSize];
 			}
 		}
 	}
@@ -89,10 +90,11 @@ namespace xal
 			this->sourceVoice = NULL;
 		}
 		_HL_TRY_DELETE(this->callbackHandler);
-		for_iter (i, 0, STREAM_BUFFER_COUNT)
+		for_iter (i, 0, this->streamBufferCount)
 		{
 			_HL_TRY_DELETE_ARRAY(this->streamBuffers[i]);
 		}
+		delete[] this->streamBuffers;
 	}
 
 	void XAudio2_Player::_update(float timeDelta)
@@ -146,11 +148,11 @@ namespace xal
 		{
 			if (!this->paused)
 			{
-				this->_submitBuffer(this->buffer->getStream());
+				this->_submitBuffer(this->buffer->getData(), this->buffer->getDataSize());
 			}
 			return;
 		}
-		int count = STREAM_BUFFER_COUNT;
+		int count = this->streamBufferCount;
 		if (this->paused)
 		{
 			this->sourceVoice->GetState(&this->xa2State[1], XAUDIO2_VOICE_NOSAMPLESPLAYED);
@@ -216,7 +218,7 @@ namespace xal
 						this->sourceVoice->GetState(&this->xa2State[2], XAUDIO2_VOICE_NOSAMPLESPLAYED);
 						int processed = this->buffersSubmitted - this->xa2State[2].BuffersQueued;
 						this->buffersSubmitted -= processed;
-						result = processed * STREAM_BUFFER_SIZE;
+						result = processed * this->streamBufferSize;
 					}
 				}
 				else
@@ -260,13 +262,13 @@ namespace xal
 		{
 			this->_stop();
 		}
-		return (processed * STREAM_BUFFER_SIZE);
+		return (processed * this->streamBufferSize);
 	}
 
-	void XAudio2_Player::_submitBuffer(hstream& stream)
+	void XAudio2_Player::_submitBuffer(const unsigned char* data, int size)
 	{
-		this->xa2Buffer.AudioBytes = (UINT32)stream.size();
-		this->xa2Buffer.pAudioData = (unsigned char*)stream;
+		this->xa2Buffer.AudioBytes = (UINT32)size;
+		this->xa2Buffer.pAudioData = data;
 		this->xa2Buffer.LoopCount = (this->looping ? XAUDIO2_LOOP_INFINITE : 0);
 		HRESULT result = this->sourceVoice->SubmitSourceBuffer(&this->xa2Buffer);
 		if (FAILED(result))
@@ -277,20 +279,20 @@ namespace xal
 
 	int XAudio2_Player::_fillStreamBuffers(int count)
 	{
-		int size = this->buffer->load(this->looping, count * STREAM_BUFFER_SIZE);
-		int filled = (size + STREAM_BUFFER_SIZE - 1) / STREAM_BUFFER_SIZE;
-		hstream& stream = this->buffer->getStream();
+		int size = this->buffer->load(this->looping, count * this->streamBufferSize);
+		int filled = (size + this->streamBufferSize - 1) / this->streamBufferSize;
+		const unsigned char* data = this->buffer->getData();
 		int currentSize;
 		for_iter (i, 0, filled)
 		{
-			currentSize = hmin(size, STREAM_BUFFER_SIZE);
-			memcpy(this->streamBuffers[this->bufferIndex], &stream[i * STREAM_BUFFER_SIZE], currentSize);
-			if (currentSize < STREAM_BUFFER_SIZE)
+			currentSize = hmin(size, this->streamBufferSize);
+			memcpy(this->streamBuffers[this->bufferIndex], &data[i * this->streamBufferSize], currentSize);
+			if (currentSize < this->streamBufferSize)
 			{
-				memset(&this->streamBuffers[this->bufferIndex][currentSize], 0, STREAM_BUFFER_SIZE - currentSize);
+				memset(&this->streamBuffers[this->bufferIndex][currentSize], 0, this->streamBufferSize - currentSize);
 			}
-			this->bufferIndex = (this->bufferIndex + 1) % STREAM_BUFFER_COUNT;
-			size -= STREAM_BUFFER_SIZE;
+			this->bufferIndex = (this->bufferIndex + 1) % this->streamBufferCount;
+			size -= this->streamBufferSize;
 		}
 		return filled;
 	}
@@ -298,9 +300,9 @@ namespace xal
 	void XAudio2_Player::_submitStreamBuffers(int count)
 	{
 		HRESULT result;
-		this->xa2Buffer.AudioBytes = STREAM_BUFFER_SIZE;
+		this->xa2Buffer.AudioBytes = this->streamBufferSize;
 		this->xa2Buffer.LoopCount = 0;
-		int index = (this->bufferIndex + STREAM_BUFFER_COUNT - count) % STREAM_BUFFER_COUNT;
+		int index = (this->bufferIndex + this->streamBufferCount - count) % this->streamBufferCount;
 		for_iter (i, 0, count)
 		{
 			this->xa2Buffer.pAudioData = this->streamBuffers[index];
@@ -309,7 +311,7 @@ namespace xal
 			{
 				hlog::warn(logTag, "Could not submit streamed source buffer!");
 			}
-			index = (index + 1) % STREAM_BUFFER_COUNT;
+			index = (index + 1) % this->streamBufferCount;
 		}
 		this->buffersSubmitted += count;
 	}
@@ -60,7 +60,7 @@ namespace xal
 		bool active;
 		bool stillPlaying;
 		CallbackHandler* callbackHandler;
-		unsigned char* streamBuffers[STREAM_BUFFER_COUNT]; // XAudio2 does not keep audio data alive so streamed audio has to be cached
+		unsigned char** streamBuffers; // XAudio2 does not keep audio data alive so streamed audio has to be cached
 		int buffersSubmitted;
 
 		void _update(float timeDelta);
@@ -75,7 +75,7 @@ namespace xal
 		int _systemStop();
 		int _systemUpdateStream();
 
-		void _submitBuffer(hstream& stream);
+		void _submitBuffer(const unsigned char* data, int size);
 		int _fillStreamBuffers(int count);
 		void _submitStreamBuffers(int count);
 